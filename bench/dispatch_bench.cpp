@@ -0,0 +1,119 @@
+// Measures the per-instruction cost of VM::run for small kernels built
+// from the existing opcode set. Each kernel is repeated many times in one
+// straight-line Chunk so that dispatch dominates over loading.
+//
+//   cmake -S . -B build -DMEOW_BUILD_BENCHMARKS=ON [-DMEOW_THREADED_DISPATCH=OFF]
+//   cmake --build build && ./build/meow-dispatch-bench
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "bytecode.h"
+#include "vm.h"
+
+namespace {
+const int kRepeat = 20000;
+const int kRuns = 25;
+
+struct Kernel {
+    const char* name;
+    int instructionsPerIteration;
+    std::function<void(Chunk&, uint32_t)> emit;
+};
+
+// Slots 0 and 1 hold the ints 7 and 3, slots 2 and 3 the bools true and
+// false.
+void emitBinary(Chunk& chunk, OpCode op, uint32_t firstSlot = 0) {
+    chunk.emit(OpCode::LOAD_VAR, firstSlot);
+    chunk.emit(OpCode::LOAD_VAR, firstSlot + 1);
+    chunk.emit(op);
+    chunk.emit(OpCode::POP);
+}
+
+Chunk buildChunk(const Kernel& kernel) {
+    Chunk chunk;
+    uint32_t seven = chunk.addConstant(Value::makeInt(7));
+    uint32_t three = chunk.addConstant(Value::makeInt(3));
+    chunk.emit(OpCode::LOAD_CONST, seven);
+    chunk.emit(OpCode::STORE_VAR, 0);
+    chunk.emit(OpCode::LOAD_CONST, three);
+    chunk.emit(OpCode::STORE_VAR, 1);
+    chunk.emit(OpCode::LOAD_CONST, chunk.addConstant(Value::makeBool(true)));
+    chunk.emit(OpCode::STORE_VAR, 2);
+    chunk.emit(OpCode::LOAD_CONST, chunk.addConstant(Value::makeBool(false)));
+    chunk.emit(OpCode::STORE_VAR, 3);
+    for (int i = 0; i < kRepeat; i++) {
+        kernel.emit(chunk, seven);
+    }
+    chunk.emit(OpCode::HALT);
+    chunk.slotCount = 4;
+    return chunk;
+}
+
+double medianNanosPerInstruction(const Kernel& kernel) {
+    Chunk chunk = buildChunk(kernel);
+    VM vm;
+    std::vector<double> samples;
+    for (int run = 0; run < kRuns; run++) {
+        vm.loadProgram(chunk);
+        auto start = std::chrono::steady_clock::now();
+        vm.run();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        samples.push_back(ns / (static_cast<double>(kRepeat) * kernel.instructionsPerIteration));
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+}
+
+int main() {
+    std::vector<Kernel> kernels = {
+        {"LOAD_CONST+POP", 2, [](Chunk& c, uint32_t k) {
+            c.emit(OpCode::LOAD_CONST, k);
+            c.emit(OpCode::POP);
+        }},
+        {"LOAD_VAR+POP", 2, [](Chunk& c, uint32_t) {
+            c.emit(OpCode::LOAD_VAR, 0);
+            c.emit(OpCode::POP);
+        }},
+        {"LOAD_CONST+STORE_VAR", 2, [](Chunk& c, uint32_t k) {
+            c.emit(OpCode::LOAD_CONST, k);
+            c.emit(OpCode::STORE_VAR, 0);
+        }},
+        {"ADD_I64", 4, [](Chunk& c, uint32_t) { emitBinary(c, OpCode::ADD_I64); }},
+        {"MUL_I64", 4, [](Chunk& c, uint32_t) { emitBinary(c, OpCode::MUL_I64); }},
+        {"MOD_I64", 4, [](Chunk& c, uint32_t) { emitBinary(c, OpCode::MOD_I64); }},
+        {"LESS_I64", 4, [](Chunk& c, uint32_t) { emitBinary(c, OpCode::LESS_I64); }},
+        {"EQ_I64", 4, [](Chunk& c, uint32_t) { emitBinary(c, OpCode::EQ_I64); }},
+        {"AND", 4, [](Chunk& c, uint32_t) { emitBinary(c, OpCode::AND, 2); }},
+        {"NEG_I64", 3, [](Chunk& c, uint32_t) {
+            c.emit(OpCode::LOAD_VAR, 0);
+            c.emit(OpCode::NEG_I64);
+            c.emit(OpCode::POP);
+        }},
+        {"JUMP", 1, [](Chunk& c, uint32_t) {
+            size_t jump = c.emitJump(OpCode::JUMP);
+            c.patchJump(jump, c.code.size());
+        }},
+        {"JUMP_IF_FALSE", 2, [](Chunk& c, uint32_t) {
+            c.emit(OpCode::LOAD_VAR, 2);
+            size_t jump = c.emitJump(OpCode::JUMP_IF_FALSE);
+            c.patchJump(jump, c.code.size());
+        }},
+    };
+
+#if MEOW_THREADED_DISPATCH
+    std::printf("dispatch: threaded (computed goto)\n");
+#else
+    std::printf("dispatch: switch\n");
+#endif
+    std::printf("%-22s %12s\n", "kernel", "ns/instr");
+    for (const auto& kernel : kernels) {
+        std::printf("%-22s %12.2f\n", kernel.name, medianNanosPerInstruction(kernel));
+    }
+    return 0;
+}
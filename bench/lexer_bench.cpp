@@ -0,0 +1,112 @@
+// Measures Lexer throughput in MB/s on large generated sources, once for
+// every scanner level the CPU supports (see lexscan.h). Pass a .meow file
+// to lex that instead.
+//
+//   cmake -S . -B build -DMEOW_BUILD_BENCHMARKS=ON [-DMEOW_SIMD_LEXER=OFF]
+//   cmake --build build && ./build/meow-lexer-bench [file.meow]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "lexer.h"
+#include "lexscan.h"
+#include "mappedfile.h"
+
+namespace {
+const size_t kTargetSize = 32 * 1024 * 1024;
+const int kRuns = 7;
+
+struct Corpus {
+    const char* name;
+    std::string text;
+};
+
+std::string repeatToSize(const std::string& unit) {
+    std::string text;
+    text.reserve(kTargetSize + unit.size());
+    while (text.size() < kTargetSize) {
+        text += unit;
+    }
+    return text;
+}
+
+// Short statements, the shape of machine-generated scripts.
+std::string denseSource() {
+    return repeatToSize("int a = 3; int b = 4; c = a * b + c - d; d = c % 7 + a;\n"
+                        "if (c > d) { meow << c; }\n");
+}
+
+// Indented blocks, long names and string literals.
+std::string proseSource() {
+    return repeatToSize("if (remaining_budget_in_whiskers >= minimum_treat_threshold) {\n"
+                        "        meow << \"the cat has been fed and is now asleep on the keyboard\";\n"
+                        "        deci average_nap_length_in_minutes = 12345.678;\n"
+                        "        remaining_budget_in_whiskers = remaining_budget_in_whiskers - 1;\n"
+                        "}\n");
+}
+
+struct Result {
+    double megabytesPerSecond;
+    size_t tokens;
+    uint64_t checksum;
+};
+
+Result lexAll(std::string_view source) {
+    std::vector<double> samples;
+    size_t tokens = 0;
+    uint64_t checksum = 0;
+    for (int run = 0; run < kRuns; run++) {
+        tokens = 0;
+        checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        Lexer lexer(source);
+        for (Token token = lexer.next(); token.type != TokenType::END_OF_FILE; token = lexer.next()) {
+            tokens++;
+            checksum = checksum * 31 + token.offset + token.length * 7 + static_cast<uint64_t>(token.type) +
+                       static_cast<uint64_t>(token.line);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        samples.push_back(static_cast<double>(source.size()) / (1024.0 * 1024.0) / seconds);
+    }
+    std::sort(samples.begin(), samples.end());
+    return Result{samples[samples.size() / 2], tokens, checksum};
+}
+}
+
+int main(int argc, char* argv[]) {
+    MappedFile file;
+    std::vector<Corpus> corpora;
+    if (argc > 1) {
+        file = MappedFile(argv[1]);
+        corpora.push_back({argv[1], std::string(reinterpret_cast<const char*>(file.data()), file.size())});
+    } else {
+        corpora.push_back({"dense", denseSource()});
+        corpora.push_back({"prose", proseSource()});
+    }
+
+    std::vector<ScanLevel> levels = {ScanLevel::SCALAR};
+    if (detectScanLevel() >= ScanLevel::SSE2) levels.push_back(ScanLevel::SSE2);
+    if (detectScanLevel() >= ScanLevel::AVX2) levels.push_back(ScanLevel::AVX2);
+
+    std::printf("%-10s %-8s %10s %12s\n", "corpus", "scanner", "MB/s", "tokens");
+    for (const auto& corpus : corpora) {
+        uint64_t expected = 0;
+        for (ScanLevel level : levels) {
+            setScanLevel(level);
+            Result result = lexAll(corpus.text);
+            if (level == levels.front()) {
+                expected = result.checksum;
+            } else if (result.checksum != expected) {
+                std::fprintf(stderr, "%s: %s scanner produced different tokens\n", corpus.name, scanLevelName(level));
+                return 1;
+            }
+            std::printf("%-10s %-8s %10.1f %12zu\n", corpus.name, scanLevelName(level),
+                        result.megabytesPerSecond, result.tokens);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,425 @@
+// End-to-end benchmark of the whole pipeline, timed one phase at a time on
+// generated workloads, or on the .meow files given instead. Every phase is
+// repeated on fresh inputs and reported as median and p99 wall time plus
+// source throughput; --json prints the same numbers for comparing builds.
+//
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release -DMEOW_BUILD_BENCHMARKS=ON
+//   cmake --build build && ./build/meow-bench [--runs=N] [--scale=F] [--only=NAME] [--json] [file.meow...]
+//
+// Phases:
+//   lex          Lexer::next() up to END_OF_FILE
+//   parse        Parser::parse(), which pulls its tokens, so lexing included
+//   check        TypeChecker::check()
+//   optimize     the -O1 Optimizer
+//   compile      Compiler::compile() on the optimized tree
+//   run          VM::run() of that chunk
+//   compile-reg  Compiler::compileRegisters()
+//   run-reg      VM::run() of the register chunk
+//   compile-ir   Compiler::compile() through the IR and all its passes (-O2)
+//   run-ir       VM::run() of the chunk lowered from the IR
+// Printed output goes to the null device during the run phases.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+#include "compiler.h"
+#include "lexer.h"
+#include "mappedfile.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "vm.h"
+
+namespace {
+#ifdef _WIN32
+const char* kNullDevice = "NUL";
+#else
+const char* kNullDevice = "/dev/null";
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int runs = 10;
+    double scale = 1.0;
+    bool json = false;
+    std::string only;
+    std::vector<std::string> files;
+};
+
+struct Workload {
+    std::string name;
+    std::string source;
+    size_t lines;
+    size_t tokens;
+};
+
+struct Phase {
+    const char* name;
+    double medianMs;
+    double p99Ms;
+    double minMs;
+};
+
+struct Report {
+    const Workload* workload;
+    std::vector<Phase> phases;
+};
+
+size_t scaled(size_t count, double scale) {
+    return std::max<size_t>(1, static_cast<size_t>(static_cast<double>(count) * scale));
+}
+
+// The generated programs reassign their inputs at the end so that -O1
+// cannot fold them away, and print a single result.
+
+// Assignments of arithmetic expressions nested 24 deep.
+std::string expressionsSource(double scale) {
+    const char* ops[] = {" + ", " * ", " - ", " % "};
+    std::string source = "int a = 7;\nint b = 3;\nint x = 0;\ndeci d = 1.5;\n";
+    for (size_t line = 0, count = scaled(40000, scale); line < count; line++) {
+        std::string expr = line % 2 ? "a" : "b";
+        for (int depth = 0; depth < 24; depth++) {
+            const char* op = ops[(line + depth) % 4];
+            // Only the constant right operands of % are ever divisors.
+            std::string right = op[1] == '%' ? std::to_string(depth + 2) : (depth % 3 ? "b" : "x");
+            expr = "(" + expr + op + right + ")";
+        }
+        source += line % 8 == 7 ? "d = d * 0.5 + " + expr + ";\n" : "x = " + expr + ";\n";
+    }
+    source += "a = a + 1;\nb = b + 1;\nmeow << x;\n";
+    return source;
+}
+
+// One declaration per variable, each reading the previous one.
+std::string variablesSource(double scale) {
+    std::string source = "int v0 = 1;\n";
+    size_t count = std::min<size_t>(scaled(50000, scale), 60000);
+    for (size_t i = 1; i < count; i++) {
+        std::string previous = "v" + std::to_string(i - 1);
+        source += "int v" + std::to_string(i) + " = " + previous + " * 3 + " + std::to_string(i % 100) + ";\n";
+    }
+    source += "v0 = 2;\nmeow << v" + std::to_string(count - 1) + ";\n";
+    return source;
+}
+
+// Long runs of `if` statements, some nested, with blocks as bodies.
+std::string ifChainsSource(double scale) {
+    std::string source = "int x = 0;\nint y = 100000;\nbool flag = true;\n";
+    for (size_t i = 0, count = scaled(150000, scale); i < count; i++) {
+        std::string n = std::to_string(i % 1000);
+        switch (i % 3) {
+            case 0: source += "if (x < " + n + ") { x = x + 3; }\n"; break;
+            case 1: source += "if (flag && y > " + n + ") { y = y - 1; flag = !flag; }\n"; break;
+            default:
+                source += "if (x > y) { if (flag) { x = x - y; } }\n";
+                break;
+        }
+    }
+    source += "flag = false;\nmeow << x + y;\n";
+    return source;
+}
+
+// 2 KB string literals, compared and concatenated.
+std::string stringsSource(double scale) {
+    std::string text;
+    while (text.size() < 2048) {
+        text += "the cat sat on the warm keyboard and typed ";
+    }
+    std::string source = "string all = \"\";\nbool same = false;\n";
+    for (size_t i = 0, count = scaled(5000, scale); i < count; i++) {
+        std::string name = "s" + std::to_string(i);
+        source += "string " + name + " = \"" + text + std::to_string(i) + "\";\n";
+        source += "same = " + name + " == all;\n";
+        source += i % 50 == 0 ? "all = " + name + ";\n" : "all = all + \"" + std::to_string(i) + "\";\n";
+    }
+    source += "meow << same;\n";
+    return source;
+}
+
+// A million short statements of every kind.
+std::string millionLinesSource(double scale) {
+    std::string source = "int x = 0;\nint y = 1;\ndeci d = 0.0;\nbool flag = false;\nchar c = 'a';\n";
+    for (size_t i = 0, count = scaled(1000000, scale); i < count; i++) {
+        switch (i % 6) {
+            case 0: source += "x = x + 1;\n"; break;
+            case 1: source += "y = y * 3 % 1000;\n"; break;
+            case 2: source += "d = d + 0.5;\n"; break;
+            case 3: source += "flag = !flag;\n"; break;
+            case 4: source += "if (x > y) { x = x - y; }\n"; break;
+            default: source += "flag = c == 'a' || x < 10;\n"; break;
+        }
+    }
+    source += "meow << x;\n";
+    return source;
+}
+
+size_t countLines(std::string_view source) {
+    return static_cast<size_t>(std::count(source.begin(), source.end(), '\n'));
+}
+
+size_t countTokens(std::string_view source) {
+    Lexer lexer(source);
+    size_t tokens = 0;
+    for (Token token = lexer.next(); token.type != TokenType::END_OF_FILE; token = lexer.next()) {
+        tokens++;
+    }
+    return tokens;
+}
+
+std::vector<StmtPtr> parseProgram(std::string_view source, Arena& arena) {
+    Lexer lexer(source);
+    Parser parser(lexer, arena);
+    return parser.parse();
+}
+
+std::vector<StmtPtr> checkedProgram(std::string_view source, Arena& arena) {
+    auto ast = parseProgram(source, arena);
+    TypeChecker().check(ast);
+    return ast;
+}
+
+std::vector<StmtPtr> optimizedProgram(std::string_view source, Arena& arena) {
+    return Optimizer(arena).optimize(checkedProgram(source, arena));
+}
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Runs `once` the given number of times; it returns the milliseconds of
+// the part it timed.
+Phase measure(const char* name, int runs, const std::function<double()>& once) {
+    std::vector<double> samples;
+    samples.reserve(runs);
+    for (int run = 0; run < runs; run++) {
+        samples.push_back(once());
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t p99 = static_cast<size_t>(std::ceil(0.99 * static_cast<double>(samples.size()))) - 1;
+    return Phase{name, samples[samples.size() / 2], samples[p99], samples.front()};
+}
+
+template <typename Program>
+double runOnce(const Program& program, std::FILE* sink) {
+    VM vm;
+    vm.outputSink().setFile(sink);
+    vm.outputSink().setPolicy(FlushPolicy::FULL);
+    vm.loadProgram(program);
+    auto start = Clock::now();
+    vm.run();
+    return millisecondsSince(start);
+}
+
+Report benchmark(const Workload& workload, int runs, std::FILE* sink) {
+    std::string_view source = workload.source;
+    Report report{&workload, {}};
+
+    report.phases.push_back(measure("lex", runs, [&] {
+        auto start = Clock::now();
+        Lexer lexer(source);
+        size_t tokens = 0;
+        for (Token token = lexer.next(); token.type != TokenType::END_OF_FILE; token = lexer.next()) {
+            tokens++;
+        }
+        double ms = millisecondsSince(start);
+        if (tokens != workload.tokens) throw std::runtime_error("lexer is not deterministic");
+        return ms;
+    }));
+    report.phases.push_back(measure("parse", runs, [&] {
+        Arena arena;
+        auto start = Clock::now();
+        parseProgram(source, arena);
+        return millisecondsSince(start);
+    }));
+    report.phases.push_back(measure("check", runs, [&] {
+        Arena arena;
+        auto ast = parseProgram(source, arena);
+        auto start = Clock::now();
+        TypeChecker().check(ast);
+        return millisecondsSince(start);
+    }));
+    report.phases.push_back(measure("optimize", runs, [&] {
+        Arena arena;
+        auto ast = checkedProgram(source, arena);
+        auto start = Clock::now();
+        Optimizer(arena).optimize(ast);
+        return millisecondsSince(start);
+    }));
+
+    // The compiler only reads the tree, so one is shared by both backends.
+    Arena arena;
+    auto ast = optimizedProgram(source, arena);
+    report.phases.push_back(measure("compile", runs, [&] {
+        auto start = Clock::now();
+        Chunk chunk = Compiler().compile(ast);
+        return millisecondsSince(start);
+    }));
+    Chunk chunk = Compiler().compile(ast);
+    report.phases.push_back(measure("run", runs, [&] { return runOnce(chunk, sink); }));
+
+    report.phases.push_back(measure("compile-reg", runs, [&] {
+        auto start = Clock::now();
+        RegisterChunk registers = Compiler().compileRegisters(ast);
+        return millisecondsSince(start);
+    }));
+    RegisterChunk registers = Compiler().compileRegisters(ast);
+    report.phases.push_back(measure("run-reg", runs, [&] { return runOnce(registers, sink); }));
+
+    IrSettings ir;
+    ir.enabled = true;
+    report.phases.push_back(measure("compile-ir", runs, [&] {
+        auto start = Clock::now();
+        Chunk lowered = Compiler(ir).compile(ast);
+        return millisecondsSince(start);
+    }));
+    Chunk lowered = Compiler(ir).compile(ast);
+    report.phases.push_back(measure("run-ir", runs, [&] { return runOnce(lowered, sink); }));
+    return report;
+}
+
+double megabytes(size_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+void printTable(const std::vector<Report>& reports, int runs) {
+    std::printf("%d runs per phase\n", runs);
+    for (const auto& report : reports) {
+        const Workload& w = *report.workload;
+        std::printf("\n%s: %.2f MB, %zu lines, %zu tokens\n", w.name.c_str(), megabytes(w.source.size()), w.lines,
+                    w.tokens);
+        std::printf("  %-12s %12s %12s %10s\n", "phase", "median ms", "p99 ms", "MB/s");
+        for (const auto& phase : report.phases) {
+            std::printf("  %-12s %12.3f %12.3f %10.1f\n", phase.name, phase.medianMs, phase.p99Ms,
+                        megabytes(w.source.size()) / (phase.medianMs / 1000.0));
+        }
+    }
+}
+
+std::string jsonString(std::string_view text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+void printJson(const std::vector<Report>& reports, int runs) {
+    std::printf("{\n  \"runs\": %d,\n  \"workloads\": [", runs);
+    for (size_t i = 0; i < reports.size(); i++) {
+        const Workload& w = *reports[i].workload;
+        std::printf("%s\n    {\n      \"name\": %s,\n      \"bytes\": %zu,\n      \"lines\": %zu,\n"
+                    "      \"tokens\": %zu,\n      \"phases\": [",
+                    i ? "," : "", jsonString(w.name).c_str(), w.source.size(), w.lines, w.tokens);
+        const auto& phases = reports[i].phases;
+        for (size_t j = 0; j < phases.size(); j++) {
+            std::printf("%s\n        {\"name\": \"%s\", \"median_ms\": %.4f, \"p99_ms\": %.4f, \"min_ms\": %.4f, "
+                        "\"mb_per_s\": %.2f}",
+                        j ? "," : "", phases[j].name, phases[j].medianMs, phases[j].p99Ms, phases[j].minMs,
+                        megabytes(w.source.size()) / (phases[j].medianMs / 1000.0));
+        }
+        std::printf("\n      ]\n    }");
+    }
+    std::printf("\n  ]\n}\n");
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--runs=", 0) == 0) {
+            options.runs = std::atoi(arg.c_str() + 7);
+            if (options.runs < 1) return false;
+        } else if (arg.rfind("--scale=", 0) == 0) {
+            options.scale = std::atof(arg.c_str() + 8);
+            if (!(options.scale > 0)) return false;
+        } else if (arg.rfind("--only=", 0) == 0) {
+            options.only = arg.substr(7);
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            return false;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    return true;
+}
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--runs=N] [--scale=F] [--only=NAME] [--json] [file.meow...]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<Workload> workloads;
+    auto add = [&](std::string name, std::string source) {
+        if (!options.only.empty() && name != options.only) return;
+        workloads.push_back(Workload{std::move(name), std::move(source), 0, 0});
+    };
+    try {
+        if (!options.files.empty()) {
+            for (const auto& path : options.files) {
+                MappedFile file(path);
+                add(path, std::string(reinterpret_cast<const char*>(file.data()), file.size()));
+            }
+        } else {
+            add("expressions", expressionsSource(options.scale));
+            add("variables", variablesSource(options.scale));
+            add("if-chains", ifChainsSource(options.scale));
+            add("strings", stringsSource(options.scale));
+            add("million-lines", millionLinesSource(options.scale));
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    if (workloads.empty()) {
+        std::fprintf(stderr, "no workload named %s\n", options.only.c_str());
+        return 2;
+    }
+
+    std::FILE* sink = std::fopen(kNullDevice, "w");
+    if (!sink) {
+        std::fprintf(stderr, "cannot open %s\n", kNullDevice);
+        return 1;
+    }
+
+    std::vector<Report> reports;
+    for (auto& workload : workloads) {
+        workload.lines = countLines(workload.source);
+        workload.tokens = countTokens(workload.source);
+        try {
+            reports.push_back(benchmark(workload, options.runs, sink));
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s: %s\n", workload.name.c_str(), e.what());
+            return 1;
+        }
+    }
+    std::fclose(sink);
+
+    if (options.json) {
+        printJson(reports, options.runs);
+    } else {
+        printTable(reports, options.runs);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Compiles every example with `meow emit-c` and the system C compiler and
+# checks that the native program prints the same output, errors and exit
+# status as `meow run`.
+
+BUILD_DIR="${1:-build}"
+CC="${CC:-cc}"
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+
+BIN_CANDIDATES=(
+  "$ROOT_DIR/$BUILD_DIR/meow"
+  "$ROOT_DIR/$BUILD_DIR/Release/meow"
+  "$ROOT_DIR/$BUILD_DIR/Debug/meow"
+)
+
+BIN_PATH=""
+for candidate in "${BIN_CANDIDATES[@]}"; do
+  if [ -f "$candidate" ]; then
+    BIN_PATH="$candidate"
+    break
+  fi
+done
+
+if [ -z "$BIN_PATH" ]; then
+  echo "Could not find meow binary in '$BUILD_DIR'. Build first with CMake."
+  exit 1
+fi
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+FAILED=0
+for source in "$ROOT_DIR"/examples/*.meow; do
+  name="$(basename "$source" .meow)"
+  "$BIN_PATH" emit-c "$source" -o "$WORK_DIR/$name.c"
+  "$CC" -O2 -std=c99 -o "$WORK_DIR/$name" "$WORK_DIR/$name.c" -lm
+
+  status=0
+  "$BIN_PATH" run "$source" > "$WORK_DIR/$name.expected" 2>&1 || status=$?
+  echo "exit $status" >> "$WORK_DIR/$name.expected"
+  status=0
+  "$WORK_DIR/$name" > "$WORK_DIR/$name.actual" 2>&1 || status=$?
+  echo "exit $status" >> "$WORK_DIR/$name.actual"
+
+  if diff -u "$WORK_DIR/$name.expected" "$WORK_DIR/$name.actual"; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name"
+    FAILED=1
+  fi
+done
+
+exit "$FAILED"
@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Runs every example with `meow run` and with `meow run --jit` and checks
+# that both engines print the same output, errors and exit status. A
+# failing example also fails the check, so errors are not compared away.
+
+BUILD_DIR="${1:-build}"
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+
+BIN_CANDIDATES=(
+  "$ROOT_DIR/$BUILD_DIR/meow"
+  "$ROOT_DIR/$BUILD_DIR/Release/meow"
+  "$ROOT_DIR/$BUILD_DIR/Debug/meow"
+)
+
+BIN_PATH=""
+for candidate in "${BIN_CANDIDATES[@]}"; do
+  if [ -f "$candidate" ]; then
+    BIN_PATH="$candidate"
+    break
+  fi
+done
+
+if [ -z "$BIN_PATH" ]; then
+  echo "Could not find meow binary in '$BUILD_DIR'. Build first with CMake."
+  exit 1
+fi
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+FAILED=0
+for source in "$ROOT_DIR"/examples/*.meow; do
+  name="$(basename "$source" .meow)"
+
+  status=0
+  "$BIN_PATH" run --no-cache "$source" > "$WORK_DIR/$name.expected" 2>&1 || status=$?
+  echo "exit $status" >> "$WORK_DIR/$name.expected"
+  interpreted=$status
+  status=0
+  "$BIN_PATH" run --no-cache --jit "$source" > "$WORK_DIR/$name.actual" 2>&1 || status=$?
+  echo "exit $status" >> "$WORK_DIR/$name.actual"
+
+  if ! diff -u "$WORK_DIR/$name.expected" "$WORK_DIR/$name.actual"; then
+    echo "FAIL $name"
+    FAILED=1
+  elif [ "$interpreted" -ne 0 ]; then
+    echo "FAIL $name (exit $interpreted)"
+    cat "$WORK_DIR/$name.expected"
+    FAILED=1
+  else
+    echo "ok   $name"
+  fi
+done
+
+exit "$FAILED"
@@ -0,0 +1,91 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Feeds REPL sessions whose lines depend on what earlier lines left behind
+# to `meow repl`, under both backends and at every optimization level,
+# and checks what they print. A line that fails must leave its globals
+# with values of their declared types.
+
+BUILD_DIR="${1:-build}"
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+
+BIN_CANDIDATES=(
+  "$ROOT_DIR/$BUILD_DIR/meow"
+  "$ROOT_DIR/$BUILD_DIR/Release/meow"
+  "$ROOT_DIR/$BUILD_DIR/Debug/meow"
+)
+
+BIN_PATH=""
+for candidate in "${BIN_CANDIDATES[@]}"; do
+  if [ -f "$candidate" ]; then
+    BIN_PATH="$candidate"
+    break
+  fi
+done
+
+if [ -z "$BIN_PATH" ]; then
+  echo "Could not find meow binary in '$BUILD_DIR'. Build first with CMake."
+  exit 1
+fi
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+FAILED=0
+
+# check NAME INPUT EXPECTED: output and errors, without the banner and
+# prompts, followed by the exit status.
+check() {
+  local name="$1" input="$2" expected="$3"
+  printf '%s\nexit 0\n' "$expected" > "$WORK_DIR/expected"
+  for backend in stack register; do
+    for level in -O0 -O1 -O2; do
+      local status=0
+      printf '%s\n' "$input" | "$BIN_PATH" --backend=$backend $level --flush=line repl \
+        > "$WORK_DIR/output" 2>&1 || status=$?
+      sed -e 's/meow> //g' -e '/^MeowLang REPL/d' -e '/^$/d' "$WORK_DIR/output" > "$WORK_DIR/actual"
+      echo "exit $status" >> "$WORK_DIR/actual"
+      if ! diff -u "$WORK_DIR/expected" "$WORK_DIR/actual"; then
+        echo "FAIL $name ($backend $level)"
+        FAILED=1
+        return
+      fi
+    done
+  done
+  echo "ok   $name"
+}
+
+# A string temporary used to sit in the register `y` then took.
+check "failed declaration after a temporary" \
+'string s = "abcdefghijklmnop";
+meow << s + s;
+int y = 1 / 0;
+meow << y + 1;' \
+'abcdefghijklmnopabcdefghijklmnop
+Error: Division by zero
+1'
+
+check "failed declaration in a closed scope's slot" \
+'{ string t = "abcdefghijklmnop"; }
+int y = 1 / 0;
+meow << y;
+meow << y + 1;' \
+'Error: Division by zero
+0
+1'
+
+check "failed redeclaration with another type" \
+'string z = "abcdefghijklmnopq";
+int z = 1 / 0;
+meow << z + 2;' \
+'Error: Division by zero
+2'
+
+check "failed redeclaration that reads the old value" \
+'int w = 7;
+int w = w / 0;
+meow << w;' \
+'Error: Division by zero
+7'
+
+exit "$FAILED"
@@ -0,0 +1,31 @@
+// Replacement global operator new and delete for the meow executable, so
+// that `--stats` can count heap allocations (see AllocationCounter). The
+// array and nothrow forms default to these. Over-aligned types go
+// through the default aligned operators and are not counted; nothing in
+// the tree allocates them.
+
+#include "stats.h"
+#include <cstdlib>
+#include <new>
+
+void* operator new(std::size_t size) {
+    AllocationCounter::record(size);
+    for (;;) {
+        if (void* memory = std::malloc(size ? size : 1)) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
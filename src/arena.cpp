@@ -0,0 +1,44 @@
+#include "arena.h"
+#include <algorithm>
+
+Arena::Arena()
+    : current(0), cursor(nullptr), limit(nullptr) {}
+
+void* Arena::allocateSlow(size_t size, size_t align) {
+    // Move on to the next retained block that fits, or add a new one.
+    size_t needed = size + align;
+    size_t next = cursor ? current + 1 : 0;
+    while (next < blocks.size() && blocks[next].size < needed) {
+        next++;
+    }
+    if (next >= blocks.size()) {
+        Block block;
+        block.size = std::max(kBlockSize, needed);
+        block.data.reset(new char[block.size]);
+        blocks.push_back(std::move(block));
+        next = blocks.size() - 1;
+    } else if (next != current + 1 && cursor) {
+        // Keep blocks in fill order so reset() can rewind them all.
+        std::swap(blocks[current + 1], blocks[next]);
+        next = current + 1;
+    }
+
+    current = next;
+    cursor = blocks[current].data.get();
+    limit = cursor + blocks[current].size;
+    return allocate(size, align);
+}
+
+void Arena::reset() {
+    current = 0;
+    cursor = nullptr;
+    limit = nullptr;
+}
+
+size_t Arena::bytesAllocated() const {
+    size_t total = 0;
+    for (const auto& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
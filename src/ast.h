@@ -1,89 +1,182 @@
 #ifndef AST_H
 #define AST_H
 
-#include <memory>
-#include <string>
-#include <vector>
+#include "value.h"
+#include <cstdint>
+#include <string_view>
+
+// AST nodes are allocated in an Arena (see arena.h) owned by whoever
+// drives the compilation and are released all at once when it is reset.
+// They are therefore trivially destructible: children are plain pointers,
+// names and string literals are string_views into the source text. Every
+// node records its NodeKind so passes switch on it instead of casting.
+
+enum class NodeKind : uint8_t {
+    // Expressions
+    LITERAL,
+    VARIABLE,
+    BINARY,
+    UNARY,
+
+    // Statements
+    PRINT,
+    VAR_DECL,
+    EXPR_STMT,
+    BLOCK,
+    IF
+};
+
+enum class BinaryOp : uint8_t {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+
+    AND,
+    OR,
+
+    ASSIGN
+};
+
+enum class UnaryOp : uint8_t {
+    NEGATE,
+    NOT
+};
+
+inline bool isArithmetic(BinaryOp op) { return op <= BinaryOp::MOD; }
+inline bool isComparison(BinaryOp op) { return op >= BinaryOp::EQUAL && op <= BinaryOp::GREATER_EQUAL; }
+
+// Source spelling, for error messages and dumps.
+inline const char* binaryOpSymbol(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::ADD: return "+";
+        case BinaryOp::SUB: return "-";
+        case BinaryOp::MUL: return "*";
+        case BinaryOp::DIV: return "/";
+        case BinaryOp::MOD: return "%";
+        case BinaryOp::EQUAL: return "==";
+        case BinaryOp::NOT_EQUAL: return "!=";
+        case BinaryOp::LESS: return "<";
+        case BinaryOp::LESS_EQUAL: return "<=";
+        case BinaryOp::GREATER: return ">";
+        case BinaryOp::GREATER_EQUAL: return ">=";
+        case BinaryOp::AND: return "&&";
+        case BinaryOp::OR: return "||";
+        case BinaryOp::ASSIGN: return "=";
+    }
+    return "?";
+}
 
 class ASTNode {
 public:
-    virtual ~ASTNode() = default;
-};
+    NodeKind kind;
+    int line = 0; // source line, for error messages
 
-using ASTNodePtr = std::shared_ptr<ASTNode>;
+protected:
+    explicit ASTNode(NodeKind k) : kind(k) {}
+};
 
 
 // ================= EXPRESSIONS =================
 
 class Expression : public ASTNode {
+public:
+    // Static type. Literals know theirs; the TypeChecker fills in the rest.
+    ValueType type = ValueType::INT;
+
+protected:
+    explicit Expression(NodeKind k) : ASTNode(k) {}
 };
 
-using ExprPtr = std::shared_ptr<Expression>;
+using ExprPtr = Expression*;
 
 class LiteralExpr : public Expression {
 public:
-    std::string value;
-    explicit LiteralExpr(const std::string& val) : value(val) {}
+    Value value;           // every type but STRING
+    std::string_view text; // STRING, and the decimal digits of a big INT
+
+    explicit LiteralExpr(const Value& v) : Expression(NodeKind::LITERAL), value(v) { type = v.type; }
+    explicit LiteralExpr(std::string_view s) : Expression(NodeKind::LITERAL), text(s) { type = ValueType::STRING; }
+
+    // An int that does not fit in 64 bits: `value` has inlineLength
+    // kHeapInt and no payload, and `text` holds the number.
+    bool isBig() const { return type == ValueType::INT && value.inlineLength == kHeapInt; }
 };
 
 class VariableExpr : public Expression {
 public:
-    std::string name;
-    explicit VariableExpr(const std::string& n) : name(n) {}
+    std::string_view name;
+    explicit VariableExpr(std::string_view n) : Expression(NodeKind::VARIABLE), name(n) {}
 };
 
 class BinaryExpr : public Expression {
 public:
     ExprPtr left;
-    std::string op;
+    BinaryOp op;
     ExprPtr right;
 
-    BinaryExpr(ExprPtr l, const std::string& o, ExprPtr r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
+    BinaryExpr(ExprPtr l, BinaryOp o, ExprPtr r)
+        : Expression(NodeKind::BINARY), left(l), op(o), right(r) {}
 };
 
 class UnaryExpr : public Expression {
 public:
-    std::string op;
+    UnaryOp op;
     ExprPtr right;
 
-    UnaryExpr(const std::string& o, ExprPtr r)
-        : op(o), right(std::move(r)) {}
+    UnaryExpr(UnaryOp o, ExprPtr r)
+        : Expression(NodeKind::UNARY), op(o), right(r) {}
 };
 
 
 // ================= STATEMENTS =================
 
 class Statement : public ASTNode {
+protected:
+    explicit Statement(NodeKind k) : ASTNode(k) {}
 };
 
-using StmtPtr = std::shared_ptr<Statement>;
+using StmtPtr = Statement*;
 
 class PrintStmt : public Statement {
 public:
     ExprPtr expression;
-    explicit PrintStmt(ExprPtr expr) : expression(std::move(expr)) {}
+    explicit PrintStmt(ExprPtr expr) : Statement(NodeKind::PRINT), expression(expr) {}
 };
 
 class VarDeclStmt : public Statement {
 public:
-    std::string type;
-    std::string name;
-    ExprPtr initializer;
+    ValueType type;
+    std::string_view name;
+    ExprPtr initializer; // may be null
 
-    VarDeclStmt(const std::string& t, const std::string& n, ExprPtr init)
-        : type(t), name(n), initializer(std::move(init)) {}
+    VarDeclStmt(ValueType t, std::string_view n, ExprPtr init)
+        : Statement(NodeKind::VAR_DECL), type(t), name(n), initializer(init) {}
 };
 
 class ExprStmt : public Statement {
 public:
     ExprPtr expression;
-    explicit ExprStmt(ExprPtr expr) : expression(std::move(expr)) {}
+    explicit ExprStmt(ExprPtr expr) : Statement(NodeKind::EXPR_STMT), expression(expr) {}
 };
 
 class BlockStmt : public Statement {
 public:
-    std::vector<StmtPtr> statements;
+    StmtPtr* statements; // arena array
+    uint32_t count;
+
+    BlockStmt(StmtPtr* s, uint32_t n) : Statement(NodeKind::BLOCK), statements(s), count(n) {}
+
+    StmtPtr* begin() const { return statements; }
+    StmtPtr* end() const { return statements + count; }
 };
 
 class IfStmt : public Statement {
@@ -92,7 +185,7 @@ public:
     StmtPtr thenBranch;
 
     IfStmt(ExprPtr cond, StmtPtr thenB)
-        : condition(std::move(cond)), thenBranch(std::move(thenB)) {}
+        : Statement(NodeKind::IF), condition(cond), thenBranch(thenB) {}
 };
 
 #endif
@@ -0,0 +1,446 @@
+#include "bigint.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+using Limbs = std::vector<uint32_t>;
+
+// Collections run after this many limbs, or after as many as the last one
+// kept alive if that is more.
+const size_t kCollectionFloor = 256 * 1024;
+
+void trimLimbs(Limbs& x) {
+    while (!x.empty() && x.back() == 0) x.pop_back();
+}
+
+// Length without leading zero limbs.
+size_t significant(const Limbs& x) {
+    size_t n = x.size();
+    while (n > 0 && x[n - 1] == 0) n--;
+    return n;
+}
+
+int leadingZeros(uint32_t x) {
+    int n = 0;
+    for (uint32_t bit = 0x80000000u; bit && !(x & bit); bit >>= 1) n++;
+    return n;
+}
+
+int compareMagnitudes(const Limbs& a, const Limbs& b) {
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (size_t i = a.size(); i-- > 0;) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+Limbs addMagnitudes(const uint32_t* a, size_t n, const uint32_t* b, size_t m) {
+    if (n < m) {
+        std::swap(a, b);
+        std::swap(n, m);
+    }
+    Limbs sum(n + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        carry += uint64_t{a[i]} + (i < m ? b[i] : 0);
+        sum[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    sum[n] = static_cast<uint32_t>(carry);
+    trimLimbs(sum);
+    return sum;
+}
+
+// a - b for a >= b.
+Limbs subtractMagnitudes(const Limbs& a, const Limbs& b) {
+    Limbs difference(a.size());
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        uint64_t d = uint64_t{a[i]} - (i < b.size() ? b[i] : 0) - borrow;
+        difference[i] = static_cast<uint32_t>(d);
+        borrow = d >> 63;
+    }
+    trimLimbs(difference);
+    return difference;
+}
+
+// r += x << (32 * offset); the sum must fit in r.
+void addAt(Limbs& r, size_t offset, const Limbs& x) {
+    size_t n = significant(x);
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < n; i++) {
+        carry += uint64_t{r[offset + i]} + x[i];
+        r[offset + i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    for (; carry; i++) {
+        carry += r[offset + i];
+        r[offset + i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+}
+
+// r -= x for r >= x.
+void subtractFrom(Limbs& r, const Limbs& x) {
+    size_t n = significant(x);
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < n || borrow; i++) {
+        uint64_t d = uint64_t{r[i]} - (i < n ? x[i] : 0) - borrow;
+        r[i] = static_cast<uint32_t>(d);
+        borrow = d >> 63;
+    }
+}
+
+Limbs multiplySchoolbook(const uint32_t* a, size_t n, const uint32_t* b, size_t m) {
+    Limbs product(n + m, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t digit = a[i];
+        if (digit == 0) continue;
+        uint64_t carry = 0;
+        for (size_t j = 0; j < m; j++) {
+            // At most (2^32 - 1)^2 + 2 (2^32 - 1), which is 2^64 - 1.
+            carry += digit * b[j] + product[i + j];
+            product[i + j] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        product[i + m] = static_cast<uint32_t>(carry);
+    }
+    return product;
+}
+
+// Karatsuba: with a = a1 B + a0 and b = b1 B + b0, the middle term
+// a1 b0 + a0 b1 is (a0 + a1)(b0 + b1) - a0 b0 - a1 b1, three half-size
+// products instead of four. An operand less than half as long as the
+// other is multiplied against it in pieces of its own length.
+Limbs multiplyMagnitudes(const uint32_t* a, size_t n, const uint32_t* b, size_t m) {
+    if (n < m) {
+        std::swap(a, b);
+        std::swap(n, m);
+    }
+    if (m < BigInt::kKaratsubaThreshold) {
+        return multiplySchoolbook(a, n, b, m);
+    }
+    if (2 * m <= n) {
+        Limbs product(n + m, 0);
+        for (size_t i = 0; i < n; i += m) {
+            addAt(product, i, multiplyMagnitudes(a + i, std::min(m, n - i), b, m));
+        }
+        return product;
+    }
+
+    size_t half = n / 2; // m > half
+    Limbs low = multiplyMagnitudes(a, half, b, half);
+    Limbs high = multiplyMagnitudes(a + half, n - half, b + half, m - half);
+    Limbs aSum = addMagnitudes(a, half, a + half, n - half);
+    Limbs bSum = addMagnitudes(b, half, b + half, m - half);
+    Limbs middle = multiplyMagnitudes(aSum.data(), aSum.size(), bSum.data(), bSum.size());
+    subtractFrom(middle, low);
+    subtractFrom(middle, high);
+
+    Limbs product(n + m, 0);
+    addAt(product, 0, low);
+    addAt(product, half, middle);
+    addAt(product, 2 * half, high);
+    return product;
+}
+
+// x = x * factor + addend.
+void multiplyAdd(Limbs& x, uint32_t factor, uint32_t addend) {
+    uint64_t carry = addend;
+    for (uint32_t& limb : x) {
+        carry += uint64_t{limb} * factor;
+        limb = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    if (carry) x.push_back(static_cast<uint32_t>(carry));
+}
+
+// x = x / divisor; returns the remainder.
+uint32_t divideSmall(Limbs& x, uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (size_t i = x.size(); i-- > 0;) {
+        uint64_t current = remainder << 32 | x[i];
+        x[i] = static_cast<uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    trimLimbs(x);
+    return static_cast<uint32_t>(remainder);
+}
+
+// Knuth's algorithm D (TAOCP 4.3.1) for u >= v and v of two limbs or
+// more: normalize so v's top bit is set, then estimate each quotient limb
+// from the top two limbs of the remainder and correct it at most twice.
+void divideMagnitudes(const Limbs& u, const Limbs& v, Limbs& quotient, Limbs& remainder) {
+    size_t n = v.size();
+    size_t m = u.size();
+    int shift = leadingZeros(v.back());
+    auto shifted = [shift](uint32_t high, uint32_t low) {
+        return shift ? static_cast<uint32_t>(high << shift | low >> (32 - shift)) : high;
+    };
+
+    Limbs vn(n), un(m + 1);
+    for (size_t i = n - 1; i > 0; i--) vn[i] = shifted(v[i], v[i - 1]);
+    vn[0] = v[0] << shift;
+    un[m] = shifted(0, u[m - 1]);
+    for (size_t i = m - 1; i > 0; i--) un[i] = shifted(u[i], u[i - 1]);
+    un[0] = u[0] << shift;
+
+    const uint64_t base = uint64_t{1} << 32;
+    quotient.assign(m - n + 1, 0);
+    for (size_t j = m - n + 1; j-- > 0;) {
+        uint64_t numerator = uint64_t{un[j + n]} << 32 | un[j + n - 1];
+        uint64_t estimate = numerator / vn[n - 1];
+        uint64_t rest = numerator % vn[n - 1];
+        while (estimate >= base || estimate * vn[n - 2] > (rest << 32 | un[j + n - 2])) {
+            estimate--;
+            rest += vn[n - 1];
+            if (rest >= base) break;
+        }
+
+        int64_t borrow = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t product = estimate * vn[i];
+            int64_t t = static_cast<int64_t>(un[i + j]) - borrow - static_cast<int64_t>(product & 0xFFFFFFFFu);
+            un[i + j] = static_cast<uint32_t>(t);
+            borrow = static_cast<int64_t>(product >> 32) - (t >> 32);
+        }
+        int64_t t = static_cast<int64_t>(un[j + n]) - borrow;
+        un[j + n] = static_cast<uint32_t>(t);
+
+        if (t < 0) {
+            // The estimate was one too large: add v back.
+            estimate--;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                carry += uint64_t{un[i + j]} + vn[i];
+                un[i + j] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            un[j + n] = static_cast<uint32_t>(un[j + n] + carry);
+        }
+        quotient[j] = static_cast<uint32_t>(estimate);
+    }
+
+    remainder.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        remainder[i] = shift ? static_cast<uint32_t>(un[i] >> shift | uint64_t{un[i + 1]} << (32 - shift)) : un[i];
+    }
+    trimLimbs(quotient);
+    trimLimbs(remainder);
+}
+}
+
+BigInt::BigInt(int64_t value)
+    : negative(value < 0) {
+    uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    limbs = {static_cast<uint32_t>(magnitude), static_cast<uint32_t>(magnitude >> 32)};
+    trim();
+}
+
+void BigInt::trim() {
+    trimLimbs(limbs);
+    if (limbs.empty()) negative = false;
+}
+
+BigInt BigInt::parse(std::string_view text) {
+    BigInt value;
+    size_t i = 0;
+    bool negative = false;
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+        negative = text[0] == '-';
+        i = 1;
+    }
+    if (i == text.size()) {
+        throw std::runtime_error("Malformed integer: " + std::string(text));
+    }
+    // Nine digits at a time, the most a limb holds.
+    while (i < text.size()) {
+        size_t length = std::min<size_t>(9, text.size() - i);
+        uint32_t chunk = 0;
+        uint32_t scale = 1;
+        for (size_t k = 0; k < length; k++) {
+            char c = text[i + k];
+            if (c < '0' || c > '9') {
+                throw std::runtime_error("Malformed integer: " + std::string(text));
+            }
+            chunk = chunk * 10 + static_cast<uint32_t>(c - '0');
+            scale *= 10;
+        }
+        multiplyAdd(value.limbs, scale, chunk);
+        i += length;
+    }
+    value.negative = negative;
+    value.trim();
+    return value;
+}
+
+bool BigInt::toInt64(int64_t& out) const {
+    if (limbs.size() > 2) return false;
+    uint64_t magnitude = 0;
+    for (size_t i = 0; i < limbs.size(); i++) magnitude |= uint64_t{limbs[i]} << (32 * i);
+    const uint64_t limit = uint64_t{1} << 63;
+    if (negative) {
+        if (magnitude > limit) return false;
+        out = magnitude == limit ? INT64_MIN : -static_cast<int64_t>(magnitude);
+    } else {
+        if (magnitude >= limit) return false;
+        out = static_cast<int64_t>(magnitude);
+    }
+    return true;
+}
+
+double BigInt::toDouble() const {
+    if (limbs.empty()) return 0.0;
+    // The top 64 bits, with the lowest one set if anything below them is,
+    // round to the same double as the whole magnitude.
+    auto limb = [this](size_t i) { return i < limbs.size() ? uint64_t{limbs[i]} : 0; };
+    size_t bits = 32 * limbs.size() - static_cast<size_t>(leadingZeros(limbs.back()));
+    size_t shift = bits > 64 ? bits - 64 : 0;
+    size_t word = shift / 32;
+    unsigned offset = static_cast<unsigned>(shift % 32);
+    uint64_t low = limb(word) | limb(word + 1) << 32;
+    uint64_t mantissa = offset ? low >> offset | limb(word + 2) << (64 - offset) : low;
+    bool sticky = offset && (limb(word) & ((uint64_t{1} << offset) - 1));
+    for (size_t i = 0; i < word && !sticky; i++) sticky = limbs[i] != 0;
+    double value = std::ldexp(static_cast<double>(mantissa | (sticky ? 1 : 0)), static_cast<int>(shift));
+    return negative ? -value : value;
+}
+
+std::string BigInt::toString() const {
+    if (limbs.empty()) return "0";
+    Limbs rest = limbs;
+    std::vector<uint32_t> chunks; // base 10^9, least significant first
+    while (!rest.empty()) chunks.push_back(divideSmall(rest, 1000000000));
+
+    std::string text = negative ? "-" : "";
+    text += std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        std::string chunk = std::to_string(chunks[i]);
+        text.append(9 - chunk.size(), '0').append(chunk);
+    }
+    return text;
+}
+
+BigInt BigInt::operator-() const {
+    BigInt result = *this;
+    if (!result.limbs.empty()) result.negative = !negative;
+    return result;
+}
+
+BigInt operator+(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    if (a.negative == b.negative) {
+        result.limbs = addMagnitudes(a.limbs.data(), a.limbs.size(), b.limbs.data(), b.limbs.size());
+        result.negative = a.negative;
+    } else if (compareMagnitudes(a.limbs, b.limbs) >= 0) {
+        result.limbs = subtractMagnitudes(a.limbs, b.limbs);
+        result.negative = a.negative;
+    } else {
+        result.limbs = subtractMagnitudes(b.limbs, a.limbs);
+        result.negative = b.negative;
+    }
+    result.trim();
+    return result;
+}
+
+BigInt operator-(const BigInt& a, const BigInt& b) {
+    return a + -b;
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    if (a.isZero() || b.isZero()) return result;
+    result.limbs = multiplyMagnitudes(a.limbs.data(), a.limbs.size(), b.limbs.data(), b.limbs.size());
+    result.negative = a.negative != b.negative;
+    result.trim();
+    return result;
+}
+
+void BigInt::divide(const BigInt& a, const BigInt& b, BigInt* quotient, BigInt* remainder) {
+    if (b.isZero()) {
+        throw std::runtime_error("Division by zero");
+    }
+    Limbs q, r;
+    if (compareMagnitudes(a.limbs, b.limbs) < 0) {
+        r = a.limbs;
+    } else if (b.limbs.size() == 1) {
+        q = a.limbs;
+        uint32_t rest = divideSmall(q, b.limbs[0]);
+        if (rest) r.push_back(rest);
+    } else {
+        divideMagnitudes(a.limbs, b.limbs, q, r);
+    }
+    // Both are written last, since either may be `a` or `b`.
+    bool quotientNegative = a.negative != b.negative;
+    bool remainderNegative = a.negative;
+    if (quotient) {
+        quotient->limbs = std::move(q);
+        quotient->negative = quotientNegative;
+        quotient->trim();
+    }
+    if (remainder) {
+        remainder->limbs = std::move(r);
+        remainder->negative = remainderNegative;
+        remainder->trim();
+    }
+}
+
+int BigInt::compare(const BigInt& a, const BigInt& b) {
+    if (a.negative != b.negative) return a.negative ? -1 : 1;
+    int c = compareMagnitudes(a.limbs, b.limbs);
+    return a.negative ? -c : c;
+}
+
+BigIntHeap::BigIntHeap()
+    : allocated(0), nextCollection(kCollectionFloor) {}
+
+Value BigIntHeap::store(BigInt number) {
+    int64_t small;
+    if (number.toInt64(small)) {
+        return Value::makeInt(small);
+    }
+    uint32_t handle;
+    if (!freeNumbers.empty()) {
+        handle = freeNumbers.back();
+        freeNumbers.pop_back();
+    } else {
+        if (numbers.size() > UINT32_MAX) {
+            throw std::runtime_error("Too many big integers");
+        }
+        numbers.emplace_back();
+        used.push_back(false);
+        marked.push_back(false);
+        handle = static_cast<uint32_t>(numbers.size() - 1);
+    }
+    allocated += number.limbCount();
+    numbers[handle] = std::move(number);
+    used[handle] = true;
+
+    Value value = Value::makeInt(0);
+    value.inlineLength = kHeapInt;
+    value.as.big = handle;
+    return value;
+}
+
+void BigIntHeap::beginCollection() {
+    marked.assign(numbers.size(), false);
+}
+
+void BigIntHeap::sweep() {
+    size_t live = 0;
+    for (uint32_t handle = 0; handle < numbers.size(); handle++) {
+        if (!used[handle]) continue;
+        if (marked[handle]) {
+            live += numbers[handle].limbCount();
+            continue;
+        }
+        numbers[handle] = BigInt();
+        used[handle] = false;
+        freeNumbers.push_back(handle);
+    }
+    allocated = 0;
+    nextCollection = std::max(kCollectionFloor, live);
+}
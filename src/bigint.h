@@ -0,0 +1,90 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include "value.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Arbitrary-precision integer behind the `int` values that do not fit in
+// 64 bits: a sign and a magnitude in 32-bit limbs, least significant
+// first, without leading zero limbs (zero has none and is never negative).
+//
+// Division truncates and the remainder takes the dividend's sign, as with
+// int64_t. Multiplication switches from schoolbook to Karatsuba once both
+// operands have kKaratsubaThreshold limbs.
+class BigInt {
+private:
+    bool negative;
+    std::vector<uint32_t> limbs;
+
+    void trim();
+
+public:
+    static constexpr size_t kKaratsubaThreshold = 32;
+
+    BigInt() : negative(false) {}
+    explicit BigInt(int64_t value);
+    // Optional sign, then decimal digits; throws std::runtime_error
+    // otherwise.
+    static BigInt parse(std::string_view text);
+
+    bool isZero() const { return limbs.empty(); }
+    bool isNegative() const { return negative; }
+    size_t limbCount() const { return limbs.size(); }
+
+    // False when the value needs more than 64 bits.
+    bool toInt64(int64_t& out) const;
+    // Correctly rounded; infinite beyond the range of double.
+    double toDouble() const;
+    std::string toString() const;
+
+    BigInt operator-() const;
+    friend BigInt operator+(const BigInt& a, const BigInt& b);
+    friend BigInt operator-(const BigInt& a, const BigInt& b);
+    friend BigInt operator*(const BigInt& a, const BigInt& b);
+    // Either output may be null; `b` must not be zero.
+    static void divide(const BigInt& a, const BigInt& b, BigInt* quotient, BigInt* remainder);
+    static int compare(const BigInt& a, const BigInt& b);
+};
+
+// Storage behind the VM's big INT values, which name a BigInt here by
+// handle (Value::as.big, with inlineLength kHeapInt). Only values outside
+// the int64_t range are stored, so an INT with inlineLength 0 is always
+// the whole number. Collected like the StringHeap: the VM marks the roots
+// between beginCollection() and sweep().
+class BigIntHeap {
+private:
+    std::vector<BigInt> numbers;
+    std::vector<bool> used;
+    std::vector<bool> marked;
+    std::vector<uint32_t> freeNumbers;
+
+    size_t allocated;    // limbs stored since the last collection
+    size_t nextCollection;
+
+public:
+    BigIntHeap();
+
+    // A small INT when `value` fits in 64 bits, else a new heap value.
+    Value store(BigInt value);
+    const BigInt& get(const Value& value) const { return numbers[value.as.big]; }
+
+    // `scratch` holds a small INT's value so both kinds read the same way.
+    const BigInt& read(const Value& value, BigInt& scratch) const {
+        if (value.inlineLength == kHeapInt) return get(value);
+        scratch = BigInt(value.as.i);
+        return scratch;
+    }
+
+    bool shouldCollect() const { return allocated >= nextCollection; }
+    void beginCollection();
+    void mark(const Value& value) {
+        if (value.type == ValueType::INT && value.inlineLength == kHeapInt) marked[value.as.big] = true;
+    }
+    void sweep();
+};
+
+#endif
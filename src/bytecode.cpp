@@ -0,0 +1,197 @@
+#include "bytecode.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+const char* opCodeName(OpCode op) {
+    switch (op) {
+        case OpCode::LOAD_CONST: return "LOAD_CONST";
+        case OpCode::LOAD_VAR: return "LOAD_VAR";
+        case OpCode::STORE_VAR: return "STORE_VAR";
+        case OpCode::POP: return "POP";
+        case OpCode::ADD_I64: return "ADD_I64";
+        case OpCode::SUB_I64: return "SUB_I64";
+        case OpCode::MUL_I64: return "MUL_I64";
+        case OpCode::DIV_I64: return "DIV_I64";
+        case OpCode::MOD_I64: return "MOD_I64";
+        case OpCode::NEG_I64: return "NEG_I64";
+        case OpCode::ADD_F64: return "ADD_F64";
+        case OpCode::SUB_F64: return "SUB_F64";
+        case OpCode::MUL_F64: return "MUL_F64";
+        case OpCode::DIV_F64: return "DIV_F64";
+        case OpCode::MOD_F64: return "MOD_F64";
+        case OpCode::NEG_F64: return "NEG_F64";
+        case OpCode::I64_TO_F64: return "I64_TO_F64";
+        case OpCode::NOT: return "NOT";
+        case OpCode::EQ_I64: return "EQ_I64";
+        case OpCode::NE_I64: return "NE_I64";
+        case OpCode::LESS_I64: return "LESS_I64";
+        case OpCode::LESS_EQUAL_I64: return "LESS_EQUAL_I64";
+        case OpCode::GREATER_I64: return "GREATER_I64";
+        case OpCode::GREATER_EQUAL_I64: return "GREATER_EQUAL_I64";
+        case OpCode::EQ_F64: return "EQ_F64";
+        case OpCode::NE_F64: return "NE_F64";
+        case OpCode::LESS_F64: return "LESS_F64";
+        case OpCode::LESS_EQUAL_F64: return "LESS_EQUAL_F64";
+        case OpCode::GREATER_F64: return "GREATER_F64";
+        case OpCode::GREATER_EQUAL_F64: return "GREATER_EQUAL_F64";
+        case OpCode::ADD_STR: return "ADD_STR";
+        case OpCode::EQ_STR: return "EQ_STR";
+        case OpCode::NE_STR: return "NE_STR";
+        case OpCode::LESS_STR: return "LESS_STR";
+        case OpCode::LESS_EQUAL_STR: return "LESS_EQUAL_STR";
+        case OpCode::GREATER_STR: return "GREATER_STR";
+        case OpCode::GREATER_EQUAL_STR: return "GREATER_EQUAL_STR";
+        case OpCode::EQUAL: return "EQUAL";
+        case OpCode::NOT_EQUAL: return "NOT_EQUAL";
+        case OpCode::LESS: return "LESS";
+        case OpCode::LESS_EQUAL: return "LESS_EQUAL";
+        case OpCode::GREATER: return "GREATER";
+        case OpCode::GREATER_EQUAL: return "GREATER_EQUAL";
+        case OpCode::AND: return "AND";
+        case OpCode::OR: return "OR";
+        case OpCode::PRINT: return "PRINT";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::HALT: return "HALT";
+    }
+    return "UNKNOWN";
+}
+
+void Chunk::emit(OpCode op) {
+    code.push_back(static_cast<uint8_t>(op));
+}
+
+void Chunk::emit(OpCode op, uint32_t operand) {
+    code.push_back(static_cast<uint8_t>(op));
+    size_t width = operandWidth(op);
+    for (size_t i = 0; i < width; i++) {
+        code.push_back(static_cast<uint8_t>(operand >> (8 * i)));
+    }
+}
+
+size_t Chunk::emitJump(OpCode op) {
+    emit(op, 0);
+    return code.size() - 4;
+}
+
+void Chunk::patchJump(size_t at, size_t target) {
+    if (target > UINT32_MAX) {
+        throw std::runtime_error("Program too large: jump target out of range");
+    }
+    uint32_t value = static_cast<uint32_t>(target);
+    std::memcpy(&code[at], &value, sizeof(value));
+}
+
+void LineTable::add(size_t position, int line) {
+    uint32_t start = static_cast<uint32_t>(position);
+    uint32_t number = static_cast<uint32_t>(line);
+    // A run that never got an instruction is replaced.
+    if (!runs.empty() && runs.back().start == start) {
+        runs.pop_back();
+    }
+    if (runs.empty() || runs.back().line != number) {
+        runs.push_back(Run{start, number});
+    }
+}
+
+int LineTable::lineAt(size_t position) const {
+    auto after = std::upper_bound(runs.begin(), runs.end(), position,
+                                  [](size_t at, const Run& run) { return at < run.start; });
+    return after == runs.begin() ? 0 : static_cast<int>(std::prev(after)->line);
+}
+
+uint32_t ConstantPool::addConstant(const Value& value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value.as, sizeof(bits));
+    auto& index = constantIndex[static_cast<size_t>(value.type)];
+    auto it = index.find(bits);
+    if (it != index.end()) {
+        return it->second;
+    }
+    uint32_t slot = static_cast<uint32_t>(constants.size());
+    constants.push_back(value);
+    index.emplace(bits, slot);
+    return slot;
+}
+
+uint32_t ConstantPool::addBigInt(const std::string& digits) {
+    uint32_t text = addString(digits);
+    auto it = bigIntIndex.find(text);
+    if (it != bigIntIndex.end()) {
+        return it->second;
+    }
+    Value value = Value::makeInt(0);
+    value.inlineLength = kHeapInt;
+    value.as.s = text;
+    uint32_t slot = static_cast<uint32_t>(constants.size());
+    constants.push_back(value);
+    bigIntIndex.emplace(text, slot);
+    return slot;
+}
+
+uint32_t ConstantPool::addString(const std::string& text) {
+    auto it = stringIndex.find(text);
+    if (it != stringIndex.end()) {
+        return it->second;
+    }
+    uint32_t index = static_cast<uint32_t>(strings.size());
+    strings.push_back(text);
+    stringIndex.emplace(text, index);
+    return index;
+}
+
+Instruction Chunk::decode(size_t offset) const {
+    Instruction in;
+    in.op = static_cast<OpCode>(code[offset]);
+    in.offset = offset;
+    in.length = 1 + operandWidth(in.op);
+    in.operand = 0;
+    if (in.length == 3) {
+        in.operand = readU16(&code[offset + 1]);
+    } else if (in.length == 5) {
+        in.operand = readU32(&code[offset + 1]);
+    }
+    return in;
+}
+
+std::string describeConstant(const ConstantPool& pool, uint32_t index) {
+    if (index >= pool.constants.size()) {
+        return "?";
+    }
+    std::ostringstream out;
+    const Value& c = pool.constants[index];
+    switch (c.type) {
+        case ValueType::INT:
+            if (c.inlineLength != kHeapInt) {
+                out << c.as.i;
+            } else if (c.as.s < pool.strings.size()) {
+                out << pool.strings[c.as.s];
+            }
+            break;
+        case ValueType::DECI: out << c.as.d; break;
+        case ValueType::BOOL: out << (c.as.b ? "true" : "false"); break;
+        case ValueType::CHAR: out << "'" << c.as.c << "'"; break;
+        case ValueType::STRING:
+            if (c.as.s < pool.strings.size()) out << "\"" << pool.strings[c.as.s] << "\"";
+            break;
+    }
+    return out.str();
+}
+
+std::string disassemble(const Chunk& chunk) {
+    std::ostringstream out;
+    for (size_t offset = 0; offset < chunk.code.size();) {
+        Instruction in = chunk.decode(offset);
+        out << offset << "\t" << opCodeName(in.op);
+        if (in.length > 1) {
+            out << " " << in.operand;
+        }
+        if (in.op == OpCode::LOAD_CONST) {
+            out << "\t; " << describeConstant(chunk, in.operand);
+        }
+        out << "\n";
+        offset += in.length;
+    }
+    return out.str();
+}
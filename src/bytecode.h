@@ -1,23 +1,72 @@
 #ifndef BYTECODE_H
 #define BYTECODE_H
 
+#include "value.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-enum class OpCode {
+// Every opcode is one byte, followed by a fixed-width little-endian
+// immediate whose size depends only on the opcode (see operandWidth):
+//
+//   LOAD_CONST          u32 constant index
+//   LOAD_VAR, STORE_VAR u16 variable slot
+//   JUMP, JUMP_IF_FALSE u32 absolute byte offset of the target
+//
+// All other opcodes take no operand.
+//
+// Operations are specialized on the operand types the TypeChecker proved
+// (_I64 for ints, _F64 for decis, _STR for strings), so their handlers do
+// no runtime type tests. The unsuffixed comparisons are for bool and char.
+enum class OpCode : uint8_t {
     LOAD_CONST,
     LOAD_VAR,
     STORE_VAR,
+    POP,
 
-    ADD,
-    SUB,
-    MUL,
-    DIV,
-    MOD,
+    ADD_I64,
+    SUB_I64,
+    MUL_I64,
+    DIV_I64,
+    MOD_I64,
+    NEG_I64,
+
+    ADD_F64,
+    SUB_F64,
+    MUL_F64,
+    DIV_F64,
+    MOD_F64,
+    NEG_F64,
+
+    I64_TO_F64, // int on top of the stack to deci
 
-    NEG,
     NOT,
 
+    EQ_I64,
+    NE_I64,
+    LESS_I64,
+    LESS_EQUAL_I64,
+    GREATER_I64,
+    GREATER_EQUAL_I64,
+
+    EQ_F64,
+    NE_F64,
+    LESS_F64,
+    LESS_EQUAL_F64,
+    GREATER_F64,
+    GREATER_EQUAL_F64,
+
+    ADD_STR,
+    EQ_STR,
+    NE_STR,
+    LESS_STR,
+    LESS_EQUAL_STR,
+    GREATER_STR,
+    GREATER_EQUAL_STR,
+
     EQUAL,
     NOT_EQUAL,
     LESS,
@@ -36,12 +85,146 @@ enum class OpCode {
     HALT
 };
 
+constexpr int kOpCodeCount = static_cast<int>(OpCode::HALT) + 1;
+
+inline size_t operandWidth(OpCode op) {
+    switch (op) {
+        case OpCode::LOAD_CONST:
+        case OpCode::JUMP:
+        case OpCode::JUMP_IF_FALSE:
+            return 4;
+        case OpCode::LOAD_VAR:
+        case OpCode::STORE_VAR:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+// Stack entries an opcode pops. LOAD_CONST, LOAD_VAR and every operator
+// then push one result; STORE_VAR, POP, PRINT and the jumps push nothing.
+inline int stackInputs(OpCode op) {
+    switch (op) {
+        case OpCode::LOAD_CONST:
+        case OpCode::LOAD_VAR:
+        case OpCode::JUMP:
+        case OpCode::HALT:
+            return 0;
+        case OpCode::STORE_VAR:
+        case OpCode::POP:
+        case OpCode::NEG_I64:
+        case OpCode::NEG_F64:
+        case OpCode::I64_TO_F64:
+        case OpCode::NOT:
+        case OpCode::PRINT:
+        case OpCode::JUMP_IF_FALSE:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+// Stack entries an opcode pushes after popping its stackInputs().
+inline int stackOutputs(OpCode op) {
+    switch (op) {
+        case OpCode::STORE_VAR:
+        case OpCode::POP:
+        case OpCode::PRINT:
+        case OpCode::JUMP:
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::HALT:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+const char* opCodeName(OpCode op);
+
+inline uint16_t readU16(const uint8_t* p) {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t readU32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// One decoded instruction, for tools that walk the code stream.
 struct Instruction {
     OpCode op;
-    std::string operand;
+    uint32_t operand;
+    size_t offset;
+    size_t length;
+};
 
-    Instruction(OpCode o, const std::string& opd = "")
-        : op(o), operand(opd) {}
+// Source line of every instruction, kept as one run per stretch of
+// instructions from the same line. Positions are byte offsets into a
+// Chunk's code and instruction indexes into a RegisterChunk's.
+struct LineTable {
+    struct Run {
+        uint32_t start;
+        uint32_t line;
+    };
+    std::vector<Run> runs; // ascending by start
+
+    // Called before emitting the instruction at `position`.
+    void add(size_t position, int line);
+    // 0 when the position comes before any run.
+    int lineAt(size_t position) const;
+};
+
+// Deduplicated literals shared by every backend. STRING constants, and
+// INT constants that do not fit in 64 bits (inlineLength kHeapInt), store
+// an index into `strings`; the VM relocates them into its own heaps when
+// a program is loaded.
+struct ConstantPool {
+    std::vector<Value> constants;
+    std::vector<std::string> strings;
+
+    uint32_t addConstant(const Value& value);
+    uint32_t addString(const std::string& text);
+    // An INT that does not fit in 64 bits, from its decimal text.
+    uint32_t addBigInt(const std::string& digits);
+
+private:
+    // Deduplication indexes: constants by payload bits per ValueType, big
+    // ints by the index of their text.
+    std::unordered_map<uint64_t, uint32_t> constantIndex[5];
+    std::unordered_map<uint32_t, uint32_t> bigIntIndex;
+    std::unordered_map<std::string, uint32_t> stringIndex;
+};
+
+// Non-owning view of a stack-machine program, as executed by the VM. The
+// code may live in a Chunk or directly in a mapped .meowc file.
+struct ChunkView {
+    const uint8_t* code;
+    size_t codeSize;
+    const ConstantPool* pool;
+    uint32_t slotCount;
+    const LineTable* lines;
 };
 
+// A compiled stack-machine program: the code stream plus its constants.
+struct Chunk : ConstantPool {
+    std::vector<uint8_t> code;
+    uint32_t slotCount = 0; // variable slots the code may touch
+    LineTable lines;
+
+    ChunkView view() const { return ChunkView{code.data(), code.size(), this, slotCount, &lines}; }
+
+    void emit(OpCode op);
+    void emit(OpCode op, uint32_t operand);
+    size_t emitJump(OpCode op);
+    void patchJump(size_t at, size_t target);
+
+    Instruction decode(size_t offset) const;
+};
+
+std::string describeConstant(const ConstantPool& pool, uint32_t index);
+std::string disassemble(const Chunk& chunk);
+
 #endif
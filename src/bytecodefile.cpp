@@ -0,0 +1,211 @@
+#include "bytecodefile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+const char kMagic[8] = {'M', 'E', 'O', 'W', 'C', '\0', '\0', '\0'};
+
+void append(std::string& out, const void* data, size_t size) {
+    out.append(static_cast<const char*>(data), size);
+}
+
+template <typename T>
+T readAt(const uint8_t* base, size_t size, size_t& offset) {
+    if (offset > size || size - offset < sizeof(T)) {
+        throw std::runtime_error("Corrupt bytecode file: truncated");
+    }
+    T value;
+    std::memcpy(&value, base + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+}
+
+uint64_t hashSource(std::string_view source, int optimizationLevel) {
+    // FNV-1a over the bytecode and compiler versions and the optimization
+    // level, followed by the source text.
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(&kBytecodeVersion, sizeof(kBytecodeVersion));
+    mix(&kCompilerVersion, sizeof(kCompilerVersion));
+    mix(&optimizationLevel, sizeof(optimizationLevel));
+    mix(source.data(), source.size());
+    return hash;
+}
+
+void writeBytecodeFile(const std::string& path, const Chunk& chunk, uint64_t sourceHash) {
+    BytecodeHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kBytecodeVersion;
+    header.slotCount = chunk.slotCount;
+    header.sourceHash = sourceHash;
+    header.constantCount = static_cast<uint32_t>(chunk.constants.size());
+    header.stringCount = static_cast<uint32_t>(chunk.strings.size());
+    header.lineCount = static_cast<uint32_t>(chunk.lines.runs.size());
+    header.reserved = 0;
+    header.codeSize = chunk.code.size();
+
+    std::string body;
+    for (const auto& constant : chunk.constants) {
+        uint8_t entry[16] = {};
+        entry[0] = static_cast<uint8_t>(constant.type);
+        entry[1] = constant.inlineLength;
+        std::memcpy(entry + 8, &constant.as, sizeof(constant.as));
+        append(body, entry, sizeof(entry));
+    }
+    for (const auto& text : chunk.strings) {
+        uint32_t length = static_cast<uint32_t>(text.size());
+        append(body, &length, sizeof(length));
+        body += text;
+    }
+    for (const auto& run : chunk.lines.runs) {
+        append(body, &run.start, sizeof(run.start));
+        append(body, &run.line, sizeof(run.line));
+    }
+    while ((sizeof(header) + body.size()) % 8 != 0) {
+        body.push_back('\0');
+    }
+    header.codeOffset = sizeof(header) + body.size();
+
+    // Write to a unique temporary name first so a concurrent reader never
+    // maps a half-written file and concurrent writers do not collide.
+    std::string temp = path + ".tmp" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "." +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Could not write file: " + path);
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(body.data(), static_cast<std::streamsize>(body.size()));
+        out.write(reinterpret_cast<const char*>(chunk.code.data()),
+                  static_cast<std::streamsize>(chunk.code.size()));
+        if (!out) {
+            throw std::runtime_error("Could not write file: " + path);
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Could not write file: " + path);
+    }
+}
+
+std::string compileCachePath(uint64_t sourceHash) {
+    namespace fs = std::filesystem;
+    fs::path dir;
+    if (const char* custom = std::getenv("MEOW_CACHE_DIR")) {
+        dir = custom;
+    } else if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        dir = fs::path(xdg) / "meow";
+#ifdef _WIN32
+    } else if (const char* local = std::getenv("LOCALAPPDATA")) {
+        dir = fs::path(local) / "meow" / "cache";
+#endif
+    } else if (const char* home = std::getenv("HOME")) {
+        dir = fs::path(home) / ".cache" / "meow";
+    } else {
+        return "";
+    }
+
+    std::error_code error;
+    fs::create_directories(dir, error);
+    if (error) {
+        return "";
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.meowc", static_cast<unsigned long long>(sourceHash));
+    return (dir / name).string();
+}
+
+bool BytecodeFile::hasMagic(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)] = {};
+    in.read(magic, sizeof(magic));
+    return in && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+BytecodeFile::BytecodeFile(const std::string& path)
+    : file(path), code(nullptr) {
+    const uint8_t* base = file.data();
+    size_t size = file.size();
+    size_t offset = 0;
+
+    header = readAt<BytecodeHeader>(base, size, offset);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a MeowLang bytecode file: " + path);
+    }
+    if (header.version != kBytecodeVersion) {
+        throw std::runtime_error("Bytecode file was built by a different compiler version: " + path);
+    }
+
+    pool.constants.reserve(header.constantCount);
+    for (uint32_t i = 0; i < header.constantCount; i++) {
+        uint8_t entry[16];
+        if (size - offset < sizeof(entry)) {
+            throw std::runtime_error("Corrupt bytecode file: truncated");
+        }
+        std::memcpy(entry, base + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (entry[0] > static_cast<uint8_t>(ValueType::STRING) ||
+            (entry[1] != 0 && (entry[1] != kHeapInt || entry[0] != static_cast<uint8_t>(ValueType::INT)))) {
+            throw std::runtime_error("Corrupt bytecode file: bad constant");
+        }
+        Value value;
+        value.type = static_cast<ValueType>(entry[0]);
+        value.inlineLength = entry[1];
+        std::memcpy(&value.as, entry + 8, sizeof(value.as));
+        pool.constants.push_back(value);
+    }
+
+    pool.strings.reserve(header.stringCount);
+    for (uint32_t i = 0; i < header.stringCount; i++) {
+        uint32_t length = readAt<uint32_t>(base, size, offset);
+        if (length > size - offset) {
+            throw std::runtime_error("Corrupt bytecode file: truncated");
+        }
+        pool.strings.emplace_back(reinterpret_cast<const char*>(base + offset), length);
+        offset += length;
+    }
+
+    if (header.lineCount > (size - offset) / sizeof(LineTable::Run)) {
+        throw std::runtime_error("Corrupt bytecode file: truncated");
+    }
+    lines.runs.reserve(header.lineCount);
+    for (uint32_t i = 0; i < header.lineCount; i++) {
+        LineTable::Run run;
+        run.start = readAt<uint32_t>(base, size, offset);
+        run.line = readAt<uint32_t>(base, size, offset);
+        if (!lines.runs.empty() && run.start <= lines.runs.back().start) {
+            throw std::runtime_error("Corrupt bytecode file: bad line table");
+        }
+        lines.runs.push_back(run);
+    }
+
+    for (const auto& constant : pool.constants) {
+        bool hasText = constant.type == ValueType::STRING || constant.inlineLength == kHeapInt;
+        if (hasText && constant.as.s >= pool.strings.size()) {
+            throw std::runtime_error("Corrupt bytecode file: bad string index");
+        }
+    }
+
+    if (header.codeOffset < offset || header.codeOffset > size ||
+        header.codeSize > size - header.codeOffset) {
+        throw std::runtime_error("Corrupt bytecode file: bad code section");
+    }
+    code = base + header.codeOffset;
+}
@@ -0,0 +1,78 @@
+#ifndef BYTECODEFILE_H
+#define BYTECODEFILE_H
+
+#include "bytecode.h"
+#include "mappedfile.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// On-disk .meowc format (all fields little-endian):
+//
+//   header    BytecodeHeader
+//   constants constantCount x { u8 type, u8 inlineLength, 6 bytes zero,
+//                               8-byte payload } (see ConstantPool)
+//   strings   stringCount x { u32 length, bytes }
+//   lines     lineCount x { u32 code offset, u32 line } (see LineTable)
+//   padding   to an 8-byte boundary
+//   code      codeSize bytes, executed in place from the mapping
+//
+// kBytecodeVersion must be bumped whenever the opcode set, the operand
+// encoding or this layout changes; stale files are then rejected and the
+// compile cache misses.
+constexpr uint32_t kBytecodeVersion = 6;
+
+// kCompilerVersion identifies the code the compiler generates, separately
+// from the format. Bump it whenever the same source may compile to
+// different bytecode (a new optimization, a change in folding or code
+// generation) so that the compile cache misses instead of running code an
+// older compiler produced.
+constexpr uint32_t kCompilerVersion = 2;
+
+struct BytecodeHeader {
+    char magic[8];          // "MEOWC\0\0\0"
+    uint32_t version;       // kBytecodeVersion
+    uint32_t slotCount;
+    uint64_t sourceHash;    // hashSource() of the source it was built from
+    uint32_t constantCount;
+    uint32_t stringCount;
+    uint32_t lineCount;
+    uint32_t reserved;      // zero
+    uint64_t codeOffset;
+    uint64_t codeSize;
+};
+
+// Hash of a source text together with the bytecode and compiler versions
+// and the optimization level, used to key the compile cache and to detect
+// stale .meowc files.
+uint64_t hashSource(std::string_view source, int optimizationLevel);
+
+// Where the compile cache keeps the .meowc for a given source hash:
+// $MEOW_CACHE_DIR, else $XDG_CACHE_HOME/meow, else ~/.cache/meow. Returns an
+// empty string when no cache directory is available.
+std::string compileCachePath(uint64_t sourceHash);
+
+void writeBytecodeFile(const std::string& path, const Chunk& chunk, uint64_t sourceHash);
+
+// A .meowc file mapped into memory. The constant pool is decoded on open;
+// the code is executed directly from the mapping.
+class BytecodeFile {
+private:
+    MappedFile file;
+    ConstantPool pool;
+    LineTable lines;
+    BytecodeHeader header;
+    const uint8_t* code;
+
+public:
+    explicit BytecodeFile(const std::string& path);
+
+    static bool hasMagic(const std::string& path);
+
+    uint64_t sourceHash() const { return header.sourceHash; }
+    ChunkView view() const {
+        return ChunkView{code, static_cast<size_t>(header.codeSize), &pool, header.slotCount, &lines};
+    }
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "meow.h"
+#include "program.h"
+#include "vm.h"
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+
+// The C handles wrap the C++ objects; no C++ exception crosses the API.
+struct meow_program {
+    std::shared_ptr<const Program> program;
+};
+
+struct meow_vm {
+    VM vm;
+};
+
+namespace {
+thread_local std::string lastError;
+
+meow_status fail(const char* message) {
+    lastError = message;
+    return MEOW_ERROR;
+}
+
+// Runs `body`, turning an exception into MEOW_ERROR.
+template <typename Body>
+meow_status guarded(Body body) {
+    try {
+        body();
+        return MEOW_OK;
+    } catch (const std::exception& ex) {
+        return fail(ex.what());
+    } catch (...) {
+        return fail("Unknown error");
+    }
+}
+}
+
+extern "C" {
+
+int meow_api_version(void) {
+    return MEOW_API_VERSION;
+}
+
+meow_status meow_program_compile(const char* source, size_t size, int optimization_level,
+                                 meow_program** program) {
+    if (!program || (!source && size > 0)) {
+        return fail("Invalid argument");
+    }
+    *program = nullptr;
+    return guarded([&] {
+        auto compiled = Program::compile(std::string_view(source ? source : "", size), optimization_level);
+        *program = new meow_program{std::move(compiled)};
+    });
+}
+
+meow_status meow_program_load(const char* path, int optimization_level, meow_program** program) {
+    if (!program || !path) {
+        return fail("Invalid argument");
+    }
+    *program = nullptr;
+    return guarded([&] {
+        auto loaded = Program::load(path, optimization_level);
+        *program = new meow_program{std::move(loaded)};
+    });
+}
+
+void meow_program_free(meow_program* program) {
+    delete program;
+}
+
+meow_vm* meow_vm_new(meow_write_fn write, void* user_data) {
+    meow_vm* vm = nullptr;
+    try {
+        vm = new meow_vm;
+    } catch (const std::bad_alloc&) {
+        fail("Out of memory");
+        return nullptr;
+    }
+    if (write) {
+        vm->vm.outputSink().setWriter(write, user_data);
+        vm->vm.outputSink().setPolicy(FlushPolicy::FULL);
+    }
+    return vm;
+}
+
+void meow_vm_free(meow_vm* vm) {
+    delete vm;
+}
+
+meow_status meow_vm_run(meow_vm* vm, const meow_program* program) {
+    if (!vm || !program) {
+        return fail("Invalid argument");
+    }
+    return guarded([&] {
+        vm->vm.loadProgram(*program->program);
+        vm->vm.run();
+    });
+}
+
+const char* meow_last_error(void) {
+    return lastError.c_str();
+}
+
+}
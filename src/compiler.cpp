@@ -1,94 +1,781 @@
 #include "compiler.h"
-#include <memory>
+#include "bigint.h"
+#include "valueops.h"
+#include <algorithm>
+#include <stdexcept>
 
-std::vector<Instruction> Compiler::compile(const std::vector<StmtPtr>& statements) {
-    instructions.clear();
-    instructions.reserve(statements.size() * 2);
+namespace {
+const int kMaxSlots = UINT16_MAX + 1;
 
-    for (const auto& stmt : statements) {
+Value defaultValue(ValueType type) {
+    switch (type) {
+        case ValueType::DECI: return Value::makeDeci(0.0);
+        case ValueType::BOOL: return Value::makeBool(false);
+        case ValueType::CHAR: return Value::makeChar('\0');
+        default: return Value::makeInt(0);
+    }
+}
+
+uint32_t addLiteral(ConstantPool& pool, const LiteralExpr& literal) {
+    if (literal.type == ValueType::STRING) {
+        return pool.addConstant(Value::makeString(pool.addString(std::string(literal.text))));
+    }
+    if (literal.isBig()) {
+        return pool.addBigInt(std::string(literal.text));
+    }
+    return pool.addConstant(literal.value);
+}
+
+uint32_t addDefault(ConstantPool& pool, ValueType type) {
+    if (type == ValueType::STRING) {
+        return pool.addConstant(Value::makeString(pool.addString("")));
+    }
+    return pool.addConstant(defaultValue(type));
+}
+
+bool isNumeric(ValueType type) {
+    return type == ValueType::INT || type == ValueType::DECI;
+}
+
+// The type both operands of a binary operator are brought to before the
+// operation: ints are widened when the other side is a deci.
+ValueType operandType(const BinaryExpr& binary) {
+    ValueType left = binary.left->type;
+    ValueType right = binary.right->type;
+    if (isNumeric(left) && isNumeric(right)) {
+        return left == ValueType::DECI || right == ValueType::DECI ? ValueType::DECI : ValueType::INT;
+    }
+    return left;
+}
+
+// BinaryOp lists the arithmetic and comparison operators in the same order
+// as each typed opcode family, so the opcode is the family's first member
+// plus the operator's offset.
+OpCode binaryOpCode(BinaryOp op, ValueType operands) {
+    if (op == BinaryOp::AND) return OpCode::AND;
+    if (op == BinaryOp::OR) return OpCode::OR;
+
+    if (op == BinaryOp::ADD && operands == ValueType::STRING) return OpCode::ADD_STR;
+    if (isArithmetic(op)) {
+        int index = static_cast<int>(op) - static_cast<int>(BinaryOp::ADD);
+        OpCode first = operands == ValueType::INT ? OpCode::ADD_I64 : OpCode::ADD_F64;
+        return static_cast<OpCode>(static_cast<int>(first) + index);
+    }
+    if (isComparison(op)) {
+        int index = static_cast<int>(op) - static_cast<int>(BinaryOp::EQUAL);
+        OpCode first;
+        switch (operands) {
+            case ValueType::INT: first = OpCode::EQ_I64; break;
+            case ValueType::DECI: first = OpCode::EQ_F64; break;
+            case ValueType::STRING: first = OpCode::EQ_STR; break;
+            default: first = OpCode::EQUAL; break;
+        }
+        return static_cast<OpCode>(static_cast<int>(first) + index);
+    }
+    throw std::runtime_error(std::string("Unknown operator: ") + binaryOpSymbol(op));
+}
+
+// The typed operations are declared in the same order in both enums.
+static_assert(static_cast<int>(OpCode::OR) - static_cast<int>(OpCode::ADD_I64) ==
+              static_cast<int>(RegOp::OR) - static_cast<int>(RegOp::ADD_I64),
+              "OpCode and RegOp operations out of sync");
+
+RegOp registerOp(OpCode op) {
+    if (op < OpCode::ADD_I64 || op > OpCode::OR) {
+        throw std::runtime_error("No register form for opcode");
+    }
+    return static_cast<RegOp>(static_cast<int>(op) - static_cast<int>(OpCode::ADD_I64) +
+                              static_cast<int>(RegOp::ADD_I64));
+}
+
+// An int literal used as a deci is converted at compile time.
+bool isWidenedLiteral(ExprPtr expr, ValueType to) {
+    return to == ValueType::DECI && expr->type == ValueType::INT && expr->kind == NodeKind::LITERAL;
+}
+
+uint32_t addWidenedLiteral(ConstantPool& pool, const LiteralExpr& literal) {
+    if (literal.isBig()) {
+        return pool.addConstant(Value::makeDeci(BigInt::parse(literal.text).toDouble()));
+    }
+    return pool.addConstant(Value::makeDeci(static_cast<double>(literal.value.as.i)));
+}
+
+bool isAssignment(ExprPtr expr) {
+    return expr->kind == NodeKind::BINARY && static_cast<BinaryExpr*>(expr)->op == BinaryOp::ASSIGN;
+}
+
+bool containsAssignment(ExprPtr expr) {
+    switch (expr->kind) {
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            return binary->op == BinaryOp::ASSIGN || containsAssignment(binary->left) ||
+                   containsAssignment(binary->right);
+        }
+        case NodeKind::UNARY:
+            return containsAssignment(static_cast<UnaryExpr*>(expr)->right);
+        default:
+            return false;
+    }
+}
+
+bool readsVariable(ExprPtr expr, std::string_view name) {
+    switch (expr->kind) {
+        case NodeKind::VARIABLE:
+            return static_cast<VariableExpr*>(expr)->name == name;
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            return readsVariable(binary->left, name) || readsVariable(binary->right, name);
+        }
+        case NodeKind::UNARY:
+            return readsVariable(static_cast<UnaryExpr*>(expr)->right, name);
+        default:
+            return false;
+    }
+}
+
+// The TypeChecker rejects any assignment target but a variable.
+VariableExpr* assignmentTarget(const BinaryExpr& assign) {
+    return static_cast<VariableExpr*>(assign.left);
+}
+}
+
+Compiler::Compiler()
+    : scopes(1), nextSlot(0), maxSlots(0), nextTemp(0), maxRegisters(0), line(0), irBlock(0) {}
+
+Compiler::Compiler(const IrSettings& ir) : Compiler() {
+    irSettings = ir;
+}
+
+Chunk Compiler::compile(const std::vector<StmtPtr>& statements) {
+    // Drop any block scopes left behind by a previous failed compile.
+    scopes.resize(1);
+    nextSlot = static_cast<int>(scopes[0].size());
+    if (irSettings.enabled) {
+        return compileIr(statements);
+    }
+
+    chunk = Chunk();
+    chunk.code.reserve(statements.size() * 8);
+
+    for (StmtPtr stmt : statements) {
         compileStatement(stmt);
     }
 
-    instructions.emplace_back(OpCode::HALT);
-    return instructions;
+    emit(OpCode::HALT);
+    chunk.slotCount = static_cast<uint32_t>(maxSlots);
+    return std::move(chunk);
+}
+
+void Compiler::emit(OpCode op) {
+    chunk.lines.add(chunk.code.size(), line);
+    chunk.emit(op);
+}
+
+void Compiler::emit(OpCode op, uint32_t operand) {
+    chunk.lines.add(chunk.code.size(), line);
+    chunk.emit(op, operand);
+}
+
+size_t Compiler::emitJump(OpCode op) {
+    chunk.lines.add(chunk.code.size(), line);
+    return chunk.emitJump(op);
+}
+
+void Compiler::emitVariable(OpCode op, int slot) {
+    emit(op, static_cast<uint32_t>(slot));
+}
+
+
+// ================= SCOPES =================
+
+void Compiler::beginScope() {
+    scopes.emplace_back();
+}
+
+void Compiler::endScope() {
+    nextSlot -= static_cast<int>(scopes.back().size());
+    scopes.pop_back();
+}
+
+int Compiler::declareVariable(std::string_view name) {
+    auto& scope = scopes.back();
+    std::string key(name);
+    auto it = scope.find(key);
+    if (it != scope.end()) {
+        return it->second;
+    }
+
+    if (nextSlot >= kMaxSlots) {
+        throw std::runtime_error("Too many variables in scope");
+    }
+
+    int slot = nextSlot++;
+    if (nextSlot > maxSlots) maxSlots = nextSlot;
+    scope.emplace(std::move(key), slot);
+    return slot;
+}
+
+void Compiler::declareGlobal(const std::string& name, int slot) {
+    if (slot < 0 || slot >= kMaxSlots) {
+        throw std::runtime_error("Too many variables in scope");
+    }
+    scopes[0][name] = slot;
+    maxSlots = std::max(maxSlots, slot + 1);
+}
+
+int Compiler::declarationSlot(std::string_view name) const {
+    auto it = scopes.back().find(std::string(name));
+    if (it != scopes.back().end()) {
+        return it->second;
+    }
+    if (nextSlot >= kMaxSlots) {
+        throw std::runtime_error("Too many variables in scope");
+    }
+    return nextSlot;
+}
+
+// A run stopped by an error leaves its globals behind for the next REPL
+// line or program on the same VM, so a global whose initializer may fail
+// holds its type's default first rather than whatever the slot last held
+// (a variable of a closed scope, or the global before a redeclaration).
+// Literals and variable reads cannot fail, and a redeclaration that reads
+// the variable needs the old value.
+bool Compiler::storesDefaultFirst(const VarDeclStmt& decl) const {
+    ExprPtr init = decl.initializer;
+    if (scopes.size() != 1 || !init || init->kind == NodeKind::LITERAL || init->kind == NodeKind::VARIABLE) {
+        return false;
+    }
+    return scopes[0].count(std::string(decl.name)) == 0 || !readsVariable(init, decl.name);
+}
+
+int Compiler::resolveVariable(std::string_view name) const {
+    std::string key(name);
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto it = scope->find(key);
+        if (it != scope->end()) {
+            return it->second;
+        }
+    }
+    throw std::runtime_error("Undefined variable: " + key);
 }
 
 
 // ================= STATEMENTS =================
 
-void Compiler::compileStatement(const StmtPtr& stmt) {
-    if (auto printStmt = std::dynamic_pointer_cast<PrintStmt>(stmt)) {
-        compileExpression(printStmt->expression);
-        instructions.emplace_back(OpCode::PRINT);
+// Every node sets `line` before emitting its own instructions, including
+// after its children have emitted theirs.
+void Compiler::compileStatement(StmtPtr stmt) {
+    line = stmt->line;
+    switch (stmt->kind) {
+        case NodeKind::PRINT:
+            compileExpression(static_cast<PrintStmt*>(stmt)->expression);
+            line = stmt->line;
+            emit(OpCode::PRINT);
+            break;
+
+        case NodeKind::VAR_DECL: {
+            auto* varDecl = static_cast<VarDeclStmt*>(stmt);
+            if (storesDefaultFirst(*varDecl)) {
+                emit(OpCode::LOAD_CONST, addDefault(chunk, varDecl->type));
+                emitVariable(OpCode::STORE_VAR, declarationSlot(varDecl->name));
+            }
+            if (varDecl->initializer) {
+                compileConverted(varDecl->initializer, varDecl->type);
+                line = stmt->line;
+            } else {
+                emit(OpCode::LOAD_CONST, addDefault(chunk, varDecl->type));
+            }
+            emitVariable(OpCode::STORE_VAR, declareVariable(varDecl->name));
+            break;
+        }
+
+        case NodeKind::EXPR_STMT: {
+            // A top-level assignment needs no result; anything else is discarded.
+            ExprPtr expression = static_cast<ExprStmt*>(stmt)->expression;
+            if (isAssignment(expression)) {
+                compileAssignment(static_cast<BinaryExpr*>(expression), false);
+            } else {
+                compileExpression(expression);
+                line = stmt->line;
+                emit(OpCode::POP);
+            }
+            break;
+        }
+
+        case NodeKind::BLOCK:
+            beginScope();
+            for (StmtPtr s : *static_cast<BlockStmt*>(stmt)) {
+                compileStatement(s);
+            }
+            endScope();
+            break;
+
+        case NodeKind::IF: {
+            auto* ifStmt = static_cast<IfStmt*>(stmt);
+            compileExpression(ifStmt->condition);
+
+            line = stmt->line;
+            size_t jump = emitJump(OpCode::JUMP_IF_FALSE);
+
+            compileStatement(ifStmt->thenBranch);
+
+            chunk.patchJump(jump, chunk.code.size());
+            break;
+        }
+
+        default:
+            break;
     }
-    else if (auto varDecl = std::dynamic_pointer_cast<VarDeclStmt>(stmt)) {
-        if (varDecl->initializer) {
-            compileExpression(varDecl->initializer);
-            instructions.emplace_back(OpCode::STORE_VAR, varDecl->name);
+}
+
+
+// ================= EXPRESSIONS =================
+
+void Compiler::compileExpression(ExprPtr expr) {
+    line = expr->line;
+    switch (expr->kind) {
+        case NodeKind::LITERAL:
+            emit(OpCode::LOAD_CONST, addLiteral(chunk, *static_cast<LiteralExpr*>(expr)));
+            break;
+
+        case NodeKind::VARIABLE:
+            emitVariable(OpCode::LOAD_VAR, resolveVariable(static_cast<VariableExpr*>(expr)->name));
+            break;
+
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            if (binary->op == BinaryOp::ASSIGN) {
+                compileAssignment(binary, true);
+                break;
+            }
+
+            ValueType operands = operandType(*binary);
+            compileConverted(binary->left, operands);
+            compileConverted(binary->right, operands);
+            line = binary->line;
+            emit(binaryOpCode(binary->op, operands));
+            break;
         }
+
+        case NodeKind::UNARY: {
+            auto* unary = static_cast<UnaryExpr*>(expr);
+            compileExpression(unary->right);
+
+            line = unary->line;
+            if (unary->op == UnaryOp::NOT) emit(OpCode::NOT);
+            else emit(unary->type == ValueType::INT ? OpCode::NEG_I64 : OpCode::NEG_F64);
+            break;
+        }
+
+        default:
+            throw std::runtime_error("Unsupported expression");
+    }
+}
+
+void Compiler::compileConverted(ExprPtr expr, ValueType to) {
+    if (isWidenedLiteral(expr, to)) {
+        line = expr->line;
+        emit(OpCode::LOAD_CONST, addWidenedLiteral(chunk, *static_cast<LiteralExpr*>(expr)));
+        return;
     }
-    else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(stmt)) {
-        compileExpression(exprStmt->expression);
+    compileExpression(expr);
+    if (expr->type == ValueType::INT && to == ValueType::DECI) {
+        line = expr->line;
+        emit(OpCode::I64_TO_F64);
     }
-    else if (auto blockStmt = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
-        for (const auto& s : blockStmt->statements) {
-            compileStatement(s);
+}
+
+void Compiler::compileAssignment(BinaryExpr* assign, bool keepValue) {
+    VariableExpr* target = assignmentTarget(*assign);
+    compileConverted(assign->right, target->type);
+    line = assign->line;
+    int slot = resolveVariable(target->name);
+    emitVariable(OpCode::STORE_VAR, slot);
+    if (keepValue) {
+        emitVariable(OpCode::LOAD_VAR, slot);
+    }
+}
+
+
+// ================= IR =================
+//
+// Mirrors the stack compiler above, but builds SSA values and blocks
+// (ir.h) that are optimized and then lowered to a Chunk.
+
+Chunk Compiler::compileIr(const std::vector<StmtPtr>& statements) {
+    ir = IrProgram();
+    irBlock = newIrBlock();
+
+    for (StmtPtr stmt : statements) {
+        compileIrStatement(stmt);
+    }
+
+    emitIr(OpCode::HALT, kNoValue, 0);
+    ir.slotCount = static_cast<uint32_t>(maxSlots);
+    ir.slotNames.resize(ir.slotCount);
+    ir.liveOut.assign(ir.slotCount, false);
+    for (const auto& [name, slot] : scopes[0]) {
+        ir.liveOut[slot] = true;
+        if (ir.slotNames[slot].empty()) ir.slotNames[slot] = name;
+    }
+
+    runIrPasses(ir, irSettings);
+    Chunk lowered = lowerIr(ir);
+    ir = IrProgram();
+    return lowered;
+}
+
+uint32_t Compiler::newIrBlock() {
+    ir.blocks.emplace_back();
+    return static_cast<uint32_t>(ir.blocks.size() - 1);
+}
+
+uint32_t Compiler::emitIrValue(OpCode op, uint32_t left, uint32_t right, uint32_t operand) {
+    uint32_t value = ir.valueCount++;
+    ir.blocks[irBlock].code.push_back(IrInstr{op, value, {left, right}, operand, 0, line});
+    return value;
+}
+
+void Compiler::emitIr(OpCode op, uint32_t value, uint32_t operand) {
+    ir.blocks[irBlock].code.push_back(IrInstr{op, kNoValue, {value, kNoValue}, operand, 0, line});
+}
+
+void Compiler::compileIrStatement(StmtPtr stmt) {
+    line = stmt->line;
+    switch (stmt->kind) {
+        case NodeKind::PRINT: {
+            uint32_t value = compileIrExpression(static_cast<PrintStmt*>(stmt)->expression);
+            line = stmt->line;
+            emitIr(OpCode::PRINT, value, 0);
+            break;
         }
+
+        case NodeKind::VAR_DECL: {
+            auto* varDecl = static_cast<VarDeclStmt*>(stmt);
+            uint32_t value;
+            if (storesDefaultFirst(*varDecl)) {
+                value = emitIrValue(OpCode::LOAD_CONST, kNoValue, kNoValue, addDefault(ir, varDecl->type));
+                emitIr(OpCode::STORE_VAR, value, static_cast<uint32_t>(declarationSlot(varDecl->name)));
+            }
+            if (varDecl->initializer) {
+                value = compileIrConverted(varDecl->initializer, varDecl->type);
+                line = stmt->line;
+            } else {
+                value = emitIrValue(OpCode::LOAD_CONST, kNoValue, kNoValue, addDefault(ir, varDecl->type));
+            }
+            int slot = declareVariable(varDecl->name);
+            if (static_cast<size_t>(slot) >= ir.slotNames.size()) ir.slotNames.resize(slot + 1);
+            ir.slotNames[slot] = std::string(varDecl->name);
+            emitIr(OpCode::STORE_VAR, value, static_cast<uint32_t>(slot));
+            break;
+        }
+
+        case NodeKind::EXPR_STMT: {
+            ExprPtr expression = static_cast<ExprStmt*>(stmt)->expression;
+            if (isAssignment(expression)) {
+                compileIrAssignment(static_cast<BinaryExpr*>(expression), false);
+            } else {
+                compileIrExpression(expression);
+            }
+            break;
+        }
+
+        case NodeKind::BLOCK:
+            beginScope();
+            for (StmtPtr s : *static_cast<BlockStmt*>(stmt)) {
+                compileIrStatement(s);
+            }
+            endScope();
+            break;
+
+        case NodeKind::IF: {
+            // The branch goes to the body when true and to a join block
+            // when false; the body's last block jumps to the join.
+            auto* ifStmt = static_cast<IfStmt*>(stmt);
+            uint32_t condition = compileIrExpression(ifStmt->condition);
+
+            line = stmt->line;
+            uint32_t branchBlock = irBlock;
+            uint32_t thenBlock = newIrBlock();
+            emitIr(OpCode::JUMP_IF_FALSE, condition, 0);
+            ir.blocks[branchBlock].code.back().operand2 = thenBlock;
+
+            irBlock = thenBlock;
+            compileIrStatement(ifStmt->thenBranch);
+
+            line = stmt->line;
+            uint32_t join = newIrBlock();
+            emitIr(OpCode::JUMP, kNoValue, join);
+            ir.blocks[branchBlock].code.back().operand = join;
+            irBlock = join;
+            break;
+        }
+
+        default:
+            break;
     }
-    else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
-        compileExpression(ifStmt->condition);
+}
+
+uint32_t Compiler::compileIrExpression(ExprPtr expr) {
+    line = expr->line;
+    switch (expr->kind) {
+        case NodeKind::LITERAL:
+            return emitIrValue(OpCode::LOAD_CONST, kNoValue, kNoValue,
+                               addLiteral(ir, *static_cast<LiteralExpr*>(expr)));
 
-        int jumpIndex = static_cast<int>(instructions.size());
-        instructions.emplace_back(OpCode::JUMP_IF_FALSE, "0");
+        case NodeKind::VARIABLE:
+            return emitIrValue(OpCode::LOAD_VAR, kNoValue, kNoValue,
+                               static_cast<uint32_t>(resolveVariable(static_cast<VariableExpr*>(expr)->name)));
 
-        compileStatement(ifStmt->thenBranch);
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            if (binary->op == BinaryOp::ASSIGN) {
+                return compileIrAssignment(binary, true);
+            }
 
-        instructions[jumpIndex].operand =
-            std::to_string(instructions.size());
+            ValueType operands = operandType(*binary);
+            uint32_t left = compileIrConverted(binary->left, operands);
+            uint32_t right = compileIrConverted(binary->right, operands);
+            line = binary->line;
+            return emitIrValue(binaryOpCode(binary->op, operands), left, right, 0);
+        }
+
+        case NodeKind::UNARY: {
+            auto* unary = static_cast<UnaryExpr*>(expr);
+            uint32_t operand = compileIrExpression(unary->right);
+
+            line = unary->line;
+            OpCode op = unary->op == UnaryOp::NOT ? OpCode::NOT
+                      : unary->type == ValueType::INT ? OpCode::NEG_I64 : OpCode::NEG_F64;
+            return emitIrValue(op, operand, kNoValue, 0);
+        }
+
+        default:
+            throw std::runtime_error("Unsupported expression");
     }
 }
 
+uint32_t Compiler::compileIrConverted(ExprPtr expr, ValueType to) {
+    if (isWidenedLiteral(expr, to)) {
+        line = expr->line;
+        return emitIrValue(OpCode::LOAD_CONST, kNoValue, kNoValue,
+                           addWidenedLiteral(ir, *static_cast<LiteralExpr*>(expr)));
+    }
+    uint32_t value = compileIrExpression(expr);
+    if (expr->type == ValueType::INT && to == ValueType::DECI) {
+        line = expr->line;
+        value = emitIrValue(OpCode::I64_TO_F64, value, kNoValue, 0);
+    }
+    return value;
+}
 
-// ================= EXPRESSIONS =================
+// Like compileAssignment, the value of an assignment expression is read
+// back from the variable; copy propagation forwards it.
+uint32_t Compiler::compileIrAssignment(BinaryExpr* assign, bool keepValue) {
+    VariableExpr* target = assignmentTarget(*assign);
+    uint32_t value = compileIrConverted(assign->right, target->type);
+    line = assign->line;
+    uint32_t slot = static_cast<uint32_t>(resolveVariable(target->name));
+    emitIr(OpCode::STORE_VAR, value, slot);
+    return keepValue ? emitIrValue(OpCode::LOAD_VAR, kNoValue, kNoValue, slot) : kNoValue;
+}
+
+
+// ================= REGISTER BACKEND =================
+//
+// Variables live in the registers matching their slots; temporaries are
+// allocated above the slots in use and released after every statement.
+// An expression compiled with a destination register writes its result
+// there directly, so `c = a + b` needs no MOVE.
+
+RegisterChunk Compiler::compileRegisters(const std::vector<StmtPtr>& statements) {
+    regChunk = RegisterChunk();
 
-void Compiler::compileExpression(const ExprPtr& expr) {
-    if (auto literal = std::dynamic_pointer_cast<LiteralExpr>(expr)) {
-        instructions.emplace_back(OpCode::LOAD_CONST, literal->value);
+    scopes.resize(1);
+    nextSlot = static_cast<int>(scopes[0].size());
+    regChunk.code.reserve(statements.size() * 2);
+
+    for (StmtPtr stmt : statements) {
+        compileRegisterStatement(stmt);
+    }
+
+    emitRegister(RegInstr::make(RegOp::HALT));
+    regChunk.slotCount = static_cast<uint32_t>(maxSlots);
+    regChunk.registerCount = static_cast<uint32_t>(std::max(maxSlots, maxRegisters));
+    return std::move(regChunk);
+}
+
+void Compiler::emitRegister(const RegInstr& instr) {
+    regChunk.lines.add(regChunk.code.size(), line);
+    regChunk.code.push_back(instr);
+}
+
+int Compiler::allocateTemp() {
+    if (nextTemp >= kMaxSlots) {
+        throw std::runtime_error("Expression too complex: out of registers");
     }
-    else if (auto variable = std::dynamic_pointer_cast<VariableExpr>(expr)) {
-        instructions.emplace_back(OpCode::LOAD_VAR, variable->name);
+    int reg = nextTemp++;
+    if (nextTemp > maxRegisters) maxRegisters = nextTemp;
+    return reg;
+}
+
+void Compiler::compileRegisterStatement(StmtPtr stmt) {
+    nextTemp = nextSlot;
+    line = stmt->line;
+
+    switch (stmt->kind) {
+        case NodeKind::PRINT: {
+            int reg = compileRegisterExpression(static_cast<PrintStmt*>(stmt)->expression, -1);
+            line = stmt->line;
+            emitRegister(RegInstr::make(RegOp::PRINT, static_cast<uint16_t>(reg)));
+            break;
+        }
+
+        case NodeKind::VAR_DECL: {
+            // Compile the initializer straight into the slot the variable is
+            // about to receive; it still resolves names in the enclosing scope.
+            auto* varDecl = static_cast<VarDeclStmt*>(stmt);
+            auto existing = scopes.back().find(std::string(varDecl->name));
+            bool redeclared = existing != scopes.back().end();
+            int slot = redeclared ? existing->second : nextSlot;
+            nextTemp = redeclared ? nextSlot : nextSlot + 1;
+            if (nextTemp > kMaxSlots) {
+                throw std::runtime_error("Too many variables in scope");
+            }
+            if (nextTemp > maxRegisters) maxRegisters = nextTemp;
+
+            if (storesDefaultFirst(*varDecl)) {
+                emitRegister(RegInstr::makeWide(RegOp::LOADK, static_cast<uint16_t>(slot),
+                                                addDefault(regChunk, varDecl->type)));
+            }
+            if (varDecl->initializer) {
+                int reg = compileRegisterOperand(varDecl->initializer, slot, varDecl->type);
+                line = stmt->line;
+                if (reg != slot) {
+                    emitRegister(RegInstr::make(RegOp::MOVE, static_cast<uint16_t>(slot), static_cast<uint16_t>(reg)));
+                }
+            } else {
+                emitRegister(RegInstr::makeWide(RegOp::LOADK, static_cast<uint16_t>(slot),
+                                                addDefault(regChunk, varDecl->type)));
+            }
+            declareVariable(varDecl->name);
+            break;
+        }
+
+        case NodeKind::EXPR_STMT:
+            compileRegisterExpression(static_cast<ExprStmt*>(stmt)->expression, -1);
+            break;
+
+        case NodeKind::BLOCK:
+            beginScope();
+            for (StmtPtr s : *static_cast<BlockStmt*>(stmt)) {
+                compileRegisterStatement(s);
+            }
+            endScope();
+            break;
+
+        case NodeKind::IF: {
+            auto* ifStmt = static_cast<IfStmt*>(stmt);
+            int cond = compileRegisterExpression(ifStmt->condition, -1);
+            line = stmt->line;
+            size_t jump = regChunk.code.size();
+            emitRegister(RegInstr::make(RegOp::JUMP_IF_FALSE, static_cast<uint16_t>(cond)));
+
+            compileRegisterStatement(ifStmt->thenBranch);
+
+            regChunk.code[jump] = RegInstr::makeWide(RegOp::JUMP_IF_FALSE, static_cast<uint16_t>(cond),
+                                                     static_cast<uint32_t>(regChunk.code.size()));
+            break;
+        }
+
+        default:
+            break;
     }
-    else if (auto binary = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
-        if (binary->op == "=") {
-            compileExpression(binary->right);
-            auto target = std::dynamic_pointer_cast<VariableExpr>(binary->left);
-            if (target) {
-                instructions.emplace_back(OpCode::STORE_VAR, target->name);
+}
+
+int Compiler::compileRegisterExpression(ExprPtr expr, int dest) {
+    line = expr->line;
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            int reg = dest >= 0 ? dest : allocateTemp();
+            emitRegister(RegInstr::makeWide(RegOp::LOADK, static_cast<uint16_t>(reg),
+                                            addLiteral(regChunk, *static_cast<LiteralExpr*>(expr))));
+            return reg;
+        }
+
+        case NodeKind::VARIABLE: {
+            int reg = resolveVariable(static_cast<VariableExpr*>(expr)->name);
+            if (dest >= 0 && dest != reg) {
+                emitRegister(RegInstr::make(RegOp::MOVE, static_cast<uint16_t>(dest), static_cast<uint16_t>(reg)));
+                return dest;
+            }
+            return reg;
+        }
+
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            if (binary->op == BinaryOp::ASSIGN) {
+                VariableExpr* target = assignmentTarget(*binary);
+                int slot = resolveVariable(target->name);
+                int reg = compileRegisterOperand(binary->right, slot, target->type);
+                line = binary->line;
+                if (reg != slot) {
+                    emitRegister(RegInstr::make(RegOp::MOVE, static_cast<uint16_t>(slot), static_cast<uint16_t>(reg)));
+                }
+                if (dest >= 0 && dest != slot) {
+                    emitRegister(RegInstr::make(RegOp::MOVE, static_cast<uint16_t>(dest), static_cast<uint16_t>(slot)));
+                    return dest;
+                }
+                return slot;
+            }
+
+            ValueType operands = operandType(*binary);
+            int left = compileRegisterOperand(binary->left, -1, operands);
+            line = binary->line;
+            if (left < nextSlot && containsAssignment(binary->right)) {
+                // The right operand may overwrite the variable read on the left.
+                int copy = allocateTemp();
+                emitRegister(RegInstr::make(RegOp::MOVE, static_cast<uint16_t>(copy), static_cast<uint16_t>(left)));
+                left = copy;
             }
-            return;
+            int right = compileRegisterOperand(binary->right, -1, operands);
+            line = binary->line;
+            int reg = dest >= 0 ? dest : allocateTemp();
+            emitRegister(RegInstr::make(registerOp(binaryOpCode(binary->op, operands)), static_cast<uint16_t>(reg),
+                                        static_cast<uint16_t>(left), static_cast<uint16_t>(right)));
+            return reg;
         }
 
-        compileExpression(binary->left);
-        compileExpression(binary->right);
+        case NodeKind::UNARY: {
+            auto* unary = static_cast<UnaryExpr*>(expr);
+            int operand = compileRegisterExpression(unary->right, -1);
+            line = unary->line;
+            int reg = dest >= 0 ? dest : allocateTemp();
+            RegOp op = unary->op == UnaryOp::NOT ? RegOp::NOT
+                     : unary->type == ValueType::INT ? RegOp::NEG_I64 : RegOp::NEG_F64;
+            emitRegister(RegInstr::make(op, static_cast<uint16_t>(reg), static_cast<uint16_t>(operand)));
+            return reg;
+        }
 
-        if (binary->op == "+") instructions.emplace_back(OpCode::ADD);
-        else if (binary->op == "-") instructions.emplace_back(OpCode::SUB);
-        else if (binary->op == "*") instructions.emplace_back(OpCode::MUL);
-        else if (binary->op == "/") instructions.emplace_back(OpCode::DIV);
-        else if (binary->op == "%") instructions.emplace_back(OpCode::MOD);
-        else if (binary->op == "==") instructions.emplace_back(OpCode::EQUAL);
-        else if (binary->op == "!=") instructions.emplace_back(OpCode::NOT_EQUAL);
-        else if (binary->op == "<") instructions.emplace_back(OpCode::LESS);
-        else if (binary->op == "<=") instructions.emplace_back(OpCode::LESS_EQUAL);
-        else if (binary->op == ">") instructions.emplace_back(OpCode::GREATER);
-        else if (binary->op == ">=") instructions.emplace_back(OpCode::GREATER_EQUAL);
-        else if (binary->op == "&&") instructions.emplace_back(OpCode::AND);
-        else if (binary->op == "||") instructions.emplace_back(OpCode::OR);
+        default:
+            throw std::runtime_error("Unsupported expression");
     }
-    else if (auto unary = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
-        compileExpression(unary->right);
+}
 
-        if (unary->op == "-") instructions.emplace_back(OpCode::NEG);
-        else if (unary->op == "!") instructions.emplace_back(OpCode::NOT);
+int Compiler::compileRegisterOperand(ExprPtr expr, int dest, ValueType to) {
+    if (isWidenedLiteral(expr, to)) {
+        line = expr->line;
+        int reg = dest >= 0 ? dest : allocateTemp();
+        emitRegister(RegInstr::makeWide(RegOp::LOADK, static_cast<uint16_t>(reg),
+                                        addWidenedLiteral(regChunk, *static_cast<LiteralExpr*>(expr))));
+        return reg;
+    }
+    int reg = compileRegisterExpression(expr, dest);
+    if (expr->type == ValueType::INT && to == ValueType::DECI) {
+        line = expr->line;
+        int converted = dest >= 0 ? dest : allocateTemp();
+        emitRegister(RegInstr::make(RegOp::I64_TO_F64, static_cast<uint16_t>(converted), static_cast<uint16_t>(reg)));
+        return converted;
     }
+    return reg;
 }
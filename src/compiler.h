@@ -3,17 +3,78 @@
 
 #include "ast.h"
 #include "bytecode.h"
+#include "ir.h"
+#include "regbytecode.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+// Compiles a program that has been through the TypeChecker: every
+// Expression::type must be set. The AST is only read during compile(); the
+// chunks it returns own their constants and strings.
 class Compiler {
 private:
-    std::vector<Instruction> instructions;
+    Chunk chunk;
+    RegisterChunk regChunk;
 
-    void compileStatement(const StmtPtr& stmt);
-    void compileExpression(const ExprPtr& expr);
+    // scopes[0] holds the globals and survives across compile() calls so
+    // that REPL lines keep seeing earlier declarations at the same slots.
+    std::vector<std::unordered_map<std::string, int>> scopes;
+    int nextSlot;
+    int maxSlots;
+    int nextTemp;     // register backend: first free temporary
+    int maxRegisters;
+    int line;         // source line of what is being emitted, for the line tables
+
+    IrSettings irSettings;
+    IrProgram ir;
+    uint32_t irBlock; // block being appended to
+
+    void beginScope();
+    void endScope();
+    int declareVariable(std::string_view name);
+    int declarationSlot(std::string_view name) const; // the slot declareVariable() will give
+    bool storesDefaultFirst(const VarDeclStmt& decl) const;
+    int resolveVariable(std::string_view name) const;
+
+    void emit(OpCode op);
+    void emit(OpCode op, uint32_t operand);
+    size_t emitJump(OpCode op);
+    void emitVariable(OpCode op, int slot);
+    void compileStatement(StmtPtr stmt);
+    void compileExpression(ExprPtr expr);
+    void compileConverted(ExprPtr expr, ValueType to); // widens int to deci
+    void compileAssignment(BinaryExpr* assign, bool keepValue);
+
+    Chunk compileIr(const std::vector<StmtPtr>& statements);
+    uint32_t newIrBlock();
+    uint32_t emitIrValue(OpCode op, uint32_t left, uint32_t right, uint32_t operand);
+    void emitIr(OpCode op, uint32_t value, uint32_t operand);
+    void compileIrStatement(StmtPtr stmt);
+    uint32_t compileIrExpression(ExprPtr expr);
+    uint32_t compileIrConverted(ExprPtr expr, ValueType to);
+    uint32_t compileIrAssignment(BinaryExpr* assign, bool keepValue);
+
+    void emitRegister(const RegInstr& instr);
+    int allocateTemp();
+    void compileRegisterStatement(StmtPtr stmt);
+    int compileRegisterExpression(ExprPtr expr, int dest);
+    int compileRegisterOperand(ExprPtr expr, int dest, ValueType to);
 
 public:
-    std::vector<Instruction> compile(const std::vector<StmtPtr>& statements);
+    Compiler();
+    // With `ir.enabled`, compile() builds the SSA IR of ir.h, runs its
+    // passes and lowers the result instead of emitting code directly.
+    explicit Compiler(const IrSettings& ir);
+    Chunk compile(const std::vector<StmtPtr>& statements);
+    RegisterChunk compileRegisters(const std::vector<StmtPtr>& statements);
+    int slotCount() const { return maxSlots; }
+
+    // Global variables by name and slot, as saved and restored by heap
+    // images. Globals take the slots from 0 up in declaration order.
+    const std::unordered_map<std::string, int>& globals() const { return scopes[0]; }
+    void declareGlobal(const std::string& name, int slot);
 };
 
 #endif
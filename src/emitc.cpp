@@ -0,0 +1,820 @@
+#include "emitc.h"
+#include "bigint.h"
+#include "verifier.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+// Prepended to every generated program. It mirrors the VM: the same value
+// representation in spirit, the semantics of valueops.h, the printing of
+// OutputSink (decis in the shortest form that reads back, like
+// std::to_chars) and the "Error: ..." / exit status 1 of a runtime error.
+// Everything is static inline so that what a program does not use is
+// dropped without warnings.
+const char* kRuntime = R"meow(#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* MEOW_BIG is an int beyond 64 bits; the VM tells those apart by
+   Value::inlineLength instead. */
+enum { MEOW_INT, MEOW_DECI, MEOW_BOOL, MEOW_CHAR, MEOW_STRING, MEOW_BIG };
+
+struct meow_big;
+
+typedef struct {
+    int type;
+    union {
+        int64_t i;
+        const struct meow_big* big;
+        double d;
+        int b;
+        char c;
+        struct {
+            const char* data;
+            size_t length;
+        } s;
+    } as;
+} meow_value;
+
+static inline void meow_fail(const char* message) {
+    fflush(stdout);
+    fprintf(stderr, "Error: %s\n", message);
+    exit(1);
+}
+
+static inline int meow_halt(void) {
+    if (fflush(stdout) != 0 || ferror(stdout)) {
+        fprintf(stderr, "Error: Could not write output\n");
+        return 1;
+    }
+    return 0;
+}
+
+static inline meow_value meow_int(int64_t v) { meow_value r; r.type = MEOW_INT; r.as.i = v; return r; }
+static inline meow_value meow_deci(double v) { meow_value r; r.type = MEOW_DECI; r.as.d = v; return r; }
+static inline meow_value meow_bool(int v) { meow_value r; r.type = MEOW_BOOL; r.as.b = v != 0; return r; }
+static inline meow_value meow_char(char v) { meow_value r; r.type = MEOW_CHAR; r.as.c = v; return r; }
+static inline meow_value meow_string(const char* data, size_t length) {
+    meow_value r;
+    r.type = MEOW_STRING;
+    r.as.s.data = data;
+    r.as.s.length = length;
+    return r;
+}
+static inline meow_value meow_deci_bits(uint64_t bits) {
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return meow_deci(v);
+}
+
+/* An int that does not fit in int64_t (type MEOW_BIG): sign and
+   magnitude in 32-bit limbs, least significant first, without leading
+   zero limbs. Like concatenations, big ints are never freed. */
+typedef struct meow_big {
+    int negative;
+    size_t length;
+    uint32_t* limbs;
+} meow_big;
+
+static inline int64_t meow_wrap(uint64_t v) { return (int64_t)v; }
+
+/* 64-bit int arithmetic; nonzero when the result does not fit. */
+#if defined(__GNUC__) || defined(__clang__)
+static inline int meow_add_overflow(int64_t a, int64_t b, int64_t* r) { return __builtin_add_overflow(a, b, r); }
+static inline int meow_sub_overflow(int64_t a, int64_t b, int64_t* r) { return __builtin_sub_overflow(a, b, r); }
+static inline int meow_mul_overflow(int64_t a, int64_t b, int64_t* r) { return __builtin_mul_overflow(a, b, r); }
+#else
+static inline int meow_add_overflow(int64_t a, int64_t b, int64_t* r) {
+    if (b > 0 ? a > INT64_MAX - b : a < INT64_MIN - b) return 1;
+    *r = a + b;
+    return 0;
+}
+static inline int meow_sub_overflow(int64_t a, int64_t b, int64_t* r) {
+    if (b < 0 ? a > INT64_MAX + b : a < INT64_MIN + b) return 1;
+    *r = a - b;
+    return 0;
+}
+static inline int meow_mul_overflow(int64_t a, int64_t b, int64_t* r) {
+    int64_t p = meow_wrap((uint64_t)a * (uint64_t)b);
+    if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN) || (b != 0 && p / b != a)) return 1;
+    *r = p;
+    return 0;
+}
+#endif
+
+static inline meow_big* meow_big_new(size_t length) {
+    meow_big* x = (meow_big*)malloc(sizeof(meow_big));
+    uint32_t* limbs = (uint32_t*)calloc(length ? length : 1, sizeof(uint32_t));
+    if (!x || !limbs) meow_fail("Out of memory");
+    x->negative = 0;
+    x->length = length;
+    x->limbs = limbs;
+    return x;
+}
+
+static inline const meow_big* meow_big_of(meow_value v) {
+    meow_big* x;
+    uint64_t m;
+    if (v.type == MEOW_BIG) return v.as.big;
+    x = meow_big_new(2);
+    x->negative = v.as.i < 0;
+    m = x->negative ? 0 - (uint64_t)v.as.i : (uint64_t)v.as.i;
+    x->limbs[0] = (uint32_t)m;
+    x->limbs[1] = (uint32_t)(m >> 32);
+    x->length = x->limbs[1] ? 2 : x->limbs[0] ? 1 : 0;
+    return x;
+}
+
+/* Trims `x` and makes it a value: an int whenever it fits. */
+static inline meow_value meow_big_value(meow_big* x) {
+    meow_value r;
+    while (x->length && !x->limbs[x->length - 1]) x->length--;
+    if (!x->length) x->negative = 0;
+    if (x->length <= 2) {
+        uint64_t m = x->length ? x->limbs[0] : 0;
+        if (x->length == 2) m |= (uint64_t)x->limbs[1] << 32;
+        if (!x->negative && m <= (uint64_t)INT64_MAX) return meow_int((int64_t)m);
+        if (x->negative && m <= (uint64_t)INT64_MAX + 1) return meow_int(meow_wrap(0 - m));
+    }
+    r.type = MEOW_BIG;
+    r.as.big = x;
+    return r;
+}
+
+/* A big int constant from its decimal text, parsed on first use and then
+   kept in `cache`. */
+static inline meow_value meow_big_constant(meow_value* cache, const char* text) {
+    meow_big* x;
+    int negative = *text == '-';
+    if (cache->type == MEOW_BIG) return *cache;
+    if (negative) text++;
+    x = meow_big_new(strlen(text) / 9 + 1);
+    x->length = 0;
+    for (; *text; text++) {
+        uint64_t carry = (uint64_t)(*text - '0');
+        size_t i;
+        for (i = 0; i < x->length; i++) {
+            uint64_t t = (uint64_t)x->limbs[i] * 10 + carry;
+            x->limbs[i] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        if (carry) x->limbs[x->length++] = (uint32_t)carry;
+    }
+    x->negative = negative;
+    *cache = meow_big_value(x);
+    return *cache;
+}
+
+static inline int meow_big_compare_magnitudes(const meow_big* a, const meow_big* b) {
+    size_t i;
+    if (a->length != b->length) return a->length < b->length ? -1 : 1;
+    for (i = a->length; i-- > 0;) {
+        if (a->limbs[i] != b->limbs[i]) return a->limbs[i] < b->limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static inline int meow_big_compare(const meow_big* a, const meow_big* b) {
+    int c;
+    if (a->negative != b->negative) return a->negative ? -1 : 1;
+    c = meow_big_compare_magnitudes(a, b);
+    return a->negative ? -c : c;
+}
+
+/* a + b, or a - b when `subtract` is set. */
+static inline meow_value meow_big_add(const meow_big* a, const meow_big* b, int subtract) {
+    int b_negative = b->length && (b->negative != subtract);
+    const meow_big* x = a;
+    const meow_big* y = b;
+    int negative = a->negative;
+    meow_big* r;
+    uint64_t carry = 0;
+    size_t i;
+    if (a->negative == b_negative) {
+        if (x->length < y->length) { x = b; y = a; }
+        r = meow_big_new(x->length + 1);
+        for (i = 0; i < x->length; i++) {
+            carry += (uint64_t)x->limbs[i] + (i < y->length ? y->limbs[i] : 0);
+            r->limbs[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        r->limbs[x->length] = (uint32_t)carry;
+    } else {
+        if (meow_big_compare_magnitudes(a, b) < 0) {
+            x = b;
+            y = a;
+            negative = b_negative;
+        }
+        r = meow_big_new(x->length);
+        for (i = 0; i < x->length; i++) {
+            uint64_t d = (uint64_t)x->limbs[i] - (i < y->length ? y->limbs[i] : 0) - carry;
+            r->limbs[i] = (uint32_t)d;
+            carry = d >> 63;
+        }
+    }
+    r->negative = negative;
+    return meow_big_value(r);
+}
+
+static inline meow_value meow_big_mul(const meow_big* a, const meow_big* b) {
+    meow_big* r = meow_big_new(a->length + b->length);
+    size_t i, j;
+    for (i = 0; i < a->length; i++) {
+        uint64_t carry = 0;
+        for (j = 0; j < b->length; j++) {
+            carry += (uint64_t)a->limbs[i] * b->limbs[j] + r->limbs[i + j];
+            r->limbs[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        r->limbs[i + b->length] = (uint32_t)carry;
+    }
+    r->negative = a->negative != b->negative;
+    return meow_big_value(r);
+}
+
+/* Truncating division of magnitudes, `b` nonzero, by Knuth's algorithm D;
+   the signs are left to the caller. */
+static inline void meow_big_divide(const meow_big* a, const meow_big* b, meow_big** quotient, meow_big** remainder) {
+    size_t n = b->length, m = a->length, i, j;
+    int shift = 0;
+    uint32_t top = b->limbs[n - 1];
+    meow_big *q, *r;
+    uint32_t *vn, *un;
+    if (meow_big_compare_magnitudes(a, b) < 0) {
+        q = meow_big_new(0);
+        r = meow_big_new(m);
+        if (m) memcpy(r->limbs, a->limbs, m * sizeof(uint32_t));
+        *quotient = q;
+        *remainder = r;
+        return;
+    }
+    q = meow_big_new(m - n + 1);
+    r = meow_big_new(n);
+    if (n == 1) {
+        uint64_t rest = 0;
+        for (i = m; i-- > 0;) {
+            uint64_t current = rest << 32 | a->limbs[i];
+            q->limbs[i] = (uint32_t)(current / top);
+            rest = current % top;
+        }
+        r->limbs[0] = (uint32_t)rest;
+        *quotient = q;
+        *remainder = r;
+        return;
+    }
+    while (!(top & 0x80000000u)) {
+        top <<= 1;
+        shift++;
+    }
+    vn = (uint32_t*)calloc(n, sizeof(uint32_t));
+    un = (uint32_t*)calloc(m + 1, sizeof(uint32_t));
+    if (!vn || !un) meow_fail("Out of memory");
+    for (i = n - 1; i > 0; i--) vn[i] = shift ? b->limbs[i] << shift | b->limbs[i - 1] >> (32 - shift) : b->limbs[i];
+    vn[0] = b->limbs[0] << shift;
+    un[m] = shift ? a->limbs[m - 1] >> (32 - shift) : 0;
+    for (i = m - 1; i > 0; i--) un[i] = shift ? a->limbs[i] << shift | a->limbs[i - 1] >> (32 - shift) : a->limbs[i];
+    un[0] = a->limbs[0] << shift;
+    for (j = m - n + 1; j-- > 0;) {
+        uint64_t numerator = (uint64_t)un[j + n] << 32 | un[j + n - 1];
+        uint64_t estimate = numerator / vn[n - 1];
+        uint64_t rest = numerator % vn[n - 1];
+        int64_t borrow = 0, t;
+        while (estimate >> 32 || estimate * vn[n - 2] > (rest << 32 | un[j + n - 2])) {
+            estimate--;
+            rest += vn[n - 1];
+            if (rest >> 32) break;
+        }
+        for (i = 0; i < n; i++) {
+            uint64_t product = estimate * vn[i];
+            t = (int64_t)un[i + j] - borrow - (int64_t)(product & 0xFFFFFFFFu);
+            un[i + j] = (uint32_t)t;
+            borrow = (int64_t)(product >> 32) - (t >> 32);
+        }
+        t = (int64_t)un[j + n] - borrow;
+        un[j + n] = (uint32_t)t;
+        if (t < 0) {
+            uint64_t carry = 0;
+            estimate--;
+            for (i = 0; i < n; i++) {
+                carry += (uint64_t)un[i + j] + vn[i];
+                un[i + j] = (uint32_t)carry;
+                carry >>= 32;
+            }
+            un[j + n] = (uint32_t)(un[j + n] + carry);
+        }
+        q->limbs[j] = (uint32_t)estimate;
+    }
+    for (i = 0; i < n; i++) r->limbs[i] = shift ? un[i] >> shift | un[i + 1] << (32 - shift) : un[i];
+    free(vn);
+    free(un);
+    *quotient = q;
+    *remainder = r;
+}
+
+/* Correctly rounded: the top 64 bits, with the lowest set if any bit
+   below them is, round the same way as the whole magnitude. */
+static inline double meow_big_to_double(const meow_big* x) {
+    size_t bits, shift, word, i;
+    unsigned offset;
+    uint64_t low, mantissa, next;
+    int sticky;
+    uint32_t top;
+    double v;
+    if (!x->length) return 0.0;
+    top = x->limbs[x->length - 1];
+    for (bits = 32 * x->length; !(top & 0x80000000u); top <<= 1) bits--;
+    shift = bits > 64 ? bits - 64 : 0;
+    word = shift / 32;
+    offset = (unsigned)(shift % 32);
+    low = x->limbs[word] | (word + 1 < x->length ? (uint64_t)x->limbs[word + 1] << 32 : 0);
+    next = word + 2 < x->length ? x->limbs[word + 2] : 0;
+    mantissa = offset ? low >> offset | next << (64 - offset) : low;
+    sticky = offset && (x->limbs[word] & ((1u << offset) - 1));
+    for (i = 0; i < word && !sticky; i++) sticky = x->limbs[i] != 0;
+    v = ldexp((double)(mantissa | (uint64_t)sticky), (int)shift);
+    return x->negative ? -v : v;
+}
+
+static inline void meow_print_big(const meow_big* x) {
+    uint32_t* rest = (uint32_t*)malloc(x->length * sizeof(uint32_t));
+    uint32_t* chunks = (uint32_t*)malloc((x->length * 10 / 9 + 2) * sizeof(uint32_t));
+    size_t length = x->length, count = 0, i;
+    if (!rest || !chunks) meow_fail("Out of memory");
+    memcpy(rest, x->limbs, length * sizeof(uint32_t));
+    do {
+        uint64_t remainder = 0;
+        for (i = length; i-- > 0;) {
+            uint64_t current = remainder << 32 | rest[i];
+            rest[i] = (uint32_t)(current / 1000000000u);
+            remainder = current % 1000000000u;
+        }
+        chunks[count++] = (uint32_t)remainder;
+        while (length && !rest[length - 1]) length--;
+    } while (length);
+    if (x->negative) putchar('-');
+    printf("%" PRIu32, chunks[count - 1]);
+    for (i = count - 1; i-- > 0;) printf("%09" PRIu32, chunks[i]);
+    putchar('\n');
+    free(rest);
+    free(chunks);
+}
+
+#define MEOW_BINARY(name, result) \
+    static inline meow_value meow_##name(meow_value a, meow_value b) { return result; }
+#define MEOW_UNARY(name, result) \
+    static inline meow_value meow_##name(meow_value a) { return result; }
+
+/* int operators stay in 64 bits while both operands and the result fit. */
+static inline int meow_small(meow_value a, meow_value b) { return a.type == MEOW_INT && b.type == MEOW_INT; }
+
+static inline meow_value meow_add_i64(meow_value a, meow_value b) {
+    int64_t r;
+    if (meow_small(a, b) && !meow_add_overflow(a.as.i, b.as.i, &r)) return meow_int(r);
+    return meow_big_add(meow_big_of(a), meow_big_of(b), 0);
+}
+static inline meow_value meow_sub_i64(meow_value a, meow_value b) {
+    int64_t r;
+    if (meow_small(a, b) && !meow_sub_overflow(a.as.i, b.as.i, &r)) return meow_int(r);
+    return meow_big_add(meow_big_of(a), meow_big_of(b), 1);
+}
+static inline meow_value meow_mul_i64(meow_value a, meow_value b) {
+    int64_t r;
+    if (meow_small(a, b) && !meow_mul_overflow(a.as.i, b.as.i, &r)) return meow_int(r);
+    return meow_big_mul(meow_big_of(a), meow_big_of(b));
+}
+static inline meow_value meow_neg_i64(meow_value a) {
+    meow_big* r;
+    const meow_big* x;
+    if (a.type == MEOW_INT && a.as.i != INT64_MIN) return meow_int(-a.as.i);
+    x = meow_big_of(a);
+    r = meow_big_new(x->length);
+    if (x->length) memcpy(r->limbs, x->limbs, x->length * sizeof(uint32_t));
+    r->negative = !x->negative;
+    return meow_big_value(r);
+}
+
+/* Truncating; the remainder takes the dividend's sign. */
+static inline meow_value meow_big_division(meow_value a, meow_value b, int modulo) {
+    const meow_big* x = meow_big_of(a);
+    const meow_big* y = meow_big_of(b);
+    meow_big *q, *r;
+    meow_big_divide(x, y, &q, &r);
+    q->negative = x->negative != y->negative;
+    r->negative = x->negative;
+    return meow_big_value(modulo ? r : q);
+}
+static inline meow_value meow_div_i64(meow_value a, meow_value b) {
+    if (b.type == MEOW_INT && b.as.i == 0) meow_fail("Division by zero");
+    if (meow_small(a, b) && b.as.i != -1) return meow_int(a.as.i / b.as.i);
+    return meow_big_division(a, b, 0);
+}
+static inline meow_value meow_mod_i64(meow_value a, meow_value b) {
+    if (b.type == MEOW_INT && b.as.i == 0) meow_fail("Division by zero");
+    if (meow_small(a, b)) return meow_int(b.as.i == -1 ? 0 : a.as.i % b.as.i);
+    return meow_big_division(a, b, 1);
+}
+
+static inline int meow_compare_ints(meow_value a, meow_value b) {
+    if (meow_small(a, b)) return (a.as.i > b.as.i) - (a.as.i < b.as.i);
+    return meow_big_compare(meow_big_of(a), meow_big_of(b));
+}
+
+MEOW_BINARY(add_f64, meow_deci(a.as.d + b.as.d))
+MEOW_BINARY(sub_f64, meow_deci(a.as.d - b.as.d))
+MEOW_BINARY(mul_f64, meow_deci(a.as.d * b.as.d))
+MEOW_BINARY(div_f64, meow_deci(a.as.d / b.as.d))
+MEOW_BINARY(mod_f64, meow_deci(fmod(a.as.d, b.as.d)))
+MEOW_UNARY(neg_f64, meow_deci(-a.as.d))
+
+MEOW_UNARY(i64_to_f64, meow_deci(a.type == MEOW_BIG ? meow_big_to_double(a.as.big) : (double)a.as.i))
+MEOW_UNARY(not, meow_bool(!a.as.b))
+
+MEOW_BINARY(eq_i64, meow_bool(meow_compare_ints(a, b) == 0))
+MEOW_BINARY(ne_i64, meow_bool(meow_compare_ints(a, b) != 0))
+MEOW_BINARY(less_i64, meow_bool(meow_compare_ints(a, b) < 0))
+MEOW_BINARY(less_equal_i64, meow_bool(meow_compare_ints(a, b) <= 0))
+MEOW_BINARY(greater_i64, meow_bool(meow_compare_ints(a, b) > 0))
+MEOW_BINARY(greater_equal_i64, meow_bool(meow_compare_ints(a, b) >= 0))
+
+MEOW_BINARY(eq_f64, meow_bool(a.as.d == b.as.d))
+MEOW_BINARY(ne_f64, meow_bool(a.as.d != b.as.d))
+MEOW_BINARY(less_f64, meow_bool(a.as.d < b.as.d))
+MEOW_BINARY(less_equal_f64, meow_bool(a.as.d <= b.as.d))
+MEOW_BINARY(greater_f64, meow_bool(a.as.d > b.as.d))
+MEOW_BINARY(greater_equal_f64, meow_bool(a.as.d >= b.as.d))
+
+/* Code only jumps forward, so every concatenation runs at most once and
+   its result is simply never freed. */
+static inline meow_value meow_add_str(meow_value a, meow_value b) {
+    size_t length = a.as.s.length + b.as.s.length;
+    char* data = (char*)malloc(length ? length : 1);
+    if (!data) meow_fail("Out of memory");
+    if (a.as.s.length) memcpy(data, a.as.s.data, a.as.s.length);
+    if (b.as.s.length) memcpy(data + a.as.s.length, b.as.s.data, b.as.s.length);
+    return meow_string(data, length);
+}
+
+/* Byte-wise, then by length, like std::string_view::compare. */
+static inline int meow_compare_strings(meow_value a, meow_value b) {
+    size_t n = a.as.s.length < b.as.s.length ? a.as.s.length : b.as.s.length;
+    int c = n ? memcmp(a.as.s.data, b.as.s.data, n) : 0;
+    if (c != 0) return c < 0 ? -1 : 1;
+    return (a.as.s.length > b.as.s.length) - (a.as.s.length < b.as.s.length);
+}
+
+MEOW_BINARY(eq_str, meow_bool(meow_compare_strings(a, b) == 0))
+MEOW_BINARY(ne_str, meow_bool(meow_compare_strings(a, b) != 0))
+MEOW_BINARY(less_str, meow_bool(meow_compare_strings(a, b) < 0))
+MEOW_BINARY(less_equal_str, meow_bool(meow_compare_strings(a, b) <= 0))
+MEOW_BINARY(greater_str, meow_bool(meow_compare_strings(a, b) > 0))
+MEOW_BINARY(greater_equal_str, meow_bool(meow_compare_strings(a, b) >= 0))
+
+static inline int meow_is_number(meow_value v) { return v.type == MEOW_INT || v.type == MEOW_DECI; }
+static inline double meow_number(meow_value v) { return v.type == MEOW_INT ? (double)v.as.i : v.as.d; }
+
+static inline int meow_scalars_equal(meow_value a, meow_value b) {
+    if (meow_is_number(a) && meow_is_number(b)) {
+        if (a.type == MEOW_INT && b.type == MEOW_INT) return a.as.i == b.as.i;
+        return meow_number(a) == meow_number(b);
+    }
+    if (a.type != b.type) return 0;
+    if (a.type == MEOW_BOOL) return a.as.b == b.as.b;
+    if (a.type == MEOW_CHAR) return a.as.c == b.as.c;
+    return 0;
+}
+
+static inline int meow_compare_scalars(meow_value a, meow_value b) {
+    if (a.type == MEOW_INT && b.type == MEOW_INT) return (a.as.i > b.as.i) - (a.as.i < b.as.i);
+    if (meow_is_number(a) && meow_is_number(b)) {
+        double x = meow_number(a), y = meow_number(b);
+        return (x > y) - (x < y);
+    }
+    if (a.type == MEOW_CHAR && b.type == MEOW_CHAR) return (a.as.c > b.as.c) - (a.as.c < b.as.c);
+    meow_fail("Operands cannot be compared");
+    return 0;
+}
+
+MEOW_BINARY(equal, meow_bool(meow_scalars_equal(a, b)))
+MEOW_BINARY(not_equal, meow_bool(!meow_scalars_equal(a, b)))
+MEOW_BINARY(less, meow_bool(meow_compare_scalars(a, b) < 0))
+MEOW_BINARY(less_equal, meow_bool(meow_compare_scalars(a, b) <= 0))
+MEOW_BINARY(greater, meow_bool(meow_compare_scalars(a, b) > 0))
+MEOW_BINARY(greater_equal, meow_bool(meow_compare_scalars(a, b) >= 0))
+
+MEOW_BINARY(and, meow_bool(a.as.b && b.as.b))
+MEOW_BINARY(or, meow_bool(a.as.b || b.as.b))
+
+/* Reads `count` significant digits with decimal exponent `exponent` back. */
+static inline double meow_read_digits(const char* digits, int count, int exponent) {
+    char text[40];
+    memcpy(text, digits, (size_t)count);
+    snprintf(text + count, sizeof(text) - (size_t)count, "e%d", exponent - count + 1);
+    return strtod(text, NULL);
+}
+
+/* Adds `step` (1 or -1) to the last of `count` digits; 0 when that would
+   carry out of, or zero, the first digit. */
+static inline int meow_step_digits(char* digits, int count, int step) {
+    int i;
+    for (i = count - 1; i >= 0; i--) {
+        char next = (char)(digits[i] + step);
+        if (next >= '0' && next <= '9') {
+            digits[i] = next;
+            return i > 0 || next != '0';
+        }
+        digits[i] = step > 0 ? '0' : '9';
+    }
+    return 0;
+}
+
+/* The fewest significant digits that read back as `v` (v > 0). */
+static inline int meow_shortest_digits(double v, char* digits, int* exponent) {
+    int count;
+    for (count = 1; count <= 17; count++) {
+        char text[40], other[20];
+        char* e;
+        char* p;
+        int n = 0, step;
+        snprintf(text, sizeof(text), "%.*e", count - 1, v);
+        e = strchr(text, 'e');
+        for (p = text; p < e; p++) {
+            if (*p != '.') digits[n++] = *p;
+        }
+        *exponent = atoi(e + 1);
+        if (meow_read_digits(digits, count, *exponent) == v) return count;
+        /* The correctly rounded digits can miss where the gap to the next
+           double changes; a neighbour may still read back. */
+        for (step = -1; step <= 1; step += 2) {
+            memcpy(other, digits, (size_t)count);
+            if (meow_step_digits(other, count, step) && meow_read_digits(other, count, *exponent) == v) {
+                memcpy(digits, other, (size_t)count);
+                return count;
+            }
+        }
+    }
+    return 17;
+}
+
+/* Shortest round-trip text in fixed or scientific notation, whichever is
+   shorter (fixed on a tie); a whole number in fixed notation is exact. */
+static inline void meow_print_deci(double v) {
+    char digits[20], text[48];
+    int count, exponent, length = 0;
+    if (isnan(v)) {
+        puts("nan");
+        return;
+    }
+    if (isinf(v)) {
+        puts(v < 0 ? "-inf" : "inf");
+        return;
+    }
+    if (signbit(v)) {
+        text[length++] = '-';
+        v = -v;
+    }
+    if (v == 0) {
+        text[length++] = '0';
+    } else {
+        int scientific, fixed;
+        count = meow_shortest_digits(v, digits, &exponent);
+        while (count > 1 && digits[count - 1] == '0') count--;
+        scientific = count + (count > 1) + 2 + (abs(exponent) >= 100 ? 3 : 2);
+        fixed = exponent >= count - 1 ? exponent + 1 : exponent >= 0 ? count + 1 : count + 1 - exponent;
+        if (scientific < fixed) {
+            text[length++] = digits[0];
+            if (count > 1) {
+                text[length++] = '.';
+                memcpy(text + length, digits + 1, (size_t)count - 1);
+                length += count - 1;
+            }
+            length += sprintf(text + length, "e%c%02d", exponent < 0 ? '-' : '+', abs(exponent));
+        } else if (exponent >= count - 1) {
+            length += sprintf(text + length, "%.0f", v);
+        } else if (exponent >= 0) {
+            memcpy(text + length, digits, (size_t)exponent + 1);
+            length += exponent + 1;
+            text[length++] = '.';
+            memcpy(text + length, digits + exponent + 1, (size_t)(count - exponent - 1));
+            length += count - exponent - 1;
+        } else {
+            int i;
+            text[length++] = '0';
+            text[length++] = '.';
+            for (i = -1; i > exponent; i--) text[length++] = '0';
+            memcpy(text + length, digits, (size_t)count);
+            length += count;
+        }
+    }
+    text[length] = '\0';
+    puts(text);
+}
+
+static inline void meow_print(meow_value v) {
+    switch (v.type) {
+        case MEOW_INT: printf("%" PRId64 "\n", v.as.i); break;
+        case MEOW_DECI: meow_print_deci(v.as.d); break;
+        case MEOW_BOOL: puts(v.as.b ? "true" : "false"); break;
+        case MEOW_CHAR: putchar(v.as.c); putchar('\n'); break;
+        case MEOW_STRING:
+            if (v.as.s.length) fwrite(v.as.s.data, 1, v.as.s.length, stdout);
+            putchar('\n');
+            break;
+        case MEOW_BIG: meow_print_big(v.as.big); break;
+    }
+}
+)meow";
+
+// Locals are declared this many to a line.
+const size_t kLocalsPerLine = 8;
+
+// Runtime function of an operator: meow_ and its lower-case opcode name.
+std::string runtimeFunction(OpCode op) {
+    std::string name = "meow_";
+    for (const char* p = opCodeName(op); *p; p++) {
+        name += static_cast<char>(std::tolower(static_cast<unsigned char>(*p)));
+    }
+    return name;
+}
+
+std::string quote(std::string_view text) {
+    std::string out = "\"";
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\' || c == '?') {
+            // '?' so that no trigraph can form.
+            out += '\\';
+            out += c;
+        } else if (byte >= 0x20 && byte < 0x7F) {
+            out += c;
+        } else {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\%03o", byte);
+            out += escape;
+        }
+    }
+    return out + "\"";
+}
+
+// A big int constant is parsed once, into local k<index>.
+std::string literal(const ConstantPool& pool, uint32_t index) {
+    const Value& value = pool.constants[index];
+    char text[64];
+    switch (value.type) {
+        case ValueType::INT:
+            if (value.inlineLength == kHeapInt) {
+                std::string digits = BigInt::parse(pool.strings.at(value.as.s)).toString();
+                return "meow_big_constant(&k" + std::to_string(index) + ", \"" + digits + "\")";
+            }
+            if (value.as.i == INT64_MIN) {
+                return "meow_int(INT64_MIN)";
+            }
+            return "meow_int(INT64_C(" + std::to_string(value.as.i) + "))";
+        case ValueType::DECI:
+            if (std::isfinite(value.as.d)) {
+                std::snprintf(text, sizeof(text), "meow_deci(%a)", value.as.d);
+            } else {
+                uint64_t bits;
+                std::memcpy(&bits, &value.as.d, sizeof(bits));
+                std::snprintf(text, sizeof(text), "meow_deci_bits(UINT64_C(0x%016llx))",
+                              static_cast<unsigned long long>(bits));
+            }
+            return text;
+        case ValueType::BOOL:
+            return value.as.b ? "meow_bool(1)" : "meow_bool(0)";
+        case ValueType::CHAR:
+            return "meow_char(" + std::to_string(static_cast<int>(value.as.c)) + ")";
+        case ValueType::STRING: {
+            const std::string& s = pool.strings.at(value.as.s);
+            return "meow_string(" + quote(s) + ", " + std::to_string(s.size()) + ")";
+        }
+    }
+    return "meow_int(0)";
+}
+
+// Declares prefix0, prefix1, ... for the indices in `used`.
+void declare(std::string& out, char prefix, const std::vector<bool>& used) {
+    size_t onLine = 0;
+    for (size_t i = 0; i < used.size(); i++) {
+        if (!used[i]) {
+            continue;
+        }
+        out += onLine == 0 ? "    meow_value " : ", ";
+        out += std::string(1, prefix) + std::to_string(i) + " = {0}";
+        if (++onLine == kLocalsPerLine) {
+            out += ";\n";
+            onLine = 0;
+        }
+    }
+    if (onLine > 0) {
+        out += ";\n";
+    }
+}
+
+struct Step {
+    size_t offset;
+    OpCode op;
+    uint32_t operand;
+    int32_t depth; // before the instruction; -1 if it is never reached
+};
+}
+
+std::string emitC(const ChunkView& chunk, std::string_view sourceName) {
+    // First pass: decode the verified code, with the stack depth before
+    // every instruction.
+    VerifiedCode verified = verify(chunk);
+    std::vector<Step> steps;
+    std::vector<bool> isTarget(chunk.codeSize, false);
+    std::vector<bool> isLoaded(chunk.slotCount, false); // stores to others are dropped
+    std::vector<bool> isBigConstant(chunk.pool->constants.size(), false);
+    for (size_t offset = 0; offset < chunk.codeSize;) {
+        OpCode op = static_cast<OpCode>(chunk.code[offset]);
+        size_t length = 1 + operandWidth(op);
+        uint32_t operand = length == 5 ? readU32(chunk.code + offset + 1)
+                         : length == 3 ? readU16(chunk.code + offset + 1) : 0;
+        int32_t depth = verified.depthAt[offset];
+        steps.push_back(Step{offset, op, operand, depth});
+        if (depth >= 0 && op == OpCode::LOAD_VAR) {
+            isLoaded[operand] = true;
+        }
+        if (depth >= 0 && op == OpCode::LOAD_CONST && chunk.pool->constants[operand].inlineLength == kHeapInt) {
+            isBigConstant[operand] = true;
+        }
+        if (depth >= 0 && (op == OpCode::JUMP || op == OpCode::JUMP_IF_FALSE)) {
+            isTarget[operand] = true;
+        }
+        offset += length;
+    }
+    int32_t maxDepth = static_cast<int32_t>(verified.maxDepth);
+
+    // Second pass: one statement per instruction. Operands and results
+    // use the locals of their stack entries.
+    std::string out = "// Generated by meow emit-c from " + std::string(sourceName) + ".\n";
+    out += kRuntime;
+    out += "\nint main(void) {\n";
+    declare(out, 'v', isLoaded);
+    declare(out, 'k', isBigConstant);
+    declare(out, 's', std::vector<bool>(static_cast<size_t>(maxDepth), true));
+    int line = 0;
+    for (const Step& step : steps) {
+        if (isTarget[step.offset]) {
+            out += "L" + std::to_string(step.offset) + ":;\n";
+        }
+        if (step.depth < 0) {
+            continue;
+        }
+        int stepLine = chunk.lines ? chunk.lines->lineAt(step.offset) : 0;
+        if (stepLine > 0 && stepLine != line) {
+            line = stepLine;
+            out += "    /* line " + std::to_string(line) + " */\n";
+        }
+
+        std::string top = "s" + std::to_string(step.depth - 1);
+        std::string left = "s" + std::to_string(step.depth - 2); // of a binary operator
+        std::string operand = std::to_string(step.operand);
+        switch (step.op) {
+            case OpCode::LOAD_CONST:
+                out += "    s" + std::to_string(step.depth) + " = " + literal(*chunk.pool, step.operand) + ";\n";
+                break;
+            case OpCode::LOAD_VAR:
+                out += "    s" + std::to_string(step.depth) + " = v" + operand + ";\n";
+                break;
+            case OpCode::STORE_VAR:
+                if (isLoaded[step.operand]) {
+                    out += "    v" + operand + " = " + top + ";\n";
+                }
+                break;
+            case OpCode::POP:
+                out += "    (void)" + top + ";\n";
+                break;
+            case OpCode::PRINT:
+                out += "    meow_print(" + top + ");\n";
+                break;
+            case OpCode::JUMP:
+                out += "    goto L" + operand + ";\n";
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                out += "    if (!" + top + ".as.b) goto L" + operand + ";\n";
+                break;
+            case OpCode::HALT:
+                out += "    return meow_halt();\n";
+                break;
+            default:
+                if (stackInputs(step.op) == 1) {
+                    out += "    " + top + " = " + runtimeFunction(step.op) + "(" + top + ");\n";
+                } else {
+                    out += "    " + left + " = " + runtimeFunction(step.op) + "(" + left + ", " + top + ");\n";
+                }
+                break;
+        }
+    }
+    out += "}\n";
+    return out;
+}
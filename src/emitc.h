@@ -0,0 +1,19 @@
+#ifndef EMITC_H
+#define EMITC_H
+
+#include "bytecode.h"
+#include <string>
+#include <string_view>
+
+// Ahead-of-time compilation behind `meow emit-c`: lowers a stack-machine
+// program to one standalone C99 translation unit that carries its own
+// small runtime, so `cc -O2 file.c -lm` builds a native executable with
+// the same output, errors and exit status as `meow run`.
+//
+// As in the JIT, every stack entry becomes a fixed local because the
+// stack depth at each instruction is known; variables are locals too and
+// jumps become gotos. `sourceName` only goes into a comment. Throws
+// std::runtime_error for code that fails verify() (verifier.h).
+std::string emitC(const ChunkView& chunk, std::string_view sourceName);
+
+#endif
@@ -0,0 +1,131 @@
+#include "image.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+const char kMagic[8] = {'M', 'E', 'O', 'W', 'I', 'M', 'G', '\0'};
+
+uint64_t stringPayload(size_t offset, size_t length) {
+    if (offset > UINT32_MAX || length > UINT32_MAX) {
+        throw std::runtime_error("Image too large");
+    }
+    return static_cast<uint64_t>(offset) | static_cast<uint64_t>(length) << 32;
+}
+}
+
+void writeImage(const std::string& path, const TypeChecker& checker, const Compiler& compiler, const VM& vm) {
+    std::vector<ImageGlobal> globals;
+    std::string text;
+    for (const auto& [name, slot] : compiler.globals()) {
+        auto type = checker.globals().find(name);
+        if (type == checker.globals().end() || static_cast<size_t>(slot) >= vm.variableCount()) {
+            throw std::runtime_error("Global '" + name + "' has no value to save");
+        }
+        const Value& value = vm.variable(static_cast<size_t>(slot));
+        ImageGlobal global = {};
+        global.nameOffset = static_cast<uint32_t>(stringPayload(text.size(), name.size()));
+        global.nameLength = static_cast<uint32_t>(name.size());
+        global.slot = static_cast<uint32_t>(slot);
+        global.type = static_cast<uint8_t>(type->second);
+        text += name;
+        if (type->second == ValueType::STRING) {
+            std::string_view bytes = vm.text(value);
+            global.payload = stringPayload(text.size(), bytes.size());
+            text += bytes;
+        } else if (value.type == ValueType::INT && value.inlineLength == kHeapInt) {
+            std::string digits = vm.bigInt(value).toString();
+            global.flags = kImageBigInt;
+            global.payload = stringPayload(text.size(), digits.size());
+            text += digits;
+        } else {
+            std::memcpy(&global.payload, &value.as, sizeof(global.payload));
+        }
+        globals.push_back(global);
+    }
+
+    ImageHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kImageVersion;
+    header.globalCount = static_cast<uint32_t>(globals.size());
+    header.textSize = text.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(globals.data()),
+              static_cast<std::streamsize>(globals.size() * sizeof(ImageGlobal)));
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!out) {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+}
+
+Image::Image(const std::string& path)
+    : file(path), globals(nullptr), text(nullptr), globalCount(0) {
+    ImageHeader header;
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error("Not a MeowLang image: " + path);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a MeowLang image: " + path);
+    }
+    if (header.version != kImageVersion) {
+        throw std::runtime_error("Image was written by a different version: " + path);
+    }
+    size_t available = file.size() - sizeof(header);
+    if (header.globalCount > available / sizeof(ImageGlobal) ||
+        header.textSize != available - header.globalCount * sizeof(ImageGlobal)) {
+        throw std::runtime_error("Corrupt image: truncated");
+    }
+
+    // The mapping is page aligned and the header a multiple of 8 bytes, so
+    // the globals are read in place.
+    globals = reinterpret_cast<const ImageGlobal*>(file.data() + sizeof(header));
+    text = reinterpret_cast<const char*>(globals + header.globalCount);
+    globalCount = header.globalCount;
+
+    // Globals take the slots from 0 up, each exactly once.
+    std::vector<bool> seen(globalCount, false);
+    for (uint32_t i = 0; i < globalCount; i++) {
+        const ImageGlobal& global = globals[i];
+        bool isBigInt = global.flags == kImageBigInt;
+        bool hasText = global.type == static_cast<uint8_t>(ValueType::STRING) || isBigInt;
+        uint64_t stringOffset = global.payload & UINT32_MAX;
+        uint64_t stringLength = global.payload >> 32;
+        if (global.slot >= globalCount || seen[global.slot] ||
+            global.type > static_cast<uint8_t>(ValueType::STRING) ||
+            (global.flags != 0 && !(isBigInt && global.type == static_cast<uint8_t>(ValueType::INT))) ||
+            global.nameOffset > header.textSize || global.nameLength > header.textSize - global.nameOffset ||
+            (hasText && (stringOffset > header.textSize || stringLength > header.textSize - stringOffset))) {
+            throw std::runtime_error("Corrupt image: bad global");
+        }
+        seen[global.slot] = true;
+    }
+}
+
+void Image::restore(TypeChecker& checker, Compiler& compiler, VM& vm) const {
+    if (!checker.globals().empty() || !compiler.globals().empty()) {
+        throw std::runtime_error("An image must be restored before anything is compiled");
+    }
+    for (uint32_t i = 0; i < globalCount; i++) {
+        const ImageGlobal& global = globals[i];
+        std::string name(text + global.nameOffset, global.nameLength);
+        ValueType type = static_cast<ValueType>(global.type);
+        checker.declareGlobal(name, type);
+        compiler.declareGlobal(name, static_cast<int>(global.slot));
+        if (type == ValueType::STRING) {
+            vm.setVariable(global.slot, std::string_view(text + (global.payload & UINT32_MAX),
+                                                          static_cast<size_t>(global.payload >> 32)));
+        } else if (global.flags == kImageBigInt) {
+            vm.setVariable(global.slot, BigInt::parse(std::string_view(text + (global.payload & UINT32_MAX),
+                                                                       static_cast<size_t>(global.payload >> 32))));
+        } else {
+            Value value;
+            value.type = type;
+            std::memcpy(&value.as, &global.payload, sizeof(global.payload));
+            vm.setVariable(global.slot, value);
+        }
+    }
+}
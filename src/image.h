@@ -0,0 +1,68 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "compiler.h"
+#include "mappedfile.h"
+#include "typechecker.h"
+#include "vm.h"
+#include <cstdint>
+#include <string>
+
+// Heap images behind `meow snapshot` and `--image`: the global variables
+// a program leaves behind, with their types, slots and values, so that a
+// later run starts from them without executing the program again.
+//
+// On-disk layout (all fields little-endian, no pointers):
+//
+//   header  ImageHeader
+//   globals globalCount x ImageGlobal
+//   text    textSize bytes: every name, the bytes of every string and
+//           the decimal digits of every big int
+//
+// Code is not kept: once the program has run, only its globals can be
+// observed by later code. kImageVersion must be bumped whenever this
+// layout or the Value encoding changes.
+constexpr uint32_t kImageVersion = 2;
+
+// ImageGlobal::flags
+constexpr uint8_t kImageBigInt = 1;  // an INT kept as decimal text
+
+struct ImageHeader {
+    char magic[8];        // "MEOWIMG\0"
+    uint32_t version;     // kImageVersion
+    uint32_t globalCount;
+    uint64_t textSize;
+};
+
+struct ImageGlobal {
+    uint32_t nameOffset;  // into the text
+    uint32_t nameLength;
+    uint32_t slot;
+    uint8_t type;         // ValueType
+    uint8_t flags;        // kImage* bits
+    uint8_t reserved[2];  // zero
+    uint64_t payload;     // the value's bits; for a string or big int, text offset and length
+};
+
+// Writes the globals known to `checker` and `compiler` with their values
+// in `vm` after a run.
+void writeImage(const std::string& path, const TypeChecker& checker, const Compiler& compiler, const VM& vm);
+
+// An image mapped and checked on open; restore() copies it into a fresh
+// front end and VM. Errors throw std::runtime_error.
+class Image {
+private:
+    MappedFile file;
+    const ImageGlobal* globals;
+    const char* text;
+    uint32_t globalCount;
+
+public:
+    explicit Image(const std::string& path);
+
+    // The globals are declared in `checker` and `compiler`, which must
+    // not have seen any yet, and set in `vm`.
+    void restore(TypeChecker& checker, Compiler& compiler, VM& vm) const;
+};
+
+#endif
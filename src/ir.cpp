@@ -0,0 +1,940 @@
+#include "ir.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+const uint32_t kMaxSlots = UINT16_MAX + 1;
+
+// Int division is the only operation that can fail at run time; it is
+// never removed, and the globals must be up to date wherever it runs.
+bool mayFail(OpCode op) {
+    return op == OpCode::DIV_I64 || op == OpCode::MOD_I64;
+}
+
+// The operation that gives the same result with the operands swapped,
+// if there is one.
+bool mirroredOp(OpCode op, OpCode& mirror) {
+    switch (op) {
+        case OpCode::ADD_I64: case OpCode::MUL_I64: case OpCode::ADD_F64: case OpCode::MUL_F64:
+        case OpCode::EQ_I64: case OpCode::NE_I64: case OpCode::EQ_F64: case OpCode::NE_F64:
+        case OpCode::EQ_STR: case OpCode::NE_STR: case OpCode::EQUAL: case OpCode::NOT_EQUAL:
+        case OpCode::AND: case OpCode::OR:
+            mirror = op;
+            return true;
+        case OpCode::LESS_I64: mirror = OpCode::GREATER_I64; return true;
+        case OpCode::GREATER_I64: mirror = OpCode::LESS_I64; return true;
+        case OpCode::LESS_EQUAL_I64: mirror = OpCode::GREATER_EQUAL_I64; return true;
+        case OpCode::GREATER_EQUAL_I64: mirror = OpCode::LESS_EQUAL_I64; return true;
+        case OpCode::LESS_F64: mirror = OpCode::GREATER_F64; return true;
+        case OpCode::GREATER_F64: mirror = OpCode::LESS_F64; return true;
+        case OpCode::LESS_EQUAL_F64: mirror = OpCode::GREATER_EQUAL_F64; return true;
+        case OpCode::GREATER_EQUAL_F64: mirror = OpCode::LESS_EQUAL_F64; return true;
+        case OpCode::LESS_STR: mirror = OpCode::GREATER_STR; return true;
+        case OpCode::GREATER_STR: mirror = OpCode::LESS_STR; return true;
+        case OpCode::LESS_EQUAL_STR: mirror = OpCode::GREATER_EQUAL_STR; return true;
+        case OpCode::GREATER_EQUAL_STR: mirror = OpCode::LESS_EQUAL_STR; return true;
+        case OpCode::LESS: mirror = OpCode::GREATER; return true;
+        case OpCode::GREATER: mirror = OpCode::LESS; return true;
+        case OpCode::LESS_EQUAL: mirror = OpCode::GREATER_EQUAL; return true;
+        case OpCode::GREATER_EQUAL: mirror = OpCode::LESS_EQUAL; return true;
+        default:
+            return false;
+    }
+}
+
+int argCount(const IrInstr& instr) {
+    return stackInputs(instr.op);
+}
+
+void successors(const IrBlock& block, std::vector<uint32_t>& out) {
+    out.clear();
+    const IrInstr& last = block.code.back();
+    if (last.op == OpCode::JUMP) {
+        out.push_back(last.operand);
+    } else if (last.op == OpCode::JUMP_IF_FALSE) {
+        out.push_back(last.operand);
+        if (last.operand2 != last.operand) out.push_back(last.operand2);
+    }
+}
+
+std::vector<std::vector<uint32_t>> predecessors(const IrProgram& program) {
+    std::vector<std::vector<uint32_t>> preds(program.blocks.size());
+    std::vector<uint32_t> succ;
+    for (uint32_t b = 0; b < program.blocks.size(); b++) {
+        successors(program.blocks[b], succ);
+        for (uint32_t s : succ) preds[s].push_back(b);
+    }
+    return preds;
+}
+
+// Passes mark the instructions they remove with this op, which the IR
+// never uses otherwise, and sweep each block afterwards.
+const OpCode kDropped = OpCode::POP;
+
+void sweep(IrBlock& block) {
+    auto& code = block.code;
+    code.erase(std::remove_if(code.begin(), code.end(),
+                              [](const IrInstr& instr) { return instr.op == kDropped; }),
+               code.end());
+}
+
+// Follows a replacement chain to the value that stands for `value`.
+uint32_t resolve(std::vector<uint32_t>& replacement, uint32_t value) {
+    if (value == kNoValue) return value;
+    uint32_t root = value;
+    while (replacement[root] != kNoValue) root = replacement[root];
+    while (replacement[value] != kNoValue) {
+        uint32_t next = replacement[value];
+        replacement[value] = root;
+        value = next;
+    }
+    return root;
+}
+
+void resolveArgs(IrInstr& instr, std::vector<uint32_t>& replacement) {
+    for (int i = 0; i < argCount(instr); i++) {
+        instr.args[i] = resolve(replacement, instr.args[i]);
+    }
+}
+
+// Removes the values nobody uses, other than those that can fail. Uses
+// always come after their definition in block order, so one backward
+// walk also removes the operands that only fed a removed value.
+void removeDeadValues(IrProgram& program) {
+    std::vector<uint32_t> uses(program.valueCount, 0);
+    for (const IrBlock& block : program.blocks) {
+        for (const IrInstr& instr : block.code) {
+            for (int i = 0; i < argCount(instr); i++) uses[instr.args[i]]++;
+        }
+    }
+    for (auto block = program.blocks.rbegin(); block != program.blocks.rend(); ++block) {
+        for (auto instr = block->code.rbegin(); instr != block->code.rend(); ++instr) {
+            if (instr->result != kNoValue && uses[instr->result] == 0 && !mayFail(instr->op)) {
+                for (int i = 0; i < argCount(*instr); i++) uses[instr->args[i]]--;
+                instr->op = kDropped;
+            }
+        }
+        sweep(*block);
+    }
+}
+
+// Immediate dominators; blocks only jump forward, so one pass in block
+// order sees every predecessor first. Unreachable blocks get kNoValue.
+std::vector<uint32_t> immediateDominators(const IrProgram& program) {
+    auto preds = predecessors(program);
+    std::vector<uint32_t> idom(program.blocks.size(), kNoValue);
+    idom[0] = 0;
+    for (uint32_t b = 1; b < program.blocks.size(); b++) {
+        uint32_t dom = kNoValue;
+        for (uint32_t p : preds[b]) {
+            if (idom[p] == kNoValue) continue;
+            if (dom == kNoValue) {
+                dom = p;
+                continue;
+            }
+            uint32_t other = p;
+            while (dom != other) {
+                while (dom > other) dom = idom[dom];
+                while (other > dom) other = idom[other];
+            }
+        }
+        idom[b] = dom;
+    }
+    return idom;
+}
+
+void describe(std::ostream& out, const IrProgram& program, const IrInstr& instr) {
+    if (instr.result != kNoValue) out << "v" << instr.result << " = ";
+    out << opCodeName(instr.op);
+    switch (instr.op) {
+        case OpCode::LOAD_CONST:
+            out << " " << instr.operand << "\t; " << describeConstant(program, instr.operand);
+            return;
+        case OpCode::LOAD_VAR:
+        case OpCode::STORE_VAR:
+            out << " " << instr.operand;
+            break;
+        case OpCode::JUMP:
+            out << " b" << instr.operand;
+            return;
+        default:
+            break;
+    }
+    for (int i = 0; i < argCount(instr); i++) out << " v" << instr.args[i];
+    if (instr.op == OpCode::JUMP_IF_FALSE) {
+        out << " b" << instr.operand << " (else b" << instr.operand2 << ")";
+    }
+    if ((instr.op == OpCode::LOAD_VAR || instr.op == OpCode::STORE_VAR) &&
+        instr.operand < program.slotNames.size() && !program.slotNames[instr.operand].empty()) {
+        out << "\t; " << program.slotNames[instr.operand];
+    }
+}
+}
+
+const char* irPassName(IrPass pass) {
+    switch (pass) {
+        case IR_COPY_PROPAGATION: return "copy-prop";
+        case IR_CSE: return "cse";
+        case IR_DEAD_STORES: return "dse";
+        case IR_JUMP_THREADING: return "jump-threading";
+    }
+    return "?";
+}
+
+bool parseIrPasses(std::string_view list, unsigned& passes) {
+    if (list == "all") {
+        passes = kAllIrPasses;
+        return true;
+    }
+    if (list == "none") {
+        passes = 0;
+        return true;
+    }
+    unsigned parsed = 0;
+    while (true) {
+        size_t comma = list.find(',');
+        std::string_view name = list.substr(0, comma);
+        unsigned found = 0;
+        for (IrPass pass : {IR_COPY_PROPAGATION, IR_CSE, IR_DEAD_STORES, IR_JUMP_THREADING}) {
+            if (name == irPassName(pass)) found = pass;
+        }
+        if (found == 0) return false;
+        parsed |= found;
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    passes = parsed;
+    return true;
+}
+
+std::string dumpIr(const IrProgram& program) {
+    std::ostringstream out;
+    for (size_t b = 0; b < program.blocks.size(); b++) {
+        out << "b" << b << ":\n";
+        for (const IrInstr& instr : program.blocks[b].code) {
+            out << "  ";
+            describe(out, program, instr);
+            out << "\n";
+        }
+    }
+    return out.str();
+}
+
+
+// ================= COPY PROPAGATION =================
+//
+// Tracks which value each slot holds. A block starts with what all its
+// predecessors agree on; unreachable blocks know nothing.
+
+void propagateCopies(IrProgram& program) {
+    auto preds = predecessors(program);
+    std::vector<uint32_t> replacement(program.valueCount, kNoValue);
+
+    // current[slot] is the value the slot holds at the point being
+    // visited. Every change to it is journaled, so the state at the end of
+    // an earlier block is current with the changes since then undone.
+    struct Change {
+        uint32_t slot;
+        uint32_t before;
+    };
+    std::vector<uint32_t> current(program.slotCount, kNoValue);
+    std::vector<Change> journal;
+    std::vector<size_t> exitMark(program.blocks.size(), 0);
+    auto set = [&](uint32_t slot, uint32_t value) {
+        if (current[slot] == value) return;
+        journal.push_back({slot, current[slot]});
+        current[slot] = value;
+    };
+
+    const uint32_t kUnset = kNoValue - 1;
+    std::vector<uint32_t> seen(program.slotCount, 0), agreed(program.slotCount, kUnset);
+    std::vector<uint32_t> touched;
+    uint32_t epoch = 0;
+    auto merge = [&](uint32_t slot, uint32_t value) {
+        agreed[slot] = agreed[slot] == kUnset || agreed[slot] == value ? value : kNoValue;
+    };
+
+    for (uint32_t b = 0; b < program.blocks.size(); b++) {
+        // Only slots changed since the earliest predecessor ended can
+        // differ between the predecessors and what current holds.
+        if (preds[b].empty()) {
+            if (b > 0) {
+                for (uint32_t slot = 0; slot < program.slotCount; slot++) set(slot, kNoValue);
+            }
+        } else {
+            size_t end = journal.size(), from = end;
+            for (uint32_t p : preds[b]) from = std::min(from, exitMark[p]);
+            touched.clear();
+            epoch++;
+            for (size_t i = from; i < end; i++) {
+                uint32_t slot = journal[i].slot;
+                if (seen[slot] == epoch) continue;
+                seen[slot] = epoch;
+                agreed[slot] = kUnset;
+                touched.push_back(slot);
+            }
+            for (uint32_t p : preds[b]) {
+                epoch++;
+                for (size_t i = exitMark[p]; i < end; i++) {
+                    uint32_t slot = journal[i].slot;
+                    if (seen[slot] == epoch) continue;
+                    seen[slot] = epoch;
+                    merge(slot, journal[i].before);
+                }
+                for (uint32_t slot : touched) {
+                    if (seen[slot] != epoch) merge(slot, current[slot]);
+                }
+            }
+            for (uint32_t slot : touched) set(slot, agreed[slot]);
+        }
+
+        for (IrInstr& instr : program.blocks[b].code) {
+            resolveArgs(instr, replacement);
+            if (instr.op == OpCode::LOAD_VAR) {
+                if (current[instr.operand] != kNoValue) {
+                    replacement[instr.result] = current[instr.operand];
+                    instr.op = kDropped;
+                    continue;
+                }
+                set(instr.operand, instr.result);
+            } else if (instr.op == OpCode::STORE_VAR) {
+                set(instr.operand, instr.args[0]);
+            }
+        }
+        sweep(program.blocks[b]);
+        exitMark[b] = journal.size();
+    }
+    removeDeadValues(program);
+}
+
+
+// ================= COMMON SUBEXPRESSIONS =================
+//
+// Value numbering over the dominator tree: an operator or constant with
+// the same operands as one in a dominating position reuses its value.
+// LOAD_VAR is left alone; copy propagation handles reads of slots.
+
+namespace {
+struct ExprKey {
+    OpCode op;
+    uint32_t args[2];
+    uint32_t operand;
+
+    bool operator==(const ExprKey& other) const {
+        return op == other.op && args[0] == other.args[0] && args[1] == other.args[1] &&
+               operand == other.operand;
+    }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey& key) const {
+        uint64_t h = static_cast<uint64_t>(key.op);
+        for (uint64_t part : {uint64_t{key.args[0]}, uint64_t{key.args[1]}, uint64_t{key.operand}}) {
+            h = (h ^ part) * 0x100000001b3ULL;
+        }
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+}
+
+void eliminateCommonSubexpressions(IrProgram& program) {
+    auto idom = immediateDominators(program);
+    std::vector<std::vector<uint32_t>> children(program.blocks.size());
+    for (uint32_t b = 1; b < program.blocks.size(); b++) {
+        if (idom[b] != kNoValue) children[idom[b]].push_back(b);
+    }
+
+    // Walks the dominator tree; the table holds what the dominators of
+    // the current block computed, and a block's entries are dropped again
+    // once its subtree is done.
+    std::unordered_map<ExprKey, uint32_t, ExprKeyHash> table;
+    table.reserve(program.valueCount);
+    std::vector<std::vector<ExprKey>> added(program.blocks.size());
+    std::vector<uint32_t> replacement(program.valueCount, kNoValue);
+    std::vector<std::pair<uint32_t, size_t>> path{{0, 0}}; // block, next child
+
+    auto visit = [&](uint32_t b) {
+        for (IrInstr& instr : program.blocks[b].code) {
+            resolveArgs(instr, replacement);
+            if (instr.result == kNoValue || instr.op == OpCode::LOAD_VAR) continue;
+            ExprKey key{instr.op, {kNoValue, kNoValue}, instr.op == OpCode::LOAD_CONST ? instr.operand : 0};
+            for (int i = 0; i < argCount(instr); i++) key.args[i] = instr.args[i];
+            auto found = table.find(key);
+            if (found != table.end()) {
+                replacement[instr.result] = found->second;
+                instr.op = kDropped;
+                continue;
+            }
+            table.emplace(key, instr.result);
+            added[b].push_back(key);
+        }
+        sweep(program.blocks[b]);
+    };
+
+    visit(0);
+    while (!path.empty()) {
+        auto& [block, next] = path.back();
+        if (next < children[block].size()) {
+            uint32_t child = children[block][next++];
+            visit(child);
+            path.emplace_back(child, 0);
+            continue;
+        }
+        for (const ExprKey& key : added[block]) table.erase(key);
+        path.pop_back();
+    }
+    for (uint32_t b = 1; b < program.blocks.size(); b++) {
+        if (idom[b] != kNoValue) continue;
+        for (IrInstr& instr : program.blocks[b].code) resolveArgs(instr, replacement);
+    }
+    removeDeadValues(program);
+}
+
+
+// ================= DEAD STORES =================
+//
+// Backward slot liveness. Nothing is live after HALT but the globals.
+
+void eliminateDeadStores(IrProgram& program) {
+    // Live slots as bit sets of 64-bit words, one set per block entry.
+    size_t words = (program.slotCount + 63) / 64;
+    std::vector<uint64_t> globals(words, 0);
+    for (uint32_t slot = 0; slot < program.slotCount; slot++) {
+        if (program.liveOut[slot]) globals[slot / 64] |= uint64_t{1} << (slot % 64);
+    }
+    std::vector<uint64_t> liveIn(program.blocks.size() * words, 0);
+    std::vector<uint32_t> succ;
+    std::vector<uint64_t> live(words);
+
+    for (size_t b = program.blocks.size(); b-- > 0;) {
+        auto& code = program.blocks[b].code;
+        if (code.back().op == OpCode::HALT) {
+            live = globals;
+        } else {
+            std::fill(live.begin(), live.end(), 0);
+        }
+        successors(program.blocks[b], succ);
+        for (uint32_t s : succ) {
+            for (size_t w = 0; w < words; w++) live[w] |= liveIn[s * words + w];
+        }
+
+        for (auto instr = code.rbegin(); instr != code.rend(); ++instr) {
+            uint64_t bit = uint64_t{1} << (instr->operand % 64);
+            if (instr->op == OpCode::STORE_VAR) {
+                if (!(live[instr->operand / 64] & bit)) {
+                    instr->op = kDropped;
+                    continue;
+                }
+                live[instr->operand / 64] &= ~bit;
+            } else if (instr->op == OpCode::LOAD_VAR) {
+                live[instr->operand / 64] |= bit;
+            } else if (mayFail(instr->op)) {
+                for (size_t w = 0; w < words; w++) live[w] |= globals[w];
+            }
+        }
+        sweep(program.blocks[b]);
+        std::copy(live.begin(), live.end(), liveIn.begin() + b * words);
+    }
+    removeDeadValues(program);
+}
+
+
+// ================= JUMP THREADING =================
+
+namespace {
+// Drops the blocks that cannot be reached and merges a block into the one
+// jumping to it when that is its only predecessor. Block order, and with
+// it the forward-only jumps, is kept.
+void compactBlocks(IrProgram& program) {
+    size_t count = program.blocks.size();
+    std::vector<bool> reachable(count, false);
+    reachable[0] = true;
+    std::vector<uint32_t> succ;
+    for (uint32_t b = 0; b < count; b++) {
+        if (!reachable[b]) continue;
+        successors(program.blocks[b], succ);
+        for (uint32_t s : succ) reachable[s] = true;
+    }
+
+    std::vector<uint32_t> predCount(count, 0);
+    for (uint32_t b = 0; b < count; b++) {
+        if (!reachable[b]) continue;
+        successors(program.blocks[b], succ);
+        for (uint32_t s : succ) predCount[s]++;
+    }
+
+    // merged[b]: b's code now lives at the end of another block.
+    std::vector<bool> merged(count, false);
+    for (uint32_t b = 0; b < count; b++) {
+        if (!reachable[b] || merged[b]) continue;
+        auto& code = program.blocks[b].code;
+        while (code.back().op == OpCode::JUMP && predCount[code.back().operand] == 1) {
+            uint32_t target = code.back().operand;
+            code.pop_back();
+            auto& next = program.blocks[target].code;
+            code.insert(code.end(), next.begin(), next.end());
+            next.clear();
+            merged[target] = true;
+        }
+    }
+
+    std::vector<uint32_t> renumber(count, kNoValue);
+    std::vector<IrBlock> blocks;
+    for (uint32_t b = 0; b < count; b++) {
+        if (reachable[b] && !merged[b]) {
+            renumber[b] = static_cast<uint32_t>(blocks.size());
+            blocks.push_back(std::move(program.blocks[b]));
+        }
+    }
+    for (IrBlock& block : blocks) {
+        IrInstr& last = block.code.back();
+        if (last.op == OpCode::JUMP || last.op == OpCode::JUMP_IF_FALSE) last.operand = renumber[last.operand];
+        if (last.op == OpCode::JUMP_IF_FALSE) last.operand2 = renumber[last.operand2];
+    }
+    program.blocks = std::move(blocks);
+}
+}
+
+// A branch whose condition is a constant, or was already tested by a
+// branch that every path to it passes, becomes a jump; a jump to a block
+// that only jumps on goes straight to the final target.
+void threadJumps(IrProgram& program) {
+    using Facts = std::unordered_map<uint32_t, bool>; // condition value -> known outcome
+    std::vector<int> constantBool(program.valueCount, -1);
+    for (const IrBlock& block : program.blocks) {
+        for (const IrInstr& instr : block.code) {
+            if (instr.op == OpCode::LOAD_CONST && instr.operand < program.constants.size() &&
+                program.constants[instr.operand].type == ValueType::BOOL) {
+                constantBool[instr.result] = program.constants[instr.operand].as.b ? 1 : 0;
+            }
+        }
+    }
+
+    auto preds = predecessors(program);
+    std::vector<Facts> facts(program.blocks.size());
+    for (uint32_t b = 0; b < program.blocks.size(); b++) {
+        // Facts on entry: what holds along every incoming edge.
+        bool first = true;
+        for (uint32_t p : preds[b]) {
+            Facts edge = facts[p];
+            const IrInstr& branch = program.blocks[p].code.back();
+            if (branch.op == OpCode::JUMP_IF_FALSE && branch.operand != branch.operand2) {
+                edge[branch.args[0]] = b == branch.operand2;
+            }
+            if (first) {
+                facts[b] = std::move(edge);
+                first = false;
+                continue;
+            }
+            for (auto it = facts[b].begin(); it != facts[b].end();) {
+                auto match = edge.find(it->first);
+                it = match != edge.end() && match->second == it->second ? std::next(it) : facts[b].erase(it);
+            }
+        }
+
+        IrInstr& last = program.blocks[b].code.back();
+        if (last.op != OpCode::JUMP_IF_FALSE) continue;
+        int known = constantBool[last.args[0]];
+        auto fact = facts[b].find(last.args[0]);
+        if (fact != facts[b].end()) known = fact->second ? 1 : 0;
+        if (known >= 0 || last.operand == last.operand2) {
+            uint32_t target = known == 1 ? last.operand2 : last.operand;
+            last = IrInstr{OpCode::JUMP, kNoValue, {kNoValue, kNoValue}, target, 0, last.line};
+        }
+    }
+
+    auto skipJumps = [&](uint32_t target) {
+        while (program.blocks[target].code.size() == 1 && program.blocks[target].code[0].op == OpCode::JUMP) {
+            target = program.blocks[target].code[0].operand;
+        }
+        return target;
+    };
+    for (IrBlock& block : program.blocks) {
+        IrInstr& last = block.code.back();
+        if (last.op == OpCode::JUMP || last.op == OpCode::JUMP_IF_FALSE) last.operand = skipJumps(last.operand);
+        if (last.op == OpCode::JUMP_IF_FALSE) last.operand2 = skipJumps(last.operand2);
+    }
+
+    compactBlocks(program);
+    removeDeadValues(program);
+}
+
+void runIrPasses(IrProgram& program, const IrSettings& settings) {
+    if (settings.dump) {
+        *settings.dump << "== IR after building ==\n" << dumpIr(program);
+    }
+    struct Step {
+        IrPass pass;
+        void (*run)(IrProgram&);
+    };
+    static const Step steps[] = {
+        {IR_COPY_PROPAGATION, propagateCopies},
+        {IR_CSE, eliminateCommonSubexpressions},
+        {IR_DEAD_STORES, eliminateDeadStores},
+        {IR_JUMP_THREADING, threadJumps},
+    };
+    for (const Step& step : steps) {
+        if (!(settings.passes & step.pass)) continue;
+        step.run(program);
+        if (settings.dump) {
+            *settings.dump << "== IR after " << irPassName(step.pass) << " ==\n" << dumpIr(program);
+        }
+    }
+}
+
+
+// ================= LOWERING =================
+//
+// Each value ends up in one of these places:
+//
+//  - STACK: pushed where it is defined and popped by its only user, in
+//    the same block, which must find it on top of the stack
+//  - REMAT: a constant, or a LOAD_VAR of a slot nothing stores to in the
+//    meantime, emitted again at every use
+//  - HOME: stored to a slot where it is defined and loaded at every use;
+//    the slot of a variable it is stored to when that is safe, otherwise
+//    a temporary above the program's slots
+//
+// Positions count instructions across all blocks in order. Since jumps
+// only go forward, anything executed between two instructions lies
+// between their positions.
+
+namespace {
+enum class Place : uint8_t { UNUSED, STACK, REMAT, HOME };
+
+struct ValueInfo {
+    uint32_t defPos = 0;
+    uint32_t defBlock = 0;
+    OpCode op = OpCode::HALT;
+    uint32_t operand = 0;
+    uint32_t uses = 0;
+    uint32_t lastUse = 0;
+    uint32_t firstUserBlock = 0;
+    Place place = Place::UNUSED;
+    uint32_t home = 0;
+    uint32_t homeStore = kNoValue; // position of the STORE_VAR made redundant by an own-slot home
+};
+
+// The stores to one slot in position order. A store may move as early as
+// the definition of its value (see chooseVariableHome), so each also has
+// the earliest start of it and every later store.
+struct SlotStores {
+    std::vector<uint32_t> pos;
+    std::vector<uint32_t> earliest;
+};
+
+class Lowering {
+public:
+    explicit Lowering(const IrProgram& program) : program(program) {}
+
+    Chunk run() {
+        analyze();
+        chooseStackValues();
+        choosePlaces();
+        allocateTemps();
+        emitCode();
+        return std::move(chunk);
+    }
+
+private:
+    const IrProgram& program;
+    std::vector<ValueInfo> values;
+    std::unordered_map<uint32_t, SlotStores> stores;
+    std::vector<uint32_t> blockStart; // position of each block's first instruction
+    std::vector<const IrInstr*> at;   // instruction at each position
+    std::vector<bool> swapped;        // emitted as mirroredOp() with the operands reversed
+    uint32_t tempCount = 0;
+    Chunk chunk;
+
+    void analyze() {
+        values.assign(program.valueCount, ValueInfo{});
+        uint32_t pos = 0;
+        for (uint32_t b = 0; b < program.blocks.size(); b++) {
+            blockStart.push_back(pos);
+            for (const IrInstr& instr : program.blocks[b].code) {
+                at.push_back(&instr);
+                for (int i = 0; i < argCount(instr); i++) {
+                    ValueInfo& arg = values[instr.args[i]];
+                    if (arg.uses++ == 0) arg.firstUserBlock = b;
+                    arg.lastUse = pos;
+                }
+                if (instr.result != kNoValue) {
+                    ValueInfo& value = values[instr.result];
+                    value.defPos = pos;
+                    value.defBlock = b;
+                    value.op = instr.op;
+                    value.operand = instr.operand;
+                }
+                pos++;
+            }
+        }
+        for (uint32_t p = 0; p < at.size(); p++) {
+            const IrInstr& instr = *at[p];
+            if (instr.op != OpCode::STORE_VAR) continue;
+            const ValueInfo& value = values[instr.args[0]];
+            SlotStores& slot = stores[instr.operand];
+            slot.pos.push_back(p);
+            slot.earliest.push_back(blockOf(p) == value.defBlock ? value.defPos : p);
+        }
+        for (auto& entry : stores) {
+            std::vector<uint32_t>& earliest = entry.second.earliest;
+            for (size_t i = earliest.size() - 1; i-- > 0;) {
+                earliest[i] = std::min(earliest[i], earliest[i + 1]);
+            }
+        }
+        // Constants, and reads of a slot that stays the same until the use,
+        // cost the same emitted at the use, which keeps them out of the way.
+        for (ValueInfo& value : values) {
+            bool leaf = value.op == OpCode::LOAD_CONST ||
+                        (value.op == OpCode::LOAD_VAR && !storedBetween(value.operand, value.defPos, value.lastUse));
+            if (value.uses == 1 && value.firstUserBlock == value.defBlock && !leaf) value.place = Place::STACK;
+        }
+    }
+
+    uint32_t blockOf(uint32_t pos) const {
+        return static_cast<uint32_t>(std::upper_bound(blockStart.begin(), blockStart.end(), pos) - blockStart.begin() - 1);
+    }
+
+    // Whether a store to `slot` may happen after `from` and before the
+    // instruction at `to` reads its operands.
+    bool storedBetween(uint32_t slot, uint32_t from, uint32_t to) const {
+        auto found = stores.find(slot);
+        if (found == stores.end()) return false;
+        const SlotStores& list = found->second;
+        size_t after = std::upper_bound(list.pos.begin(), list.pos.end(), from) - list.pos.begin();
+        return after < list.pos.size() && list.earliest[after] < to;
+    }
+
+    // Simulates each block's stack. A value its user would not find on
+    // top is demoted, with whatever was pushed above it; nothing popped
+    // in between was below them, so the rest of the simulation stands.
+    void chooseStackValues() {
+        std::vector<uint32_t> stack;
+        swapped.assign(at.size(), false);
+        uint32_t pos = 0;
+        for (const IrBlock& block : program.blocks) {
+            stack.clear();
+            for (const IrInstr& instr : block.code) {
+                uint32_t here = pos++;
+                uint32_t args[2] = {instr.args[0], instr.args[1]};
+                OpCode mirror;
+                if (argCount(instr) == 2 && values[args[0]].place != Place::STACK &&
+                    values[args[1]].place == Place::STACK && mirroredOp(instr.op, mirror)) {
+                    // Only the right operand is on the stack: swap them.
+                    std::swap(args[0], args[1]);
+                    swapped[here] = true;
+                }
+
+                uint32_t wanted[2];
+                int count = 0;
+                bool ordered = true;
+                for (int i = 0; i < argCount(instr); i++) {
+                    if (values[args[i]].place == Place::STACK) {
+                        ordered = ordered && count == i;
+                        wanted[count++] = args[i];
+                    }
+                }
+                bool onTop = ordered && stack.size() >= static_cast<size_t>(count) &&
+                             std::equal(wanted, wanted + count, stack.end() - count);
+                if (!onTop) {
+                    size_t lowest = stack.size();
+                    for (int i = 0; i < count; i++) {
+                        auto found = std::find(stack.begin(), stack.end(), wanted[i]);
+                        lowest = std::min(lowest, static_cast<size_t>(found - stack.begin()));
+                    }
+                    for (size_t i = lowest; i < stack.size(); i++) values[stack[i]].place = Place::UNUSED;
+                    stack.resize(lowest);
+                    count = 0;
+                    swapped[here] = false;
+                }
+                stack.resize(stack.size() - count);
+                if (instr.result != kNoValue && values[instr.result].place == Place::STACK) {
+                    stack.push_back(instr.result);
+                }
+            }
+        }
+    }
+
+    void choosePlaces() {
+        for (uint32_t v = 0; v < values.size(); v++) {
+            ValueInfo& value = values[v];
+            if (value.place == Place::STACK || value.uses == 0) continue;
+            if (value.op == OpCode::LOAD_CONST) {
+                value.place = Place::REMAT;
+            } else if (value.op == OpCode::LOAD_VAR && !storedBetween(value.operand, value.defPos, value.lastUse)) {
+                value.place = Place::REMAT;
+            } else {
+                value.place = Place::HOME;
+                value.home = kNoValue;
+                chooseVariableHome(v);
+            }
+        }
+    }
+
+    // A value stored to a variable soon after it is computed can be
+    // stored there right away and read from that slot, when nothing reads
+    // the variable's old value or can fail in between and nothing else
+    // stores to it while the value is in use.
+    void chooseVariableHome(uint32_t v) {
+        ValueInfo& value = values[v];
+        uint32_t blockEnd = value.defBlock + 1 < blockStart.size() ? blockStart[value.defBlock + 1]
+                                                                  : static_cast<uint32_t>(at.size());
+        uint32_t storePos = value.defPos + 1;
+        while (storePos < blockEnd && !(at[storePos]->op == OpCode::STORE_VAR && at[storePos]->args[0] == v)) {
+            storePos++;
+        }
+        if (storePos == blockEnd) return;
+
+        uint32_t slot = at[storePos]->operand;
+        for (uint32_t p = value.defPos + 1; p < storePos; p++) {
+            const IrInstr& instr = *at[p];
+            bool touchesSlot = (instr.op == OpCode::LOAD_VAR || instr.op == OpCode::STORE_VAR) && instr.operand == slot;
+            if (touchesSlot || mayFail(instr.op)) return;
+        }
+        // Stores between the definition and this one were ruled out above.
+        if (storedBetween(slot, storePos, value.lastUse)) return;
+        value.home = slot;
+        value.homeStore = storePos;
+    }
+
+    // Temporaries are shared by values whose lifetimes do not overlap.
+    void allocateTemps() {
+        std::vector<uint32_t> order;
+        for (uint32_t v = 0; v < values.size(); v++) {
+            if (values[v].place == Place::HOME && values[v].home == kNoValue) order.push_back(v);
+        }
+        std::sort(order.begin(), order.end(),
+                  [&](uint32_t a, uint32_t b) { return values[a].defPos < values[b].defPos; });
+        // (last position in use, temporary), soonest free on top
+        using Busy = std::pair<uint32_t, uint32_t>;
+        std::priority_queue<Busy, std::vector<Busy>, std::greater<Busy>> busy;
+        for (uint32_t v : order) {
+            ValueInfo& value = values[v];
+            uint32_t temp = tempCount;
+            if (!busy.empty() && busy.top().first <= value.defPos) {
+                temp = busy.top().second;
+                busy.pop();
+            } else {
+                tempCount++;
+            }
+            busy.emplace(value.lastUse, temp);
+            value.home = program.slotCount + temp;
+        }
+        if (program.slotCount + tempCount > kMaxSlots) {
+            throw std::runtime_error("Too many variables in scope");
+        }
+    }
+
+    void emit(OpCode op, int line) {
+        chunk.lines.add(chunk.code.size(), line);
+        chunk.emit(op);
+    }
+
+    void emit(OpCode op, uint32_t operand, int line) {
+        chunk.lines.add(chunk.code.size(), line);
+        chunk.emit(op, operand);
+    }
+
+    void emitUse(uint32_t v, int line) {
+        const ValueInfo& value = values[v];
+        switch (value.place) {
+            case Place::REMAT: emit(value.op, value.operand, line); break;
+            case Place::HOME: emit(OpCode::LOAD_VAR, value.home, line); break;
+            default: break;
+        }
+    }
+
+    void emitCode() {
+        static_cast<ConstantPool&>(chunk) = program;
+        std::vector<size_t> blockOffset(program.blocks.size(), 0);
+        std::vector<std::pair<size_t, uint32_t>> fixups; // jump operand, target block
+
+        auto jump = [&](OpCode op, uint32_t target, int line) {
+            chunk.lines.add(chunk.code.size(), line);
+            fixups.emplace_back(chunk.emitJump(op), target);
+        };
+
+        uint32_t pos = 0;
+        for (uint32_t b = 0; b < program.blocks.size(); b++) {
+            blockOffset[b] = chunk.code.size();
+            for (const IrInstr& instr : program.blocks[b].code) {
+                uint32_t here = pos++;
+                if (instr.op == OpCode::STORE_VAR && values[instr.args[0]].homeStore == here) {
+                    continue; // stored where it was computed
+                }
+                if (swapped[here]) {
+                    emitUse(instr.args[1], instr.line);
+                    emitUse(instr.args[0], instr.line);
+                    OpCode mirror = instr.op;
+                    mirroredOp(instr.op, mirror);
+                    emit(mirror, instr.line);
+                    storeResult(instr);
+                    continue;
+                }
+                for (int i = 0; i < argCount(instr); i++) emitUse(instr.args[i], instr.line);
+
+                switch (instr.op) {
+                    case OpCode::STORE_VAR:
+                    case OpCode::LOAD_VAR:
+                        emitValue(instr);
+                        break;
+                    case OpCode::LOAD_CONST:
+                        if (values[instr.result].place == Place::STACK) emit(instr.op, instr.operand, instr.line);
+                        break;
+                    case OpCode::JUMP:
+                        if (instr.operand != b + 1) jump(OpCode::JUMP, instr.operand, instr.line);
+                        break;
+                    case OpCode::JUMP_IF_FALSE:
+                        jump(OpCode::JUMP_IF_FALSE, instr.operand, instr.line);
+                        if (instr.operand2 != b + 1) jump(OpCode::JUMP, instr.operand2, instr.line);
+                        break;
+                    case OpCode::PRINT:
+                    case OpCode::HALT:
+                        emit(instr.op, instr.line);
+                        break;
+                    default:
+                        emit(instr.op, instr.line);
+                        storeResult(instr);
+                        break;
+                }
+            }
+        }
+        for (const auto& [operand, target] : fixups) {
+            chunk.patchJump(operand, blockOffset[target]);
+        }
+        if (chunk.code.empty() || static_cast<OpCode>(chunk.code.back()) != OpCode::HALT) {
+            throw std::logic_error("IR lowering lost the final HALT");
+        }
+        chunk.slotCount = program.slotCount + tempCount;
+    }
+
+    void emitValue(const IrInstr& instr) {
+        if (instr.op == OpCode::STORE_VAR) {
+            emit(OpCode::STORE_VAR, instr.operand, instr.line);
+            return;
+        }
+        const ValueInfo& value = values[instr.result];
+        if (value.place == Place::STACK || value.place == Place::HOME) {
+            emit(OpCode::LOAD_VAR, instr.operand, instr.line);
+            storeResult(instr);
+        }
+    }
+
+    void storeResult(const IrInstr& instr) {
+        const ValueInfo& value = values[instr.result];
+        if (value.place == Place::HOME) {
+            emit(OpCode::STORE_VAR, value.home, instr.line);
+        } else if (value.place == Place::UNUSED) {
+            emit(OpCode::POP, instr.line);
+        }
+    }
+};
+}
+
+Chunk lowerIr(const IrProgram& program) {
+    return Lowering(program).run();
+}
@@ -0,0 +1,100 @@
+#ifndef IR_H
+#define IR_H
+
+#include "bytecode.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SSA middle-end used at -O2, between the AST and the stack bytecode.
+//
+// The Compiler builds an IrProgram from the AST instead of emitting code
+// directly. Every intermediate result is an SSA value, defined by exactly
+// one instruction. Variables stay in their slots and are read and written
+// with LOAD_VAR and STORE_VAR, because the REPL and heap images observe
+// the slots after a run. Blocks only ever jump forward, since the
+// language has `if` but no loops, so every pass is a single walk in block
+// order and no phis are needed.
+//
+// Instructions reuse the OpCode set: operators, LOAD_CONST, LOAD_VAR,
+// STORE_VAR, PRINT, JUMP, HALT, and JUMP_IF_FALSE as a two-way branch.
+// POP does not occur; a value nobody uses is simply unused.
+//
+// The passes, each optional (see IrPass):
+//
+//  - copy propagation: a LOAD_VAR of a slot whose value is known, from
+//    an earlier STORE_VAR or LOAD_VAR on every path, is replaced by that
+//    value, so `y = x` followed by uses of y reads x's value directly
+//  - common subexpression elimination: an operator or constant already
+//    computed in a dominating position is reused
+//  - dead store elimination: a STORE_VAR whose slot is overwritten or
+//    goes out of use before anything reads it is removed. Globals are
+//    read when the program ends, and also where an int division could
+//    fail, since the REPL keeps the globals of a failed line
+//  - jump threading: branches on constants or on a condition already
+//    tested on the way in become jumps, jumps to jumps are shortened, and
+//    unreachable and straight-line blocks are removed and merged
+//
+// After each pass, values that are no longer used and cannot fail are
+// removed. lowerIr() turns the result back into stack bytecode: values
+// are left on the stack for a single user that pops them in order, and
+// otherwise kept in a slot, preferably the variable they are stored to.
+constexpr uint32_t kNoValue = UINT32_MAX;
+
+struct IrInstr {
+    OpCode op;
+    uint32_t result;   // SSA value defined here, or kNoValue
+    uint32_t args[2];  // operand values, in stack order; kNoValue when unused
+    uint32_t operand;  // constant index, slot, or target block (JUMP; JUMP_IF_FALSE when false)
+    uint32_t operand2; // JUMP_IF_FALSE: target block when true
+    int line;
+};
+
+struct IrBlock {
+    std::vector<IrInstr> code; // ends with JUMP, JUMP_IF_FALSE or HALT
+};
+
+struct IrProgram : ConstantPool {
+    std::vector<IrBlock> blocks; // blocks[0] is the entry
+    uint32_t valueCount = 0;
+    uint32_t slotCount = 0;
+    std::vector<std::string> slotNames; // last variable declared in each slot, for dumps
+    std::vector<bool> liveOut;          // slots read after the program: the globals
+};
+
+enum IrPass : unsigned {
+    IR_COPY_PROPAGATION = 1u << 0,
+    IR_CSE = 1u << 1,
+    IR_DEAD_STORES = 1u << 2,
+    IR_JUMP_THREADING = 1u << 3
+};
+
+constexpr unsigned kAllIrPasses = IR_COPY_PROPAGATION | IR_CSE | IR_DEAD_STORES | IR_JUMP_THREADING;
+
+// How the Compiler uses the IR: not at all unless enabled, then with the
+// given passes, in the order of IrPass. With `dump` set the IR is
+// written there after building and after every pass.
+struct IrSettings {
+    bool enabled = false;
+    unsigned passes = kAllIrPasses;
+    std::ostream* dump = nullptr;
+};
+
+// Command-line name of a single pass: copy-prop, cse, dse, jump-threading.
+const char* irPassName(IrPass pass);
+// Parses a comma-separated list of pass names, or "all" or "none".
+bool parseIrPasses(std::string_view list, unsigned& passes);
+
+std::string dumpIr(const IrProgram& program);
+
+void propagateCopies(IrProgram& program);
+void eliminateCommonSubexpressions(IrProgram& program);
+void eliminateDeadStores(IrProgram& program);
+void threadJumps(IrProgram& program);
+void runIrPasses(IrProgram& program, const IrSettings& settings);
+
+Chunk lowerIr(const IrProgram& program);
+
+#endif
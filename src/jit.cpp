@@ -0,0 +1,574 @@
+#include "jit.h"
+#include "valueops.h"
+#include "vm.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+#ifdef MEOW_JIT_X64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// VM operations that JIT code calls instead of emitting them inline. Every
+// helper has the same shape: the result replaces *a and a nonzero return
+// means an exception was stored in the context, since none may unwind
+// through the native frames.
+struct JitRuntime {
+    template <OpCode op>
+    static int binary(JitContext* context, Value* a, const Value* b) noexcept {
+        try {
+            *a = evaluate<op>(*context->vm, *a, *b);
+            return 0;
+        } catch (...) {
+            context->error = std::current_exception();
+            return 1;
+        }
+    }
+
+    static int print(JitContext* context, Value* a, const Value*) noexcept {
+        try {
+            context->vm->print(*a);
+            return 0;
+        } catch (...) {
+            context->error = std::current_exception();
+            return 1;
+        }
+    }
+
+    // For operations that allocate and so may collect. The frame is
+    // VM::stack, but only the entries up to `b` are live; the rest may
+    // hold stale strings and big ints that must not be marked.
+    template <typename F>
+    static Value allocating(VM& vm, const Value& b, F operation) {
+        Value* top = vm.stackTop;
+        vm.stackTop = vm.stack.data() + (&b - vm.stack.data()) + 1;
+        Value result = operation();
+        vm.stackTop = top;
+        return result;
+    }
+
+    // The int operations only get here once an operand is big or the
+    // result does not fit; unary ones pass their operand as both.
+    template <OpCode op>
+    static Value evaluate(VM& vm, const Value& a, const Value& b) {
+        switch (op) {
+            case OpCode::ADD_I64: return allocating(vm, b, [&] { return vm.bigArithmetic(ArithOp::ADD, a, b); });
+            case OpCode::SUB_I64: return allocating(vm, b, [&] { return vm.bigArithmetic(ArithOp::SUB, a, b); });
+            case OpCode::MUL_I64: return allocating(vm, b, [&] { return vm.bigArithmetic(ArithOp::MUL, a, b); });
+            case OpCode::DIV_I64: return allocating(vm, b, [&] { return vm.bigArithmetic(ArithOp::DIV, a, b); });
+            case OpCode::MOD_I64: return allocating(vm, b, [&] { return vm.bigArithmetic(ArithOp::MOD, a, b); });
+            case OpCode::NEG_I64: return allocating(vm, b, [&] { return vm.bigNegate(a); });
+            case OpCode::I64_TO_F64: return Value::makeDeci(vm.bigToDeci(a));
+            case OpCode::EQ_I64: return Value::makeBool(vm.bigCompare(a, b) == 0);
+            case OpCode::NE_I64: return Value::makeBool(vm.bigCompare(a, b) != 0);
+            case OpCode::LESS_I64: return Value::makeBool(vm.bigCompare(a, b) < 0);
+            case OpCode::LESS_EQUAL_I64: return Value::makeBool(vm.bigCompare(a, b) <= 0);
+            case OpCode::GREATER_I64: return Value::makeBool(vm.bigCompare(a, b) > 0);
+            case OpCode::GREATER_EQUAL_I64: return Value::makeBool(vm.bigCompare(a, b) >= 0);
+            case OpCode::MOD_F64: return Value::makeDeci(moduloDeci(a.as.d, b.as.d));
+            case OpCode::ADD_STR: return allocating(vm, b, [&] { return vm.concat(a, b); });
+            case OpCode::EQ_STR: return Value::makeBool(vm.strings.equal(a, b));
+            case OpCode::NE_STR: return Value::makeBool(!vm.strings.equal(a, b));
+            case OpCode::LESS_STR: return Value::makeBool(vm.strings.compare(a, b) < 0);
+            case OpCode::LESS_EQUAL_STR: return Value::makeBool(vm.strings.compare(a, b) <= 0);
+            case OpCode::GREATER_STR: return Value::makeBool(vm.strings.compare(a, b) > 0);
+            case OpCode::GREATER_EQUAL_STR: return Value::makeBool(vm.strings.compare(a, b) >= 0);
+            case OpCode::EQUAL: return Value::makeBool(scalarsEqual(a, b));
+            case OpCode::NOT_EQUAL: return Value::makeBool(!scalarsEqual(a, b));
+            case OpCode::LESS: return Value::makeBool(compareScalars(a, b) < 0);
+            case OpCode::LESS_EQUAL: return Value::makeBool(compareScalars(a, b) <= 0);
+            case OpCode::GREATER: return Value::makeBool(compareScalars(a, b) > 0);
+            case OpCode::GREATER_EQUAL: return Value::makeBool(compareScalars(a, b) >= 0);
+            default: throw std::logic_error("No JIT helper for opcode");
+        }
+    }
+};
+
+namespace {
+#ifdef MEOW_JIT_X64
+
+using Helper = int (*)(JitContext*, Value*, const Value*);
+
+enum Reg : int {
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+    RSP = 4,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14
+};
+
+// Registers the generated code keeps for the whole run; all callee-saved.
+const int kVariables = RBX;
+const int kConstants = R12;
+const int kFrame = R13;
+const int kContext = R14;
+
+static_assert(sizeof(Value) == 16, "JIT code addresses Values as 16-byte slots");
+const int32_t kPayload = static_cast<int32_t>(offsetof(Value, as));
+
+// Condition codes, as in the low nibble of SETcc and Jcc.
+enum Condition : uint8_t {
+    CC_O = 0x0,
+    CC_E = 0x4,
+    CC_NE = 0x5,
+    CC_A = 0x7,
+    CC_AE = 0x3,
+    CC_P = 0xA,
+    CC_NP = 0xB,
+    CC_L = 0xC,
+    CC_GE = 0xD,
+    CC_LE = 0xE,
+    CC_G = 0xF
+};
+
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    void bytes(std::initializer_list<uint8_t> list) { code.insert(code.end(), list); }
+    void u16(uint16_t v) { raw(&v, sizeof(v)); }
+    void u32(uint32_t v) { raw(&v, sizeof(v)); }
+    void u64(uint64_t v) { raw(&v, sizeof(v)); }
+
+    // An instruction whose r/m operand is [base + disp32]. `reg` is the
+    // ModRM reg field: a register or an opcode extension.
+    void memory(std::initializer_list<uint8_t> prefixes, bool wide, std::initializer_list<uint8_t> opcode, int reg,
+                int base, int32_t disp) {
+        bytes(prefixes);
+        uint8_t rex = static_cast<uint8_t>(0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | (base >> 3));
+        if (rex != 0x40) code.push_back(rex);
+        bytes(opcode);
+        code.push_back(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == RSP) code.push_back(0x24); // SIB: no index
+        u32(static_cast<uint32_t>(disp));
+    }
+
+    // A jump with a 32-bit displacement; returns where to patch it.
+    size_t jump() {
+        code.push_back(0xE9);
+        u32(0);
+        return code.size() - 4;
+    }
+    size_t jumpIf(Condition cc) {
+        bytes({0x0F, static_cast<uint8_t>(0x80 | cc)});
+        u32(0);
+        return code.size() - 4;
+    }
+    void patch(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        std::memcpy(&code[at], &rel, sizeof(rel));
+    }
+
+    // Short forward jumps inside one instruction's sequence.
+    size_t shortJump(uint8_t opcode) {
+        bytes({opcode, 0});
+        return code.size() - 1;
+    }
+    void patchShort(size_t at) { code[at] = static_cast<uint8_t>(code.size() - (at + 1)); }
+
+    void setAl(Condition cc) { bytes({0x0F, static_cast<uint8_t>(0x90 | cc), 0xC0}); }
+
+private:
+    void raw(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        code.insert(code.end(), p, p + size);
+    }
+};
+
+// Translates a verified ChunkView in one forward pass. verify() fixed the
+// stack depth before each instruction; entry k of the stack lives at
+// [kFrame + 16k].
+class Translator {
+private:
+    const ChunkView& chunk;
+    const VerifiedCode& verified;
+    Assembler a;
+    std::vector<int64_t> nativeAt; // by code offset; -1 when not emitted
+    struct Fixup {
+        size_t at;
+        size_t target;
+    };
+    std::vector<Fixup> jumps;
+    std::vector<size_t> divisionByZero;
+    std::vector<size_t> helperError;
+    std::vector<size_t> exits;
+
+    static int32_t slot(uint32_t index) { return static_cast<int32_t>(index * sizeof(Value)); }
+
+    void loadPayload(int reg, uint32_t index) { a.memory({}, true, {0x8B}, reg, kFrame, slot(index) + kPayload); }
+    void loadDeci(int xmm, uint32_t index) { a.memory({0xF2}, false, {0x0F, 0x10}, xmm, kFrame, slot(index) + kPayload); }
+
+    // Type tag with inlineLength 0, as Value::make* leaves it.
+    void storeTag(uint32_t index, ValueType type) {
+        a.memory({0x66}, false, {0xC7}, 0, kFrame, slot(index));
+        a.u16(static_cast<uint16_t>(type));
+    }
+    void storeRax(uint32_t index, ValueType type) {
+        storeTag(index, type);
+        a.memory({}, true, {0x89}, RAX, kFrame, slot(index) + kPayload);
+    }
+    void storeXmm0(uint32_t index) {
+        storeTag(index, ValueType::DECI);
+        a.memory({0xF2}, false, {0x0F, 0x11}, 0, kFrame, slot(index) + kPayload);
+    }
+    void storeBoolFromAl(uint32_t index) {
+        a.bytes({0x0F, 0xB6, 0xC0}); // movzx eax, al
+        storeRax(index, ValueType::BOOL);
+    }
+
+    void copyValue(int fromBase, int32_t from, int toBase, int32_t to) {
+        a.memory({0xF3}, false, {0x0F, 0x6F}, 0, fromBase, from); // movdqu xmm0, [from]
+        a.memory({0xF3}, false, {0x0F, 0x7F}, 0, toBase, to);     // movdqu [to], xmm0
+    }
+
+    void callHelper(Helper helper, uint32_t left, uint32_t right) {
+        a.memory({}, true, {0x8D}, RSI, kFrame, slot(left));  // lea rsi, [left]
+        a.memory({}, true, {0x8D}, RDX, kFrame, slot(right)); // lea rdx, [right]
+        a.bytes({0x4C, 0x89, 0xF7});                          // mov rdi, r14
+        a.bytes({0x48, 0xB8});                                // mov rax, helper
+        a.u64(reinterpret_cast<uint64_t>(helper));
+        a.bytes({0xFF, 0xD0});                                // call rax
+        a.bytes({0x85, 0xC0});                                // test eax, eax
+        helperError.push_back(a.jumpIf(CC_NE));
+    }
+
+    // An int operation runs inline while its operands are 64-bit, which
+    // is a zero tag word (type INT, inlineLength 0), and its result fits.
+    // `inlined` emits that sequence and adds the jumps that leave it, on
+    // overflow, to `slow`; the slow path calls the VM's big int code.
+    template <typename F>
+    void intOperation(Helper helper, uint32_t left, uint32_t right, F inlined) {
+        std::vector<size_t> slow;
+        a.memory({}, false, {0x0F, 0xB7}, RAX, kFrame, slot(left)); // movzx eax, word [left]
+        if (right != left) {
+            a.memory({0x66}, false, {0x0B}, RAX, kFrame, slot(right)); // or ax, [right]
+        } else {
+            a.bytes({0x85, 0xC0}); // test eax, eax
+        }
+        slow.push_back(a.jumpIf(CC_NE));
+        inlined(slow);
+        size_t done = a.shortJump(0xEB);
+        for (size_t at : slow) a.patch(at, a.code.size());
+        callHelper(helper, left, right);
+        a.patchShort(done);
+    }
+
+    void integerArithmetic(Helper helper, std::initializer_list<uint8_t> opcode, uint32_t left) {
+        intOperation(helper, left, left + 1, [&](std::vector<size_t>& slow) {
+            loadPayload(RAX, left);
+            a.memory({}, true, opcode, RAX, kFrame, slot(left + 1) + kPayload);
+            slow.push_back(a.jumpIf(CC_O));
+            storeRax(left, ValueType::INT);
+        });
+    }
+
+    // Truncating, with divideInt/moduloInt's special case for -1, which
+    // idiv would trap on for INT64_MIN; -INT64_MIN goes the slow way.
+    void integerDivision(Helper helper, bool modulo, uint32_t left) {
+        intOperation(helper, left, left + 1, [&](std::vector<size_t>& slow) {
+            loadPayload(RAX, left);
+            loadPayload(RCX, left + 1);
+            a.bytes({0x48, 0x85, 0xC9}); // test rcx, rcx
+            divisionByZero.push_back(a.jumpIf(CC_E));
+            a.bytes({0x48, 0x83, 0xF9, 0xFF}); // cmp rcx, -1
+            size_t general = a.shortJump(0x75);
+            if (modulo) {
+                a.bytes({0x31, 0xC0}); // xor eax, eax
+            } else {
+                a.bytes({0x48, 0xF7, 0xD8}); // neg rax
+                slow.push_back(a.jumpIf(CC_O));
+            }
+            size_t done = a.shortJump(0xEB);
+            a.patchShort(general);
+            a.bytes({0x48, 0x99});       // cqo
+            a.bytes({0x48, 0xF7, 0xF9}); // idiv rcx
+            if (modulo) {
+                a.bytes({0x48, 0x89, 0xD0}); // mov rax, rdx
+            }
+            a.patchShort(done);
+            storeRax(left, ValueType::INT);
+        });
+    }
+
+    void deciArithmetic(uint8_t opcode, uint32_t left) {
+        loadDeci(0, left);
+        a.memory({0xF2}, false, {0x0F, opcode}, 0, kFrame, slot(left + 1) + kPayload);
+        storeXmm0(left);
+    }
+
+    void integerComparison(Helper helper, Condition cc, uint32_t left) {
+        intOperation(helper, left, left + 1, [&](std::vector<size_t>&) {
+            loadPayload(RAX, left);
+            a.memory({}, true, {0x3B}, RAX, kFrame, slot(left + 1) + kPayload); // cmp rax, [right]
+            a.setAl(cc);
+            storeBoolFromAl(left);
+        });
+    }
+
+    // ucomisd leaves every flag set for NaN, so only the conditions that
+    // are false on "unordered" are used; < and <= swap the operands.
+    void deciComparison(OpCode op, uint32_t left) {
+        loadDeci(0, left);
+        loadDeci(1, left + 1);
+        bool swapped = op == OpCode::LESS_F64 || op == OpCode::LESS_EQUAL_F64;
+        a.bytes({0x66, 0x0F, 0x2E, static_cast<uint8_t>(swapped ? 0xC8 : 0xC1)}); // ucomisd
+        switch (op) {
+            case OpCode::EQ_F64:
+                a.setAl(CC_E);
+                a.bytes({0x0F, 0x9B, 0xC1}); // setnp cl
+                a.bytes({0x20, 0xC8});       // and al, cl
+                break;
+            case OpCode::NE_F64:
+                a.setAl(CC_NE);
+                a.bytes({0x0F, 0x9A, 0xC1}); // setp cl
+                a.bytes({0x08, 0xC8});       // or al, cl
+                break;
+            case OpCode::LESS_F64:
+            case OpCode::GREATER_F64:
+                a.setAl(CC_A);
+                break;
+            default:
+                a.setAl(CC_AE);
+                break;
+        }
+        storeBoolFromAl(left);
+    }
+
+    void prologue() {
+        a.bytes({0x55, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57}); // push rbp, rbx, r12-r15
+        a.bytes({0x48, 0x83, 0xEC, 0x08});                                     // sub rsp, 8: align calls
+        a.bytes({0x48, 0x89, 0xFB});                                           // mov rbx, rdi
+        a.bytes({0x49, 0x89, 0xF4});                                           // mov r12, rsi
+        a.bytes({0x49, 0x89, 0xD5});                                           // mov r13, rdx
+        a.bytes({0x49, 0x89, 0xCE});                                           // mov r14, rcx
+    }
+
+    // Status stubs and the shared epilogue; eax holds the status.
+    void epilogue() {
+        size_t helperStub = a.code.size();
+        a.bytes({0xB8});
+        a.u32(static_cast<uint32_t>(JitCode::kHelperError));
+        size_t toExit = a.jump();
+        size_t divisionStub = a.code.size();
+        a.bytes({0xB8});
+        a.u32(static_cast<uint32_t>(JitCode::kDivisionByZero));
+        size_t exit = a.code.size();
+        a.bytes({0x48, 0x83, 0xC4, 0x08});                                     // add rsp, 8
+        a.bytes({0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0x5D}); // pop r15-r12, rbx, rbp
+        a.bytes({0xC3});                                                       // ret
+
+        a.patch(toExit, exit);
+        for (size_t at : exits) a.patch(at, exit);
+        for (size_t at : helperError) a.patch(at, helperStub);
+        for (size_t at : divisionByZero) a.patch(at, divisionStub);
+    }
+
+    bool translate(OpCode op, uint32_t operand, int32_t depth);
+
+public:
+    Translator(const ChunkView& c, const VerifiedCode& v) : chunk(c), verified(v), nativeAt(c.codeSize, -1) {}
+
+    bool run();
+    const std::vector<uint8_t>& code() const { return a.code; }
+};
+
+bool Translator::run() {
+    // Frame and constant displacements are 32-bit.
+    if (verified.maxDepth > INT32_MAX / sizeof(Value) / 2) return false;
+    prologue();
+    for (size_t offset = 0; offset < chunk.codeSize;) {
+        OpCode op = static_cast<OpCode>(chunk.code[offset]);
+        size_t length = 1 + operandWidth(op);
+        uint32_t operand = length == 5 ? readU32(chunk.code + offset + 1)
+                         : length == 3 ? readU16(chunk.code + offset + 1) : 0;
+        int32_t depth = verified.depthAt[offset];
+        if (depth >= 0) {
+            nativeAt[offset] = static_cast<int64_t>(a.code.size());
+            if (!translate(op, operand, depth)) return false;
+        }
+        offset += length;
+    }
+    // A reached jump reaches its target, so every target was emitted.
+    for (const Fixup& jump : jumps) {
+        a.patch(jump.at, static_cast<size_t>(nativeAt[jump.target]));
+    }
+    epilogue();
+    return true;
+}
+
+bool Translator::translate(OpCode op, uint32_t operand, int32_t depth) {
+    uint32_t top = static_cast<uint32_t>(depth) - 1;
+    uint32_t left = static_cast<uint32_t>(depth) - 2; // of a binary operator
+    switch (op) {
+        case OpCode::LOAD_CONST:
+            if (operand > INT32_MAX / sizeof(Value)) return false;
+            copyValue(kConstants, slot(operand), kFrame, slot(static_cast<uint32_t>(depth)));
+            break;
+        case OpCode::LOAD_VAR:
+            copyValue(kVariables, slot(operand), kFrame, slot(static_cast<uint32_t>(depth)));
+            break;
+        case OpCode::STORE_VAR:
+            copyValue(kFrame, slot(top), kVariables, slot(operand));
+            break;
+        case OpCode::POP:
+            break;
+
+        case OpCode::ADD_I64: integerArithmetic(JitRuntime::binary<OpCode::ADD_I64>, {0x03}, left); break;
+        case OpCode::SUB_I64: integerArithmetic(JitRuntime::binary<OpCode::SUB_I64>, {0x2B}, left); break;
+        case OpCode::MUL_I64: integerArithmetic(JitRuntime::binary<OpCode::MUL_I64>, {0x0F, 0xAF}, left); break;
+        case OpCode::DIV_I64: integerDivision(JitRuntime::binary<OpCode::DIV_I64>, false, left); break;
+        case OpCode::MOD_I64: integerDivision(JitRuntime::binary<OpCode::MOD_I64>, true, left); break;
+        case OpCode::NEG_I64:
+            intOperation(JitRuntime::binary<OpCode::NEG_I64>, top, top, [&](std::vector<size_t>& slow) {
+                loadPayload(RAX, top);
+                a.bytes({0x48, 0xF7, 0xD8}); // neg rax
+                slow.push_back(a.jumpIf(CC_O));
+                storeRax(top, ValueType::INT);
+            });
+            break;
+
+        case OpCode::ADD_F64: deciArithmetic(0x58, left); break;
+        case OpCode::SUB_F64: deciArithmetic(0x5C, left); break;
+        case OpCode::MUL_F64: deciArithmetic(0x59, left); break;
+        case OpCode::DIV_F64: deciArithmetic(0x5E, left); break;
+        case OpCode::NEG_F64:
+            loadPayload(RAX, top);
+            a.bytes({0x48, 0x0F, 0xBA, 0xF8, 0x3F}); // btc rax, 63
+            storeRax(top, ValueType::DECI);
+            break;
+
+        case OpCode::I64_TO_F64:
+            intOperation(JitRuntime::binary<OpCode::I64_TO_F64>, top, top, [&](std::vector<size_t>&) {
+                a.memory({0xF2}, true, {0x0F, 0x2A}, 0, kFrame, slot(top) + kPayload); // cvtsi2sd xmm0, [top]
+                storeXmm0(top);
+            });
+            break;
+        case OpCode::NOT:
+            a.memory({}, false, {0x80}, 7, kFrame, slot(top) + kPayload); // cmp byte [top], 0
+            a.bytes({0x00});
+            a.setAl(CC_E);
+            storeBoolFromAl(top);
+            break;
+
+        case OpCode::EQ_I64: integerComparison(JitRuntime::binary<OpCode::EQ_I64>, CC_E, left); break;
+        case OpCode::NE_I64: integerComparison(JitRuntime::binary<OpCode::NE_I64>, CC_NE, left); break;
+        case OpCode::LESS_I64: integerComparison(JitRuntime::binary<OpCode::LESS_I64>, CC_L, left); break;
+        case OpCode::LESS_EQUAL_I64:
+            integerComparison(JitRuntime::binary<OpCode::LESS_EQUAL_I64>, CC_LE, left);
+            break;
+        case OpCode::GREATER_I64: integerComparison(JitRuntime::binary<OpCode::GREATER_I64>, CC_G, left); break;
+        case OpCode::GREATER_EQUAL_I64:
+            integerComparison(JitRuntime::binary<OpCode::GREATER_EQUAL_I64>, CC_GE, left);
+            break;
+
+        case OpCode::EQ_F64:
+        case OpCode::NE_F64:
+        case OpCode::LESS_F64:
+        case OpCode::LESS_EQUAL_F64:
+        case OpCode::GREATER_F64:
+        case OpCode::GREATER_EQUAL_F64:
+            deciComparison(op, left);
+            break;
+
+        case OpCode::AND:
+        case OpCode::OR:
+            a.memory({}, false, {0x0F, 0xB6}, RAX, kFrame, slot(left) + kPayload); // movzx eax, byte [left]
+            a.memory({}, false, {static_cast<uint8_t>(op == OpCode::AND ? 0x22 : 0x0A)}, RAX, kFrame,
+                     slot(left + 1) + kPayload); // and/or al, [right]
+            storeBoolFromAl(left);
+            break;
+
+        case OpCode::MOD_F64: callHelper(JitRuntime::binary<OpCode::MOD_F64>, left, left + 1); break;
+        case OpCode::ADD_STR: callHelper(JitRuntime::binary<OpCode::ADD_STR>, left, left + 1); break;
+        case OpCode::EQ_STR: callHelper(JitRuntime::binary<OpCode::EQ_STR>, left, left + 1); break;
+        case OpCode::NE_STR: callHelper(JitRuntime::binary<OpCode::NE_STR>, left, left + 1); break;
+        case OpCode::LESS_STR: callHelper(JitRuntime::binary<OpCode::LESS_STR>, left, left + 1); break;
+        case OpCode::LESS_EQUAL_STR: callHelper(JitRuntime::binary<OpCode::LESS_EQUAL_STR>, left, left + 1); break;
+        case OpCode::GREATER_STR: callHelper(JitRuntime::binary<OpCode::GREATER_STR>, left, left + 1); break;
+        case OpCode::GREATER_EQUAL_STR:
+            callHelper(JitRuntime::binary<OpCode::GREATER_EQUAL_STR>, left, left + 1);
+            break;
+        case OpCode::EQUAL: callHelper(JitRuntime::binary<OpCode::EQUAL>, left, left + 1); break;
+        case OpCode::NOT_EQUAL: callHelper(JitRuntime::binary<OpCode::NOT_EQUAL>, left, left + 1); break;
+        case OpCode::LESS: callHelper(JitRuntime::binary<OpCode::LESS>, left, left + 1); break;
+        case OpCode::LESS_EQUAL: callHelper(JitRuntime::binary<OpCode::LESS_EQUAL>, left, left + 1); break;
+        case OpCode::GREATER: callHelper(JitRuntime::binary<OpCode::GREATER>, left, left + 1); break;
+        case OpCode::GREATER_EQUAL: callHelper(JitRuntime::binary<OpCode::GREATER_EQUAL>, left, left + 1); break;
+
+        case OpCode::PRINT:
+            callHelper(JitRuntime::print, top, top);
+            break;
+
+        case OpCode::JUMP:
+            jumps.push_back(Fixup{a.jump(), operand});
+            break;
+        case OpCode::JUMP_IF_FALSE:
+            a.memory({}, false, {0x80}, 7, kFrame, slot(top) + kPayload); // cmp byte [top], 0
+            a.bytes({0x00});
+            jumps.push_back(Fixup{a.jumpIf(CC_E), operand});
+            break;
+        case OpCode::HALT:
+            a.bytes({0x31, 0xC0}); // xor eax, eax
+            exits.push_back(a.jump());
+            break;
+    }
+    return true;
+}
+
+#endif // MEOW_JIT_X64
+}
+
+JitCode::JitCode(void* m, size_t size, uint32_t d)
+    : memory(m), mappedSize(size), entry(reinterpret_cast<Entry>(reinterpret_cast<uintptr_t>(m))), depth(d) {}
+
+JitCode::~JitCode() {
+#ifdef MEOW_JIT_X64
+    munmap(memory, mappedSize);
+#endif
+}
+
+bool JitCode::available() {
+#ifdef MEOW_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<JitCode> JitCode::compile(const ChunkView& chunk, const VerifiedCode& verified) {
+#ifdef MEOW_JIT_X64
+    Translator translator(chunk, verified);
+    if (!translator.run()) {
+        return nullptr;
+    }
+
+    // Written while writable, then flipped to executable: never both.
+    const std::vector<uint8_t>& code = translator.code();
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (code.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return nullptr;
+    }
+    return std::unique_ptr<JitCode>(new JitCode(memory, size, verified.maxDepth));
+#else
+    (void)chunk;
+    (void)verified;
+    return nullptr;
+#endif
+}
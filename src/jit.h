@@ -0,0 +1,73 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "bytecode.h"
+#include "value.h"
+#include "verifier.h"
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+
+class VM;
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && !defined(_WIN32)
+#define MEOW_JIT_X64 1
+#endif
+
+// What JIT code hands to the helpers it calls, and how a helper reports
+// an exception back through native frames that cannot unwind.
+struct JitContext {
+    VM* vm;
+    std::exception_ptr error;
+};
+
+// Baseline JIT behind `meow --jit`: translates a stack-machine program
+// into x86-64 code for the System V ABI, one native sequence per
+// instruction with no dispatch in between.
+//
+// Stack depth at every instruction is fixed by the program, so stack
+// entries become fixed slots in a frame of `stackDepth()` Values and
+// nothing tracks a stack pointer at runtime. Typed int and deci
+// operations, conversions, the bool operators and jumps are emitted
+// inline; PRINT, string operations, untyped comparisons and MOD_F64 call
+// helpers in jit.cpp, as do int operations on big ints or whose result
+// does not fit in 64 bits. A runtime error leaves the native code as a
+// status and is rethrown by the VM.
+//
+// compile() takes code that passed verify() and emits only the
+// instructions it reached. It returns null on other hosts and for frames
+// too large for 32-bit displacements; the VM then interprets the program.
+class JitCode {
+private:
+    using Entry = int (*)(Value* variables, const Value* constants, Value* stack, JitContext* context);
+
+    void* memory;
+    size_t mappedSize;
+    Entry entry;
+    uint32_t depth;
+
+    JitCode(void* memory, size_t mappedSize, uint32_t depth);
+
+public:
+    // Status codes of run().
+    static constexpr int kOk = 0;
+    static constexpr int kDivisionByZero = 1;
+    static constexpr int kHelperError = 2; // JitContext::error is set
+
+    static bool available();
+    static std::unique_ptr<JitCode> compile(const ChunkView& chunk, const VerifiedCode& verified);
+
+    ~JitCode();
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+
+    // Stack entries the code needs room for.
+    uint32_t stackDepth() const { return depth; }
+
+    int run(Value* variables, const Value* constants, Value* stack, JitContext* context) const {
+        return entry(variables, constants, stack, context);
+    }
+};
+
+#endif
@@ -1,244 +1,248 @@
 #include "lexer.h"
-#include <cctype>
-#include <unordered_map>
+#include "lexscan.h"
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+struct Keyword {
+    std::string_view text; // empty for an unused slot
+    TokenType type;
+};
+
+constexpr Keyword kKeywords[] = {
+    {"meow", TokenType::MEOW},
+    {"int", TokenType::INT},
+    {"deci", TokenType::DECI},
+    {"bool", TokenType::BOOL},
+    {"char", TokenType::CHAR},
+    {"string", TokenType::STRING},
+    {"true", TokenType::TRUE},
+    {"false", TokenType::FALSE},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE}
+};
+
+// Perfect hash of the keywords above: every keyword gets its own slot, so
+// a lookup is one hash and one comparison.
+constexpr size_t kKeywordSlots = 16;
+
+constexpr size_t keywordSlot(std::string_view word) {
+    unsigned first = static_cast<unsigned char>(word.front());
+    unsigned last = static_cast<unsigned char>(word.back());
+    return ((first + last) * 7 + word.size()) & (kKeywordSlots - 1);
+}
+
+constexpr bool keywordHashIsPerfect() {
+    bool used[kKeywordSlots] = {};
+    for (const Keyword& keyword : kKeywords) {
+        if (used[keywordSlot(keyword.text)]) return false;
+        used[keywordSlot(keyword.text)] = true;
+    }
+    return true;
+}
+static_assert(keywordHashIsPerfect(), "keywords collide; change keywordSlot()");
+
+constexpr std::array<Keyword, kKeywordSlots> makeKeywordTable() {
+    std::array<Keyword, kKeywordSlots> table{};
+    for (const Keyword& keyword : kKeywords) {
+        table[keywordSlot(keyword.text)] = keyword;
+    }
+    return table;
+}
+
+constexpr std::array<Keyword, kKeywordSlots> kKeywordTable = makeKeywordTable();
 
-Lexer::Lexer(const std::string& src)
-    : source(src), pos(0), line(1) {}
+TokenType keywordOrIdentifier(std::string_view word) {
+    const Keyword& keyword = kKeywordTable[keywordSlot(word)];
+    return keyword.text == word ? keyword.type : TokenType::IDENTIFIER;
+}
+}
+
+Lexer::Lexer(std::string_view src)
+    : source(src), pos(0), line(1) {
+    if (source.size() > UINT32_MAX) {
+        throw std::runtime_error("Source text too large");
+    }
+}
 
 char Lexer::peek() const {
-    if (pos >= source.length()) return '\0';
+    if (pos >= source.size()) return '\0';
     return source[pos];
 }
 
 char Lexer::advance() {
-    if (pos >= source.length()) return '\0';
+    if (pos >= source.size()) return '\0';
     return source[pos++];
 }
 
 void Lexer::skipWhitespace() {
-    while (std::isspace(static_cast<unsigned char>(peek()))) {
-        if (peek() == '\n') line++;
-        advance();
-    }
+    pos = skipSpaces(source.data() + pos, source.data() + source.size(), line) - source.data();
 }
 
-Token Lexer::identifier() {
-    std::string value;
-    while (std::isalnum(static_cast<unsigned char>(peek())) || peek() == '_') {
-        value += advance();
-    }
-
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"meow", TokenType::MEOW},
-        {"int", TokenType::INT},
-        {"deci", TokenType::DECI},
-        {"bool", TokenType::BOOL},
-        {"char", TokenType::CHAR},
-        {"string", TokenType::STRING},
-        {"true", TokenType::TRUE},
-        {"false", TokenType::FALSE},
-        {"if", TokenType::IF},
-        {"else", TokenType::ELSE}
-    };
-
-    auto it = keywords.find(value);
-    if (it != keywords.end()) {
-        return Token(it->second, value, line);
-    }
+Token Lexer::makeToken(TokenType type, size_t start) const {
+    return Token{type, static_cast<uint32_t>(start), static_cast<uint32_t>(pos - start), line};
+}
 
-    return Token(TokenType::IDENTIFIER, value, line);
+Token Lexer::identifier() {
+    size_t start = pos;
+    pos = skipIdentifier(source.data() + pos + 1, source.data() + source.size()) - source.data();
+    return makeToken(keywordOrIdentifier(source.substr(start, pos - start)), start);
 }
 
 Token Lexer::number() {
-    std::string value;
-    bool isDecimal = false;
-
-    while (std::isdigit(static_cast<unsigned char>(peek())) || peek() == '.') {
-        if (peek() == '.') {
-            if (isDecimal) break;
-            isDecimal = true;
-        }
-        value += advance();
+    size_t start = pos;
+    const char* end = source.data() + source.size();
+    pos = skipDigits(source.data() + pos, end) - source.data();
+
+    bool isDecimal = peek() == '.';
+    if (isDecimal) {
+        pos = skipDigits(source.data() + pos + 1, end) - source.data();
     }
 
     if (isDecimal) {
-        return Token(TokenType::DECIMAL_LITERAL, value, line);
+        return makeToken(TokenType::DECIMAL_LITERAL, start);
     }
 
-    return Token(TokenType::INTEGER_LITERAL, value, line);
+    return makeToken(TokenType::INTEGER_LITERAL, start);
 }
 
 Token Lexer::stringLiteral() {
-    std::string value;
     advance(); // skip opening quote
+    size_t start = pos;
 
-    while (peek() != '"' && peek() != '\0') {
-        if (peek() == '\n') line++;
-        value += advance();
-    }
+    pos = skipStringBody(source.data() + pos, source.data() + source.size(), line) - source.data();
 
+    Token token = makeToken(TokenType::STRING_LITERAL, start);
     if (peek() == '"') {
         advance(); // closing quote
     }
 
-    return Token(TokenType::STRING_LITERAL, value, line);
+    return token;
 }
 
 Token Lexer::charLiteral() {
-    std::string value;
     advance(); // skip opening quote
+    size_t start = pos;
 
     if (peek() != '\0' && peek() != '\n') {
-        value += advance();
+        advance();
     }
 
+    Token token = makeToken(TokenType::CHAR_LITERAL, start);
     if (peek() == '\'') {
         advance(); // closing quote
     }
 
-    return Token(TokenType::CHAR_LITERAL, value, line);
+    return token;
+}
+
+Token Lexer::next() {
+    skipWhitespace();
+    char c = peek();
+
+    if (c == '\0') {
+        return makeToken(TokenType::END_OF_FILE, pos);
+    }
+
+    if (hasClass(c, CHAR_IDENT_START)) {
+        return identifier();
+    }
+    if (hasClass(c, CHAR_DIGIT)) {
+        return number();
+    }
+
+    size_t start = pos;
+    switch (c) {
+        case '"':
+            return stringLiteral();
+        case '\'':
+            return charLiteral();
+        default:
+            break;
+    }
+
+    advance();
+    TokenType type = TokenType::UNKNOWN;
+    switch (c) {
+        case '+': type = TokenType::PLUS; break;
+        case '-': type = TokenType::MINUS; break;
+        case '*': type = TokenType::STAR; break;
+        case '/': type = TokenType::SLASH; break;
+        case '%': type = TokenType::MOD; break;
+
+        case '=':
+            type = peek() == '=' ? TokenType::EQUAL_EQUAL : TokenType::ASSIGN;
+            break;
+        case '!':
+            type = peek() == '=' ? TokenType::NOT_EQUAL : TokenType::NOT;
+            break;
+        case '<':
+            type = peek() == '<' ? TokenType::SHIFT_LEFT
+                 : peek() == '=' ? TokenType::LESS_EQUAL
+                 : TokenType::LESS;
+            break;
+        case '>':
+            type = peek() == '=' ? TokenType::GREATER_EQUAL : TokenType::GREATER;
+            break;
+        case '&':
+            type = peek() == '&' ? TokenType::AND : TokenType::UNKNOWN;
+            break;
+        case '|':
+            type = peek() == '|' ? TokenType::OR : TokenType::UNKNOWN;
+            break;
+
+        case '(': type = TokenType::LPAREN; break;
+        case ')': type = TokenType::RPAREN; break;
+        case '{': type = TokenType::LBRACE; break;
+        case '}': type = TokenType::RBRACE; break;
+        case ';': type = TokenType::SEMICOLON; break;
+
+        default: break;
+    }
+
+    // The second character of a two-character operator.
+    switch (type) {
+        case TokenType::EQUAL_EQUAL:
+        case TokenType::NOT_EQUAL:
+        case TokenType::SHIFT_LEFT:
+        case TokenType::LESS_EQUAL:
+        case TokenType::GREATER_EQUAL:
+        case TokenType::AND:
+        case TokenType::OR:
+            advance();
+            break;
+        default:
+            break;
+    }
+
+    return makeToken(type, start);
 }
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
+    return tokens;
+}
 
-    while (pos < source.length()) {
-        skipWhitespace();
-        char c = peek();
-
-        if (c == '\0') break;
-
-        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
-            tokens.push_back(identifier());
-        } else if (std::isdigit(static_cast<unsigned char>(c))) {
-            tokens.push_back(number());
-        } else {
-            switch (c) {
-                case '+':
-                    tokens.emplace_back(TokenType::PLUS, "+", line);
-                    advance();
-                    break;
-                case '-':
-                    tokens.emplace_back(TokenType::MINUS, "-", line);
-                    advance();
-                    break;
-                case '*':
-                    tokens.emplace_back(TokenType::STAR, "*", line);
-                    advance();
-                    break;
-                case '/':
-                    tokens.emplace_back(TokenType::SLASH, "/", line);
-                    advance();
-                    break;
-                case '%':
-                    tokens.emplace_back(TokenType::MOD, "%", line);
-                    advance();
-                    break;
-
-                case '=':
-                    advance();
-                    if (peek() == '=') {
-                        advance();
-                        tokens.emplace_back(TokenType::EQUAL_EQUAL, "==", line);
-                    } else {
-                        tokens.emplace_back(TokenType::ASSIGN, "=", line);
-                    }
-                    break;
-
-                case '!':
-                    advance();
-                    if (peek() == '=') {
-                        advance();
-                        tokens.emplace_back(TokenType::NOT_EQUAL, "!=", line);
-                    } else {
-                        tokens.emplace_back(TokenType::NOT, "!", line);
-                    }
-                    break;
-
-                case '<':
-                    advance();
-                    if (peek() == '<') {
-                        advance();
-                        tokens.emplace_back(TokenType::SHIFT_LEFT, "<<", line);
-                    } else if (peek() == '=') {
-                        advance();
-                        tokens.emplace_back(TokenType::LESS_EQUAL, "<=", line);
-                    } else {
-                        tokens.emplace_back(TokenType::LESS, "<", line);
-                    }
-                    break;
-
-                case '>':
-                    advance();
-                    if (peek() == '=') {
-                        advance();
-                        tokens.emplace_back(TokenType::GREATER_EQUAL, ">=", line);
-                    } else {
-                        tokens.emplace_back(TokenType::GREATER, ">", line);
-                    }
-                    break;
-
-                case '&':
-                    advance();
-                    if (peek() == '&') {
-                        advance();
-                        tokens.emplace_back(TokenType::AND, "&&", line);
-                    } else {
-                        tokens.emplace_back(TokenType::UNKNOWN, "&", line);
-                    }
-                    break;
-
-                case '|':
-                    advance();
-                    if (peek() == '|') {
-                        advance();
-                        tokens.emplace_back(TokenType::OR, "||", line);
-                    } else {
-                        tokens.emplace_back(TokenType::UNKNOWN, "|", line);
-                    }
-                    break;
-
-                case '(':
-                    tokens.emplace_back(TokenType::LPAREN, "(", line);
-                    advance();
-                    break;
-
-                case ')':
-                    tokens.emplace_back(TokenType::RPAREN, ")", line);
-                    advance();
-                    break;
-
-                case '{':
-                    tokens.emplace_back(TokenType::LBRACE, "{", line);
-                    advance();
-                    break;
-
-                case '}':
-                    tokens.emplace_back(TokenType::RBRACE, "}", line);
-                    advance();
-                    break;
-
-                case ';':
-                    tokens.emplace_back(TokenType::SEMICOLON, ";", line);
-                    advance();
-                    break;
-
-                case '"':
-                    tokens.push_back(stringLiteral());
-                    break;
-
-                case '\'':
-                    tokens.push_back(charLiteral());
-                    break;
-
-                default:
-                    tokens.emplace_back(TokenType::UNKNOWN, std::string(1, c), line);
-                    advance();
-                    break;
-            }
-        }
+
+// ================= TOKEN STREAM =================
+
+TokenStream::TokenStream(Lexer& l)
+    : lexer(l), ring(), current(0), lexed(0) {}
+
+const Token& TokenStream::fill(size_t ahead) {
+    while (lexed <= current + ahead) {
+        ring[lexed % kCapacity] = lexer.next();
+        lexed++;
     }
+    return ring[(current + ahead) % kCapacity];
+}
 
-    tokens.emplace_back(TokenType::END_OF_FILE, "EOF", line);
-    return tokens;
+const Token& TokenStream::advance() {
+    peek();
+    current++;
+    return previous();
 }
@@ -2,26 +2,71 @@
 #define LEXER_H
 
 #include "token.h"
-#include <string>
+#include <cstddef>
+#include <string_view>
 #include <vector>
 
+// Splits a source text into tokens without copying it: tokens refer back
+// to `source` by offset, so it must outlive them.
 class Lexer {
 private:
-    std::string source;
+    std::string_view source;
     size_t pos;
     int line;
 
     char peek() const;
     char advance();
     void skipWhitespace();
+    Token makeToken(TokenType type, size_t start) const;
     Token identifier();
     Token number();
     Token stringLiteral();
     Token charLiteral();
 
 public:
-    explicit Lexer(const std::string& src);
+    explicit Lexer(std::string_view src);
+
+    // The next token; END_OF_FILE once the source is exhausted, and again
+    // on every later call.
+    Token next();
+
+    // The whole source as a vector ending in END_OF_FILE.
     std::vector<Token> tokenize();
+
+    std::string_view text() const { return source; }
+};
+
+// Pulls tokens from a Lexer as the parser consumes them, so lexing and
+// parsing run interleaved and token memory stays constant. A small ring
+// keeps the last consumed token and up to kLookahead unconsumed ones.
+class TokenStream {
+private:
+    static constexpr size_t kCapacity = 4; // power of two
+
+public:
+    static constexpr size_t kLookahead = kCapacity - 1;
+
+private:
+
+    Lexer& lexer;
+    Token ring[kCapacity];
+    size_t current; // index of the next unconsumed token
+    size_t lexed;   // number of tokens taken from the lexer so far
+
+    const Token& fill(size_t ahead);
+
+public:
+    explicit TokenStream(Lexer& lexer);
+
+    // References stay valid only until the stream next moves; `ahead`
+    // must be less than kLookahead.
+    const Token& peek(size_t ahead = 0) {
+        // The parser peeks at the same token many times before consuming it.
+        if (current + ahead < lexed) return ring[(current + ahead) % kCapacity];
+        return fill(ahead);
+    }
+    const Token& previous() const { return ring[(current - 1) % kCapacity]; }
+    const Token& advance();
 };
 
 #endif
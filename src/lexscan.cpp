@@ -0,0 +1,291 @@
+#include "lexscan.h"
+
+#if defined(MEOW_SIMD_LEXER) && (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define MEOW_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+struct Scanners {
+    const char* (*spaces)(const char*, const char*, int&);
+    const char* (*identifier)(const char*, const char*);
+    const char* (*digits)(const char*, const char*);
+    const char* (*stringBody)(const char*, const char*, int&);
+};
+
+
+// ================= SCALAR =================
+
+const char* scalarSpaces(const char* p, const char* end, int& lines) {
+    while (p < end && hasClass(*p, CHAR_SPACE)) {
+        if (*p == '\n') lines++;
+        p++;
+    }
+    return p;
+}
+
+const char* scalarRun(const char* p, const char* end, uint8_t classes) {
+    while (p < end && hasClass(*p, classes)) p++;
+    return p;
+}
+
+const char* scalarIdentifier(const char* p, const char* end) {
+    return scalarRun(p, end, CHAR_IDENT);
+}
+
+const char* scalarDigits(const char* p, const char* end) {
+    return scalarRun(p, end, CHAR_DIGIT);
+}
+
+const char* scalarStringBody(const char* p, const char* end, int& lines) {
+    while (p < end && *p != '"' && *p != '\0') {
+        if (*p == '\n') lines++;
+        p++;
+    }
+    return p;
+}
+
+const Scanners kScalar = {scalarSpaces, scalarIdentifier, scalarDigits, scalarStringBody};
+
+
+#ifdef MEOW_SCAN_X86
+
+// ================= SSE2 =================
+//
+// Each step builds a bit mask with one bit per byte that belongs to the
+// run; the first clear bit ends it. Byte ranges are tested as unsigned
+// (x - lo) <= (hi - lo) through min_epu8.
+
+inline __m128i inRange16(__m128i x, char lo, char hi) {
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(static_cast<char>(hi - lo))), t);
+}
+
+inline unsigned spaceMask16(__m128i x) {
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), inRange16(x, '\t', '\r'));
+    return static_cast<unsigned>(_mm_movemask_epi8(space));
+}
+
+inline unsigned identMask16(__m128i x) {
+    __m128i letter = inRange16(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i ident = _mm_or_si128(_mm_or_si128(letter, inRange16(x, '0', '9')),
+                                 _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+    return static_cast<unsigned>(_mm_movemask_epi8(ident));
+}
+
+inline unsigned newlineMask16(__m128i x) {
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))));
+}
+
+// Bits below the first clear bit of `run`, and their count. `run` must
+// have a clear bit.
+inline unsigned prefixBits(unsigned run, unsigned& length) {
+    unsigned stop = ~run;
+    length = static_cast<unsigned>(__builtin_ctz(stop));
+    return (1u << length) - 1;
+}
+
+const char* sse2Spaces(const char* p, const char* end, int& lines) {
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned run = spaceMask16(x);
+        unsigned newlines = newlineMask16(x);
+        if (run != 0xFFFF) {
+            unsigned length;
+            lines += __builtin_popcount(newlines & prefixBits(run, length));
+            return p + length;
+        }
+        lines += __builtin_popcount(newlines);
+        p += 16;
+    }
+    return scalarSpaces(p, end, lines);
+}
+
+const char* sse2Identifier(const char* p, const char* end) {
+    while (end - p >= 16) {
+        unsigned run = identMask16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        if (run != 0xFFFF) {
+            return p + __builtin_ctz(~run);
+        }
+        p += 16;
+    }
+    return scalarIdentifier(p, end);
+}
+
+const char* sse2Digits(const char* p, const char* end) {
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned run = static_cast<unsigned>(_mm_movemask_epi8(inRange16(x, '0', '9')));
+        if (run != 0xFFFF) {
+            return p + __builtin_ctz(~run);
+        }
+        p += 16;
+    }
+    return scalarDigits(p, end);
+}
+
+const char* sse2StringBody(const char* p, const char* end, int& lines) {
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_setzero_si128()));
+        unsigned run = ~static_cast<unsigned>(_mm_movemask_epi8(stop)) & 0xFFFF;
+        unsigned newlines = newlineMask16(x);
+        if (run != 0xFFFF) {
+            unsigned length;
+            lines += __builtin_popcount(newlines & prefixBits(run, length));
+            return p + length;
+        }
+        lines += __builtin_popcount(newlines);
+        p += 16;
+    }
+    return scalarStringBody(p, end, lines);
+}
+
+const Scanners kSse2 = {sse2Spaces, sse2Identifier, sse2Digits, sse2StringBody};
+
+
+// ================= AVX2 =================
+//
+// The same masks 32 bytes at a time. Only called after the CPU has been
+// checked, so the target attribute is all these need.
+
+#define MEOW_AVX2 __attribute__((target("avx2")))
+
+MEOW_AVX2 inline __m256i inRange32(__m256i x, char lo, char hi) {
+    __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(static_cast<char>(hi - lo))), t);
+}
+
+MEOW_AVX2 inline unsigned newlineMask32(__m256i x) {
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'))));
+}
+
+MEOW_AVX2 const char* avx2Spaces(const char* p, const char* end, int& lines) {
+    while (end - p >= 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), inRange32(x, '\t', '\r'));
+        unsigned run = static_cast<unsigned>(_mm256_movemask_epi8(space));
+        unsigned newlines = newlineMask32(x);
+        if (run != ~0u) {
+            unsigned length;
+            lines += __builtin_popcount(newlines & prefixBits(run, length));
+            return p + length;
+        }
+        lines += __builtin_popcount(newlines);
+        p += 32;
+    }
+    return sse2Spaces(p, end, lines);
+}
+
+MEOW_AVX2 const char* avx2Identifier(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i letter = inRange32(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+        __m256i ident = _mm256_or_si256(_mm256_or_si256(letter, inRange32(x, '0', '9')),
+                                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+        unsigned run = static_cast<unsigned>(_mm256_movemask_epi8(ident));
+        if (run != ~0u) {
+            return p + __builtin_ctz(~run);
+        }
+        p += 32;
+    }
+    return sse2Identifier(p, end);
+}
+
+MEOW_AVX2 const char* avx2Digits(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned run = static_cast<unsigned>(_mm256_movemask_epi8(inRange32(x, '0', '9')));
+        if (run != ~0u) {
+            return p + __builtin_ctz(~run);
+        }
+        p += 32;
+    }
+    return sse2Digits(p, end);
+}
+
+MEOW_AVX2 const char* avx2StringBody(const char* p, const char* end, int& lines) {
+    while (end - p >= 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+                                       _mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+        unsigned run = ~static_cast<unsigned>(_mm256_movemask_epi8(stop));
+        unsigned newlines = newlineMask32(x);
+        if (run != ~0u) {
+            unsigned length;
+            lines += __builtin_popcount(newlines & prefixBits(run, length));
+            return p + length;
+        }
+        lines += __builtin_popcount(newlines);
+        p += 32;
+    }
+    return sse2StringBody(p, end, lines);
+}
+
+#undef MEOW_AVX2
+
+const Scanners kAvx2 = {avx2Spaces, avx2Identifier, avx2Digits, avx2StringBody};
+
+#endif // MEOW_SCAN_X86
+
+
+const Scanners& scannersFor(ScanLevel level) {
+    switch (level) {
+#ifdef MEOW_SCAN_X86
+        case ScanLevel::AVX2: return kAvx2;
+        case ScanLevel::SSE2: return kSse2;
+#endif
+        default: return kScalar;
+    }
+}
+
+ScanLevel activeLevel = detectScanLevel();
+const Scanners* active = &scannersFor(activeLevel);
+}
+
+const char* scanLevelName(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::SCALAR: return "scalar";
+        case ScanLevel::SSE2: return "sse2";
+        case ScanLevel::AVX2: return "avx2";
+    }
+    return "?";
+}
+
+ScanLevel detectScanLevel() {
+#ifdef MEOW_SCAN_X86
+    // Also runs from a static initializer, before the CPU model is set up.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? ScanLevel::AVX2 : ScanLevel::SSE2;
+#else
+    return ScanLevel::SCALAR;
+#endif
+}
+
+void setScanLevel(ScanLevel level) {
+    if (level > detectScanLevel()) {
+        level = detectScanLevel();
+    }
+    activeLevel = level;
+    active = &scannersFor(level);
+}
+
+ScanLevel scanLevel() {
+    return activeLevel;
+}
+
+const char* scanSpaces(const char* p, const char* end, int& lines) {
+    return active->spaces(p, end, lines);
+}
+
+const char* scanIdentifier(const char* p, const char* end) {
+    return active->identifier(p, end);
+}
+
+const char* scanDigits(const char* p, const char* end) {
+    return active->digits(p, end);
+}
+
+const char* scanStringBody(const char* p, const char* end, int& lines) {
+    return active->stringBody(p, end, lines);
+}
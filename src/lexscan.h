@@ -0,0 +1,96 @@
+#ifndef LEXSCAN_H
+#define LEXSCAN_H
+
+#include <array>
+#include <cstdint>
+
+// Character classes and the run scanners behind the Lexer's hot loops.
+//
+// Each scanner takes the half-open range [p, end) and returns the first
+// byte that does not belong to the run. Most runs between and inside
+// tokens are a few bytes long, so the first kShortRun bytes are checked
+// inline against the class table. Longer runs go to scan*(), which with
+// MEOW_SIMD_LEXER look at 16 (SSE2) or 32 (AVX2) bytes per step; the widest
+// level the CPU supports is picked at startup.
+
+enum CharClass : uint8_t {
+    CHAR_SPACE = 1 << 0,       // what std::isspace accepts in the C locale
+    CHAR_IDENT_START = 1 << 1, // letters and '_'
+    CHAR_IDENT = 1 << 2,       // letters, digits and '_'
+    CHAR_DIGIT = 1 << 3
+};
+
+constexpr std::array<uint8_t, 256> makeCharClasses() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; c++) {
+        uint8_t classes = 0;
+        bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        bool digit = c >= '0' && c <= '9';
+        if (c == ' ' || (c >= '\t' && c <= '\r')) classes |= CHAR_SPACE;
+        if (letter || c == '_') classes |= CHAR_IDENT_START;
+        if (letter || digit || c == '_') classes |= CHAR_IDENT;
+        if (digit) classes |= CHAR_DIGIT;
+        table[c] = classes;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> kCharClasses = makeCharClasses();
+
+inline bool hasClass(char c, uint8_t classes) {
+    return (kCharClasses[static_cast<unsigned char>(c)] & classes) != 0;
+}
+
+enum class ScanLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+const char* scanLevelName(ScanLevel level);
+
+// The widest level this build and CPU support.
+ScanLevel detectScanLevel();
+
+// Selects the scanners, clamped to detectScanLevel(); for benchmarks.
+void setScanLevel(ScanLevel level);
+ScanLevel scanLevel();
+
+const char* scanSpaces(const char* p, const char* end, int& lines);
+const char* scanIdentifier(const char* p, const char* end);
+const char* scanDigits(const char* p, const char* end);
+const char* scanStringBody(const char* p, const char* end, int& lines);
+
+constexpr int kShortRun = 8;
+
+// Whitespace; adds the newlines it crosses to `lines`.
+inline const char* skipSpaces(const char* p, const char* end, int& lines) {
+    for (int i = 0; i < kShortRun; i++, p++) {
+        if (p == end || !hasClass(*p, CHAR_SPACE)) return p;
+        if (*p == '\n') lines++;
+    }
+    return scanSpaces(p, end, lines);
+}
+
+inline const char* skipClass(const char* p, const char* end, uint8_t classes,
+                             const char* (*scan)(const char*, const char*)) {
+    for (int i = 0; i < kShortRun; i++, p++) {
+        if (p == end || !hasClass(*p, classes)) return p;
+    }
+    return scan(p, end);
+}
+
+inline const char* skipIdentifier(const char* p, const char* end) {
+    return skipClass(p, end, CHAR_IDENT, scanIdentifier);
+}
+
+inline const char* skipDigits(const char* p, const char* end) {
+    return skipClass(p, end, CHAR_DIGIT, scanDigits);
+}
+
+// Up to the closing '"' or a NUL byte; adds the newlines it crosses.
+inline const char* skipStringBody(const char* p, const char* end, int& lines) {
+    return scanStringBody(p, end, lines);
+}
+
+#endif
@@ -1,12 +1,29 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
-#include "lexer.h"
-#include "parser.h"
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "arena.h"
+#include "bytecodefile.h"
+#include "mappedfile.h"
 #include "compiler.h"
+#include "emitc.h"
+#include "image.h"
+#include "profiler.h"
+#include "program.h"
+#include "stats.h"
+#include "typechecker.h"
 #include "vm.h"
+#include "workpool.h"
 
 namespace {
 const char* kVersion = "meowlang 1.0.0";
@@ -16,42 +33,415 @@ const char* kBinaryName = "meow.exe";
 const char* kBinaryName = "meow";
 #endif
 
+enum class Backend {
+    STACK,
+    REGISTER
+};
+
+struct Options {
+    Backend backend = Backend::STACK;
+    bool useCache = true;
+    int optimizationLevel = 1; // -O0, -O1 or -O2
+    unsigned irPasses = kAllIrPasses; // --ir-passes
+    bool dumpIr = false;
+    FlushPolicy flush = FlushPolicy::AUTO;
+    bool profile = false;
+    bool stats = false;     // --stats
+    bool statsJson = false; // --stats=json
+    bool jit = false;
+    unsigned jobs = 0; // run-many workers; 0 for one per core
+    std::string output; // -o for build, emit-c and snapshot
+    std::string image;  // --image: heap image to start from
+};
+
 void printUsage() {
     std::cout << "Usage:\n"
-              << "  " << kBinaryName << " <file.meow>\n"
-              << "  " << kBinaryName << " run <file.meow>\n"
-              << "  " << kBinaryName << " repl\n"
+              << "  " << kBinaryName << " [options] <file.meow>\n"
+              << "  " << kBinaryName << " [options] run <file.meow|file.meowc>\n"
+              << "  " << kBinaryName << " build <file.meow> [-o <file.meowc>]\n"
+              << "  " << kBinaryName << " [options] disasm <file.meow>\n"
+              << "  " << kBinaryName << " [options] emit-c <file.meow|file.meowc> [-o <file.c>]\n"
+              << "  " << kBinaryName << " [options] run-many <files or directories>...\n"
+              << "  " << kBinaryName << " [options] snapshot <file.meow> [-o <file.img>]\n"
+              << "  " << kBinaryName << " [options] repl\n"
               << "  " << kBinaryName << " --version\n"
-              << "  " << kBinaryName << " --help\n";
+              << "  " << kBinaryName << " --help\n"
+              << "Options:\n"
+              << "  --backend=stack|register   select the VM instruction set (default: stack)\n"
+              << "  --no-cache                 always recompile instead of using the compile cache\n"
+              << "  -O0, -O1                   disable or enable AST optimizations (default: -O1)\n"
+              << "  -O2                        also optimize the stack bytecode through the SSA IR\n"
+              << "  --ir-passes=LIST           -O2 passes: all, none, or any of copy-prop,cse,dse,\n"
+              << "                             jump-threading, comma-separated (default: all)\n"
+              << "  --dump-ir                  print the IR after building and after each pass to\n"
+              << "                             stderr (compiles through the IR even below -O2)\n"
+              << "  --flush=line|full|explicit when printed output is written out (default: line\n"
+              << "                             on a terminal, full otherwise)\n"
+              << "  --jit                      run stack-machine programs as native x86-64 code\n"
+              << "  --jobs=N                   run-many: scripts to run at once (default: one per core)\n"
+              << "  --image <file.img>         start from the globals saved by `snapshot`\n"
+              << "  --profile                  after running a file, report time per opcode and the\n"
+              << "                             hottest source lines on stderr\n"
+              << "  --stats[=json]             after running a file, report time, allocations, peak\n"
+              << "                             memory and counts per phase on stderr\n";
+}
+
+IrSettings irSettings(const Options& options) {
+    IrSettings settings;
+    settings.enabled = options.optimizationLevel >= 2 || options.dumpIr;
+    settings.passes = options.irPasses;
+    settings.dump = options.dumpIr ? &std::cerr : nullptr;
+    return settings;
+}
+
+// Cached programs are keyed on the optimization level alone, so other IR
+// settings, and dumping the IR, need a fresh compile; so does measuring
+// the front end with --stats.
+bool cacheable(const Options& options) {
+    return options.useCache && options.backend == Backend::STACK && !options.dumpIr &&
+           options.irPasses == kAllIrPasses && !options.stats;
+}
+
+// Source files are mapped rather than read into a string; tokens and the
+// AST refer straight into the mapping.
+std::string_view sourceText(const MappedFile& file) {
+    return std::string_view(reinterpret_cast<const char*>(file.data()), file.size());
 }
 
-std::string readFile(const std::string& path) {
-    std::ifstream file(path);
-    if (!file) {
-        throw std::runtime_error("Could not open file: " + path);
+size_t instructionCount(const ChunkView& chunk) {
+    size_t count = 0;
+    for (size_t offset = 0; offset < chunk.codeSize;
+         offset += 1 + operandWidth(static_cast<OpCode>(chunk.code[offset]))) {
+        count++;
     }
+    return count;
+}
+
+// Loads and runs a Chunk, ChunkView or RegisterChunk, measuring both
+// steps with `stats` if given.
+template <typename Code>
+void runProgram(VM& vm, const Code& program, Stats* stats) {
+    Stats::Phase load(stats, "load");
+    vm.loadProgram(program);
+    load.end();
+    Stats::Phase run(stats, "run");
+    vm.run();
+    if constexpr (std::is_same<Code, RegisterChunk>::value) {
+        run.end("registers", vm.variableCount());
+    } else {
+        run.end("stack_depth", vm.peakStackDepth());
+    }
+}
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+void execute(VM& vm, TypeChecker& checker, Compiler& compiler, Arena& arena, std::string_view source,
+             const Options& options, Stats* stats = nullptr) {
+    auto ast = parseSource(source, checker, arena, options.optimizationLevel, stats);
+    if (options.backend == Backend::REGISTER) {
+        Stats::Phase compile(stats, "compile");
+        RegisterChunk chunk = compiler.compileRegisters(ast);
+        compile.end("instructions", chunk.code.size());
+        runProgram(vm, chunk, stats);
+    } else {
+        Stats::Phase compile(stats, "compile");
+        Chunk chunk = compiler.compile(ast);
+        compile.end("instructions", instructionCount(chunk.view()));
+        runProgram(vm, chunk, stats);
+    }
 }
 
-std::vector<Instruction> compileSource(const std::string& source) {
-    Lexer lexer(source);
-    auto tokens = lexer.tokenize();
+// Runs a source file through the compile cache: an up-to-date .meowc for
+// the same source hash is mapped and executed without touching the front
+// end; otherwise the source is compiled and the result cached. An entry
+// whose code fails verification is rebuilt like a missing one.
+void executeCached(VM& vm, std::string_view source, const Options& options) {
+    uint64_t hash = hashSource(source, options.optimizationLevel);
+    std::string cachePath = compileCachePath(hash);
+
+    std::unique_ptr<BytecodeFile> cached;
+    if (!cachePath.empty()) {
+        try {
+            cached = std::make_unique<BytecodeFile>(cachePath);
+        } catch (const std::exception&) {
+            // Missing or unreadable cache entry: fall through and rebuild.
+        }
+    }
+    bool loaded = false;
+    if (cached && cached->sourceHash() == hash) {
+        try {
+            vm.loadProgram(cached->view());
+            loaded = true;
+        } catch (const std::exception&) {
+            // Fails verification: rebuild it.
+        }
+    }
+    if (loaded) {
+        vm.run();
+        return;
+    }
+
+    TypeChecker checker;
+    Compiler compiler(irSettings(options));
+    Arena arena;
+    Chunk chunk = compiler.compile(parseSource(source, checker, arena, options.optimizationLevel));
+    if (!cachePath.empty()) {
+        try {
+            writeBytecodeFile(cachePath, chunk, hash);
+        } catch (const std::exception&) {
+            // The cache is best-effort.
+        }
+    }
+    vm.loadProgram(chunk);
+    vm.run();
+}
 
-    Parser parser(tokens);
-    auto ast = parser.parse();
+void executeBytecodeFile(VM& vm, const std::string& path, Stats* stats) {
+    Stats::Phase read(stats, "read");
+    BytecodeFile program(path);
+    read.end("instructions", instructionCount(program.view()));
+    runProgram(vm, program.view(), stats);
+}
 
-    Compiler compiler;
-    return compiler.compile(ast);
+// Runs a .meowc or source file, after restoring `image` if there is one.
+// A source file is left mapped in `file`.
+void executeFile(VM& vm, const std::string& path, const Options& options, const Image* image, MappedFile& file,
+                 Stats* stats = nullptr) {
+    if (image) {
+        // Slots depend on the image, so its programs bypass the cache.
+        TypeChecker checker;
+        Compiler compiler(irSettings(options));
+        Stats::Phase restore(stats, "image");
+        image->restore(checker, compiler, vm);
+        restore.end();
+        if (BytecodeFile::hasMagic(path)) {
+            executeBytecodeFile(vm, path, stats);
+        } else {
+            file = MappedFile(path);
+            Arena arena;
+            execute(vm, checker, compiler, arena, sourceText(file), options, stats);
+        }
+    } else if (BytecodeFile::hasMagic(path)) {
+        executeBytecodeFile(vm, path, stats);
+    } else if (cacheable(options)) {
+        file = MappedFile(path);
+        executeCached(vm, sourceText(file), options);
+    } else {
+        file = MappedFile(path);
+        TypeChecker checker;
+        Compiler compiler(irSettings(options));
+        Arena arena;
+        execute(vm, checker, compiler, arena, sourceText(file), options, stats);
+    }
 }
 
-int runFile(VM& vm, const std::string& path) {
+int runFile(VM& vm, const std::string& path, const Options& options) {
+    Profiler profiler;
+    if (options.profile) {
+        vm.setProfiler(&profiler);
+    }
+    std::unique_ptr<Stats> stats;
+    if (options.stats) {
+        stats = std::make_unique<Stats>();
+        vm.setStackTracking(true);
+    }
+    MappedFile file; // stays mapped for the profile's source lines
+    int status = 0;
     try {
-        auto bytecode = compileSource(readFile(path));
-        vm.loadProgram(bytecode);
+        std::unique_ptr<Image> image;
+        if (!options.image.empty()) {
+            image = std::make_unique<Image>(options.image);
+        }
+        executeFile(vm, path, options, image.get(), file, stats.get());
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        status = 1;
+    }
+    if (options.profile) {
+        vm.setProfiler(nullptr);
+        profiler.report(std::cerr, sourceText(file));
+    }
+    if (stats) {
+        stats->report(std::cerr, options.statsJson);
+    }
+    return status;
+}
+
+// The scripts named on the command line; directories contribute every
+// .meow and .meowc file under them, in path order.
+std::vector<std::string> collectScripts(const std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> scripts;
+    for (const std::string& path : paths) {
+        if (!fs::is_directory(path)) {
+            scripts.push_back(path);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto& entry : fs::recursive_directory_iterator(path)) {
+            std::string extension = entry.path().extension().string();
+            if (entry.is_regular_file() && (extension == ".meow" || extension == ".meowc")) {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        scripts.insert(scripts.end(), found.begin(), found.end());
+    }
+    return scripts;
+}
+
+struct ScriptResult {
+    std::string output;
+    std::string error; // empty when the script succeeded
+    double milliseconds = 0;
+};
+
+// Appends a VM's output to the result of the script it is running.
+void appendOutput(void* data, const char* text, size_t size) {
+    static_cast<ScriptResult*>(data)->output.append(text, size);
+}
+
+// Runs scripts on a work-stealing pool with one VM per worker. Each
+// script's output is collected separately and printed under a header in
+// command-line order as soon as it and every script before it are done;
+// its status and wall time go to stderr.
+int runMany(const std::vector<std::string>& paths, const Options& options) {
+    std::vector<std::string> scripts;
+    std::unique_ptr<Image> image; // restored before every script
+    try {
+        scripts = collectScripts(paths);
+        if (!options.image.empty()) {
+            image = std::make_unique<Image>(options.image);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    unsigned workers = options.jobs > 0 ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<ScriptResult> results(scripts.size());
+    std::vector<bool> finished(scripts.size(), false);
+    std::vector<std::unique_ptr<VM>> vms(workers);
+    std::mutex reportLock;
+    size_t nextReport = 0;
+    size_t failures = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    runWorkStealing(scripts.size(), workers, [&](unsigned worker, size_t index) {
+        ScriptResult& result = results[index];
+        auto scriptStart = std::chrono::steady_clock::now();
+        try {
+            if (!vms[worker]) {
+                vms[worker] = std::make_unique<VM>();
+                vms[worker]->outputSink().setPolicy(FlushPolicy::FULL);
+                vms[worker]->setJit(options.jit);
+            }
+            VM& vm = *vms[worker];
+            vm.outputSink().setWriter(appendOutput, &result);
+            MappedFile file;
+            executeFile(vm, scripts[index], options, image.get(), file);
+        } catch (const std::exception& ex) {
+            result.error = ex.what();
+        }
+        result.milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scriptStart).count();
+
+        std::lock_guard<std::mutex> guard(reportLock);
+        finished[index] = true;
+        for (; nextReport < scripts.size() && finished[nextReport]; nextReport++) {
+            const ScriptResult& done = results[nextReport];
+            std::cout << "==> " << scripts[nextReport] << " <==\n" << done.output << std::flush;
+            std::cerr << scripts[nextReport] << ": "
+                      << (done.error.empty() ? "ok" : "Error: " + done.error) << ", "
+                      << std::fixed << std::setprecision(2) << done.milliseconds << " ms\n";
+            failures += done.error.empty() ? 0 : 1;
+            results[nextReport] = ScriptResult(); // release the output
+        }
+    });
+    double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << scripts.size() << " scripts, " << failures << " failed, " << std::fixed << std::setprecision(2)
+              << total << " ms on " << std::min<size_t>(workers, std::max<size_t>(scripts.size(), 1))
+              << " threads\n";
+    return failures > 0 ? 1 : 0;
+}
+
+// `path` with its extension, if any, replaced by `extension`, unless -o
+// names the output.
+std::string outputPath(const std::string& path, const Options& options, const char* extension) {
+    if (!options.output.empty()) {
+        return options.output;
+    }
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    return (hasExtension ? path.substr(0, dot) : path) + extension;
+}
+
+int buildFile(const std::string& path, const Options& options) {
+    try {
+        std::string output = outputPath(path, options, ".meowc");
+        MappedFile file(path);
+        std::string_view source = sourceText(file);
+        TypeChecker checker;
+        Compiler compiler(irSettings(options));
+        Arena arena;
+        Chunk chunk = compiler.compile(parseSource(source, checker, arena, options.optimizationLevel));
+        writeBytecodeFile(output, chunk, hashSource(source, options.optimizationLevel));
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+}
+
+int emitCFile(const std::string& path, const Options& options) {
+    try {
+        std::string output = outputPath(path, options, ".c");
+        std::string text = emitC(Program::load(path, options.optimizationLevel)->view(), path);
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+            throw std::runtime_error("Could not write file: " + output);
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+}
+
+// Runs a source file, starting from --image if given, and saves the
+// globals it leaves behind as a heap image.
+int snapshotFile(VM& vm, const std::string& path, const Options& options) {
+    try {
+        std::string output = outputPath(path, options, ".img");
+        TypeChecker checker;
+        Compiler compiler(irSettings(options));
+        if (!options.image.empty()) {
+            Image(options.image).restore(checker, compiler, vm);
+        }
+        MappedFile file(path);
+        Arena arena;
+        Chunk chunk = compiler.compile(parseSource(sourceText(file), checker, arena, options.optimizationLevel));
+        vm.loadProgram(chunk);
         vm.run();
+        writeImage(output, checker, compiler, vm);
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+}
+
+int disassembleFile(const std::string& path, const Options& options) {
+    try {
+        TypeChecker checker;
+        Compiler compiler(irSettings(options));
+        Arena arena;
+        MappedFile file(path);
+        auto ast = parseSource(sourceText(file), checker, arena, options.optimizationLevel);
+        if (options.backend == Backend::REGISTER) {
+            std::cout << disassemble(compiler.compileRegisters(ast));
+        } else {
+            std::cout << disassemble(compiler.compile(ast));
+        }
         return 0;
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << "\n";
@@ -59,8 +449,22 @@ int runFile(VM& vm, const std::string& path) {
     }
 }
 
-int runRepl(VM& vm) {
+int runRepl(VM& vm, const Options& options) {
+    // Shared so globals keep their types and slots between lines.
+    TypeChecker checker;
+    Compiler compiler(irSettings(options));
+    if (!options.image.empty()) {
+        try {
+            Image(options.image).restore(checker, compiler, vm);
+        } catch (const std::exception& ex) {
+            std::cerr << "Error: " << ex.what() << "\n";
+            return 1;
+        }
+    }
     std::cout << "MeowLang REPL. Type 'exit' to quit.\n";
+    // Each line's tree is dead once it has been compiled, so its nodes
+    // are released in one go and the blocks reused for the next line.
+    Arena arena;
     std::string line;
     while (true) {
         std::cout << "meow> ";
@@ -75,48 +479,118 @@ int runRepl(VM& vm) {
             continue;
         }
         try {
-            auto bytecode = compileSource(line);
-            vm.loadProgram(bytecode);
-            vm.run();
+            execute(vm, checker, compiler, arena, line, options);
         } catch (const std::exception& ex) {
             std::cerr << "Error: " << ex.what() << "\n";
         }
+        arena.reset();
     }
     return 0;
 }
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    Options options;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        }
+        if (arg == "--version") {
+            std::cout << kVersion << "\n";
+            return 0;
+        }
+        if (arg == "--backend=stack") {
+            options.backend = Backend::STACK;
+        } else if (arg == "--backend=register") {
+            options.backend = Backend::REGISTER;
+        } else if (arg == "--no-cache") {
+            options.useCache = false;
+        } else if (arg == "--flush=line") {
+            options.flush = FlushPolicy::LINE;
+        } else if (arg == "--flush=full") {
+            options.flush = FlushPolicy::FULL;
+        } else if (arg == "--flush=explicit") {
+            options.flush = FlushPolicy::EXPLICIT;
+        } else if (arg == "--jit") {
+            options.jit = true;
+        } else if (arg.rfind("--jobs=", 0) == 0 && arg.size() > 7 &&
+                   arg.find_first_not_of("0123456789", 7) == std::string::npos) {
+            options.jobs = static_cast<unsigned>(std::stoul(arg.substr(7)));
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--stats" || arg == "--stats=json") {
+            options.stats = true;
+            options.statsJson = arg == "--stats=json";
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            options.optimizationLevel = arg[2] - '0';
+        } else if (arg.rfind("--ir-passes=", 0) == 0) {
+            if (!parseIrPasses(std::string_view(arg).substr(12), options.irPasses)) {
+                std::cerr << "Error: unknown IR pass in '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg == "--dump-ir") {
+            options.dumpIr = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (arg == "--image" && i + 1 < argc) {
+            options.image = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Error: unknown option '" << arg << "'.\n";
+            printUsage();
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
         printUsage();
         return 1;
     }
 
-    std::string command = argv[1];
+    const std::string& command = args[0];
     VM vm;
+    vm.outputSink().setPolicy(options.flush);
+    vm.setJit(options.jit);
 
-    if (command == "--help" || command == "-h") {
-        printUsage();
-        return 0;
-    }
-
-    if (command == "--version") {
-        std::cout << kVersion << "\n";
-        return 0;
+    if (command == "repl") {
+        return runRepl(vm, options);
     }
 
-    if (command == "repl") {
-        return runRepl(vm);
+    if (command == "run-many") {
+        if (args.size() < 2) {
+            std::cerr << "Error: missing file path.\n";
+            printUsage();
+            return 1;
+        }
+        return runMany(std::vector<std::string>(args.begin() + 1, args.end()), options);
     }
 
-    if (command == "run") {
-        if (argc < 3) {
+    if (command == "run" || command == "disasm" || command == "build" || command == "emit-c" ||
+        command == "snapshot") {
+        if (args.size() < 2) {
             std::cerr << "Error: missing file path.\n";
             printUsage();
             return 1;
         }
-        return runFile(vm, argv[2]);
+        if (command == "disasm") {
+            return disassembleFile(args[1], options);
+        }
+        if (command == "build") {
+            return buildFile(args[1], options);
+        }
+        if (command == "emit-c") {
+            return emitCFile(args[1], options);
+        }
+        if (command == "snapshot") {
+            return snapshotFile(vm, args[1], options);
+        }
+        return runFile(vm, args[1], options);
     }
 
-    return runFile(vm, command);
+    return runFile(vm, command, options);
 }
@@ -0,0 +1,80 @@
+#ifndef MEOW_H
+#define MEOW_H
+
+/* C API of libmeow, for running MeowLang programs inside another process.
+ *
+ * A program is compiled once with meow_program_compile() or
+ * meow_program_load() and is immutable from then on: any number of VMs on
+ * any number of threads may run it at the same time. A VM is a small
+ * execution context that is used by one thread at a time; running the
+ * same program on it again reuses its constants and compiled code.
+ *
+ * Calls that can fail return MEOW_ERROR and leave a message for
+ * meow_last_error() on the calling thread. Nothing here is ever reported
+ * on stderr or ends the process.
+ *
+ * Additions keep existing functions and their behaviour unchanged;
+ * MEOW_API_VERSION counts them. */
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(MEOW_SHARED)
+#ifdef MEOW_BUILDING
+#define MEOW_API __declspec(dllexport)
+#else
+#define MEOW_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+#define MEOW_API __attribute__((visibility("default")))
+#else
+#define MEOW_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEOW_API_VERSION 1
+
+typedef enum meow_status {
+    MEOW_OK = 0,
+    MEOW_ERROR = 1
+} meow_status;
+
+typedef struct meow_program meow_program;
+typedef struct meow_vm meow_vm;
+
+/* Receives a VM's printed output in blocks, in order. Called from
+ * meow_vm_run() on the running thread. */
+typedef void (*meow_write_fn)(void* user_data, const char* text, size_t size);
+
+/* MEOW_API_VERSION of the library actually linked. */
+MEOW_API int meow_api_version(void);
+
+/* Compiles `size` bytes of source. `optimization_level` is 0, 1 or 2,
+ * as with -O0, -O1 and -O2. On success *program owns the result. */
+MEOW_API meow_status meow_program_compile(const char* source, size_t size, int optimization_level,
+                                          meow_program** program);
+/* Maps a .meowc file, or compiles any other file as source. */
+MEOW_API meow_status meow_program_load(const char* path, int optimization_level, meow_program** program);
+/* No VM may be running the program. Null is ignored. */
+MEOW_API void meow_program_free(meow_program* program);
+
+/* A VM that passes its output to `write`, or to stdout when `write` is
+ * null. Returns null when out of memory. */
+MEOW_API meow_vm* meow_vm_new(meow_write_fn write, void* user_data);
+MEOW_API void meow_vm_free(meow_vm* vm);
+
+/* Runs `program` to the end. Output printed before a runtime error is
+ * still delivered. Variables do not carry over between programs. */
+MEOW_API meow_status meow_vm_run(meow_vm* vm, const meow_program* program);
+
+/* Message of the last call on this thread that returned MEOW_ERROR;
+ * valid until the next such call on the thread. */
+MEOW_API const char* meow_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,402 @@
+#include "optimizer.h"
+#include "bigint.h"
+#include "valueops.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const LiteralExpr* asLiteral(ExprPtr expr) {
+    return expr && expr->kind == NodeKind::LITERAL ? static_cast<const LiteralExpr*>(expr) : nullptr;
+}
+
+bool isIntLiteral(ExprPtr expr, int64_t value) {
+    const LiteralExpr* literal = asLiteral(expr);
+    return literal && literal->type == ValueType::INT && !literal->isBig() && literal->value.as.i == value;
+}
+
+bool isBoolLiteral(ExprPtr expr, bool value) {
+    const LiteralExpr* literal = asLiteral(expr);
+    return literal && literal->type == ValueType::BOOL && literal->value.as.b == value;
+}
+
+// Assignments, and divisions because they can raise a runtime error.
+bool hasSideEffects(ExprPtr expr) {
+    switch (expr->kind) {
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            return binary->op == BinaryOp::ASSIGN || binary->op == BinaryOp::DIV || binary->op == BinaryOp::MOD ||
+                   hasSideEffects(binary->left) || hasSideEffects(binary->right);
+        }
+        case NodeKind::UNARY:
+            return hasSideEffects(static_cast<UnaryExpr*>(expr)->right);
+        default:
+            return false;
+    }
+}
+
+ArithOp arithmeticOp(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::ADD: return ArithOp::ADD;
+        case BinaryOp::SUB: return ArithOp::SUB;
+        case BinaryOp::MUL: return ArithOp::MUL;
+        case BinaryOp::DIV: return ArithOp::DIV;
+        default: return ArithOp::MOD;
+    }
+}
+}
+
+Optimizer::Optimizer(Arena& a)
+    : arena(a) {}
+
+std::vector<StmtPtr> Optimizer::optimize(const std::vector<StmtPtr>& statements) {
+    declScopes.assign(1, {});
+    reassigned.clear();
+    for (StmtPtr stmt : statements) {
+        collectAssignments(stmt);
+    }
+
+    scopes.assign(1, {});
+    std::vector<StmtPtr> result;
+    result.reserve(statements.size());
+    for (StmtPtr stmt : statements) {
+        if (StmtPtr optimized = optimizeStatement(stmt)) {
+            result.push_back(optimized);
+        }
+    }
+    return result;
+}
+
+
+// ================= ASSIGNMENT ANALYSIS =================
+
+const VarDeclStmt* Optimizer::resolveDeclaration(std::string_view name) const {
+    for (auto scope = declScopes.rbegin(); scope != declScopes.rend(); ++scope) {
+        auto it = scope->find(name);
+        if (it != scope->end()) {
+            return it->second;
+        }
+    }
+    return nullptr; // declared by an earlier compilation unit (REPL)
+}
+
+void Optimizer::collectAssignments(StmtPtr stmt) {
+    switch (stmt->kind) {
+        case NodeKind::PRINT:
+            collectAssignments(static_cast<PrintStmt*>(stmt)->expression);
+            break;
+        case NodeKind::VAR_DECL: {
+            auto* varDecl = static_cast<VarDeclStmt*>(stmt);
+            if (varDecl->initializer) {
+                collectAssignments(varDecl->initializer);
+            }
+            // Redeclaring a name in the same scope reuses its slot, which
+            // makes it an assignment to the earlier declaration as well.
+            auto& scope = declScopes.back();
+            auto existing = scope.find(varDecl->name);
+            if (existing != scope.end()) {
+                reassigned.insert(existing->second);
+            }
+            scope[varDecl->name] = varDecl;
+            break;
+        }
+        case NodeKind::EXPR_STMT:
+            collectAssignments(static_cast<ExprStmt*>(stmt)->expression);
+            break;
+        case NodeKind::BLOCK:
+            declScopes.emplace_back();
+            for (StmtPtr s : *static_cast<BlockStmt*>(stmt)) {
+                collectAssignments(s);
+            }
+            declScopes.pop_back();
+            break;
+        case NodeKind::IF: {
+            auto* ifStmt = static_cast<IfStmt*>(stmt);
+            collectAssignments(ifStmt->condition);
+            collectAssignments(ifStmt->thenBranch);
+            // `if (c) int x = 1;` only initializes x when c holds.
+            if (ifStmt->thenBranch->kind == NodeKind::VAR_DECL) {
+                reassigned.insert(static_cast<VarDeclStmt*>(ifStmt->thenBranch));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void Optimizer::collectAssignments(ExprPtr expr) {
+    if (expr->kind == NodeKind::BINARY) {
+        auto* binary = static_cast<BinaryExpr*>(expr);
+        if (binary->op == BinaryOp::ASSIGN && binary->left->kind == NodeKind::VARIABLE) {
+            if (const VarDeclStmt* decl = resolveDeclaration(static_cast<VariableExpr*>(binary->left)->name)) {
+                reassigned.insert(decl);
+            }
+        }
+        collectAssignments(binary->left);
+        collectAssignments(binary->right);
+    } else if (expr->kind == NodeKind::UNARY) {
+        collectAssignments(static_cast<UnaryExpr*>(expr)->right);
+    }
+}
+
+
+// ================= REWRITING =================
+
+const LiteralExpr* Optimizer::resolveConstant(std::string_view name) const {
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto it = scope->find(name);
+        if (it != scope->end()) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+LiteralExpr* Optimizer::makeLiteral(const Value& value, int line) {
+    LiteralExpr* literal = arena.make<LiteralExpr>(value);
+    literal->line = line;
+    return literal;
+}
+
+LiteralExpr* Optimizer::makeInt(const BigInt& value, int line) {
+    int64_t small = 0;
+    if (value.toInt64(small)) {
+        return makeLiteral(Value::makeInt(small), line);
+    }
+    std::string digits = value.toString();
+    char* text = arena.allocateArray<char>(digits.size());
+    std::memcpy(text, digits.data(), digits.size());
+    Value big = Value::makeInt(0);
+    big.inlineLength = kHeapInt;
+    LiteralExpr* literal = makeLiteral(big, line);
+    literal->text = std::string_view(text, digits.size());
+    return literal;
+}
+
+LiteralExpr* Optimizer::concatenate(std::string_view left, std::string_view right, int line) {
+    char* text = arena.allocateArray<char>(left.size() + right.size());
+    std::memcpy(text, left.data(), left.size());
+    std::memcpy(text + left.size(), right.data(), right.size());
+    LiteralExpr* literal = arena.make<LiteralExpr>(std::string_view(text, left.size() + right.size()));
+    literal->line = line;
+    return literal;
+}
+
+StmtPtr Optimizer::optimizeStatement(StmtPtr stmt) {
+    switch (stmt->kind) {
+        case NodeKind::PRINT: {
+            auto* printStmt = static_cast<PrintStmt*>(stmt);
+            printStmt->expression = optimizeExpression(printStmt->expression);
+            return printStmt;
+        }
+        case NodeKind::VAR_DECL: {
+            auto* varDecl = static_cast<VarDeclStmt*>(stmt);
+            if (varDecl->initializer) {
+                varDecl->initializer = optimizeExpression(varDecl->initializer);
+            }
+
+            const LiteralExpr* constant = nullptr;
+            const LiteralExpr* literal = asLiteral(varDecl->initializer);
+            if (literal && !reassigned.count(varDecl)) {
+                constant = literal;
+                // `deci d = 1;` stores a deci, so propagate one.
+                if (literal->type == ValueType::INT && varDecl->type == ValueType::DECI) {
+                    double widened = literal->isBig() ? BigInt::parse(literal->text).toDouble()
+                                                      : static_cast<double>(literal->value.as.i);
+                    constant = makeLiteral(Value::makeDeci(widened), literal->line);
+                }
+            }
+            scopes.back()[varDecl->name] = constant;
+            return varDecl;
+        }
+        case NodeKind::EXPR_STMT: {
+            auto* exprStmt = static_cast<ExprStmt*>(stmt);
+            exprStmt->expression = optimizeExpression(exprStmt->expression);
+            return asLiteral(exprStmt->expression) ? nullptr : exprStmt;
+        }
+        case NodeKind::BLOCK: {
+            auto* blockStmt = static_cast<BlockStmt*>(stmt);
+            scopes.emplace_back();
+            uint32_t kept = 0;
+            for (StmtPtr s : *blockStmt) {
+                if (StmtPtr optimized = optimizeStatement(s)) {
+                    blockStmt->statements[kept++] = optimized;
+                }
+            }
+            blockStmt->count = kept;
+            scopes.pop_back();
+            return blockStmt;
+        }
+        case NodeKind::IF: {
+            auto* ifStmt = static_cast<IfStmt*>(stmt);
+            ifStmt->condition = optimizeExpression(ifStmt->condition);
+            // A bare declaration as the body still declares its name in
+            // the enclosing scope, so that form keeps its `if`.
+            const LiteralExpr* literal = asLiteral(ifStmt->condition);
+            if (literal && ifStmt->thenBranch->kind != NodeKind::VAR_DECL) {
+                return literal->value.as.b ? optimizeStatement(ifStmt->thenBranch) : nullptr;
+            }
+            ifStmt->thenBranch = optimizeStatement(ifStmt->thenBranch);
+            if (!ifStmt->thenBranch) {
+                ifStmt->thenBranch = arena.make<BlockStmt>(nullptr, 0);
+            }
+            return ifStmt;
+        }
+        default:
+            return stmt;
+    }
+}
+
+ExprPtr Optimizer::optimizeExpression(ExprPtr expr) {
+    switch (expr->kind) {
+        case NodeKind::VARIABLE: {
+            if (const LiteralExpr* constant = resolveConstant(static_cast<VariableExpr*>(expr)->name)) {
+                LiteralExpr* literal = arena.make<LiteralExpr>(*constant);
+                literal->line = expr->line;
+                return literal;
+            }
+            return expr;
+        }
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            if (binary->op != BinaryOp::ASSIGN) {
+                binary->left = optimizeExpression(binary->left);
+            }
+            binary->right = optimizeExpression(binary->right);
+            return foldBinary(binary);
+        }
+        case NodeKind::UNARY: {
+            auto* unary = static_cast<UnaryExpr*>(expr);
+            unary->right = optimizeExpression(unary->right);
+            return foldUnary(unary);
+        }
+        default:
+            return expr;
+    }
+}
+
+ExprPtr Optimizer::foldBinary(BinaryExpr* binary) {
+    BinaryOp op = binary->op;
+    if (op == BinaryOp::ASSIGN) {
+        return binary;
+    }
+
+    const LiteralExpr* left = asLiteral(binary->left);
+    const LiteralExpr* right = asLiteral(binary->right);
+
+    if (left && right && !left->isBig() && !right->isBig()) {
+        // The TypeChecker guarantees matching operands: two strings or two
+        // scalars, bools for && and ||, numbers for arithmetic.
+        bool strings = left->type == ValueType::STRING;
+        bool result = false;
+        switch (op) {
+            case BinaryOp::ADD:
+                if (strings) {
+                    return concatenate(left->text, right->text, binary->line);
+                }
+                [[fallthrough]];
+            case BinaryOp::SUB:
+            case BinaryOp::MUL:
+            case BinaryOp::DIV:
+            case BinaryOp::MOD:
+                try {
+                    Value value;
+                    if (arithmetic(arithmeticOp(op), left->value, right->value, value)) {
+                        return makeLiteral(value, binary->line);
+                    }
+                    // Overflows into a big int: left for runtime, as is
+                    // arithmetic on big literals.
+                    return binary;
+                } catch (const std::runtime_error&) {
+                    // Would fail at runtime (e.g. division by zero): leave it there.
+                    return binary;
+                }
+            case BinaryOp::AND:
+                result = left->value.as.b && right->value.as.b;
+                break;
+            case BinaryOp::OR:
+                result = left->value.as.b || right->value.as.b;
+                break;
+            case BinaryOp::EQUAL:
+            case BinaryOp::NOT_EQUAL: {
+                bool equal = strings ? left->text == right->text : scalarsEqual(left->value, right->value);
+                result = op == BinaryOp::EQUAL ? equal : !equal;
+                break;
+            }
+            default: {
+                int c = strings ? left->text.compare(right->text) : compareScalars(left->value, right->value);
+                result = op == BinaryOp::LESS ? c < 0
+                       : op == BinaryOp::LESS_EQUAL ? c <= 0
+                       : op == BinaryOp::GREATER ? c > 0
+                       : c >= 0;
+                break;
+            }
+        }
+        return makeLiteral(Value::makeBool(result), binary->line);
+    }
+
+    // Algebraic identities. The remaining operand must already have the
+    // result's type, so that no int to deci widening is lost.
+    ExprPtr l = binary->left;
+    ExprPtr r = binary->right;
+    if (!left && !right) {
+        return binary;
+    }
+    bool lSame = l->type == binary->type;
+    bool rSame = r->type == binary->type;
+    bool isInt = binary->type == ValueType::INT;
+
+    switch (op) {
+        case BinaryOp::MUL:
+            if (lSame && isIntLiteral(r, 1)) return l;
+            if (rSame && isIntLiteral(l, 1)) return r;
+            if (isInt && isIntLiteral(r, 0) && !hasSideEffects(l)) return r;
+            if (isInt && isIntLiteral(l, 0) && !hasSideEffects(r)) return l;
+            break;
+        case BinaryOp::DIV:
+            if (lSame && isIntLiteral(r, 1)) return l;
+            break;
+        case BinaryOp::ADD:
+            // -0.0 + 0 is +0.0, so only integers lose the addition.
+            if (isInt && isIntLiteral(r, 0)) return l;
+            if (isInt && isIntLiteral(l, 0)) return r;
+            break;
+        case BinaryOp::SUB:
+            if (lSame && isIntLiteral(r, 0)) return l;
+            break;
+        case BinaryOp::AND:
+            if (isBoolLiteral(r, true)) return l;
+            if (isBoolLiteral(l, true)) return r;
+            break;
+        case BinaryOp::OR:
+            if (isBoolLiteral(r, false)) return l;
+            if (isBoolLiteral(l, false)) return r;
+            break;
+        default:
+            break;
+    }
+    return binary;
+}
+
+ExprPtr Optimizer::foldUnary(UnaryExpr* unary) {
+    if (const LiteralExpr* literal = asLiteral(unary->right)) {
+        if (unary->op == UnaryOp::NOT) {
+            return makeLiteral(Value::makeBool(!literal->value.as.b), unary->line);
+        }
+        if (literal->isBig()) {
+            return makeInt(-BigInt::parse(literal->text), unary->line);
+        }
+        Value value;
+        if (negate(literal->value, value)) {
+            return makeLiteral(value, unary->line);
+        }
+        return unary;
+    }
+
+    // !!b and --x
+    if (unary->right->kind == NodeKind::UNARY) {
+        auto* inner = static_cast<UnaryExpr*>(unary->right);
+        if (inner->op == unary->op) return inner->right;
+    }
+    return unary;
+}
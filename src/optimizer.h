@@ -0,0 +1,57 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "arena.h"
+#include "ast.h"
+#include "bigint.h"
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// AST-to-AST optimization pass run between TypeChecker::check() and
+// Compiler::compile() at -O1. It relies on and preserves Expression::type:
+//
+//  - constant folding with the VM's int/deci semantics (see valueops.h);
+//    anything that would fail at runtime, such as 1 / 0, is left alone;
+//    literal strings are concatenated into the arena
+//  - algebraic identities such as x * 1, x + 0, b && true
+//  - propagation of constants from declarations that are never assigned
+//  - removal of `if` statements whose condition is a constant
+//
+// Nodes are rewritten in place and replacements come from the same arena
+// as the tree. Names stay valid for the whole pass, so they are keyed by
+// their string_view.
+class Optimizer {
+private:
+    Arena& arena;
+
+    // Resolution happens twice with identical scoping: once to find the
+    // declarations that are assigned anywhere, once to rewrite.
+    std::vector<std::unordered_map<std::string_view, const VarDeclStmt*>> declScopes;
+    std::unordered_set<const VarDeclStmt*> reassigned;
+
+    // Value of each visible variable, or null when it is not a constant.
+    std::vector<std::unordered_map<std::string_view, const LiteralExpr*>> scopes;
+
+    void collectAssignments(StmtPtr stmt);
+    void collectAssignments(ExprPtr expr);
+    const VarDeclStmt* resolveDeclaration(std::string_view name) const;
+
+    const LiteralExpr* resolveConstant(std::string_view name) const;
+    LiteralExpr* makeLiteral(const Value& value, int line);
+    // A big literal (LiteralExpr::isBig) unless the value fits in 64 bits.
+    LiteralExpr* makeInt(const BigInt& value, int line);
+    LiteralExpr* concatenate(std::string_view left, std::string_view right, int line);
+
+    StmtPtr optimizeStatement(StmtPtr stmt);
+    ExprPtr optimizeExpression(ExprPtr expr);
+    ExprPtr foldBinary(BinaryExpr* binary);
+    ExprPtr foldUnary(UnaryExpr* unary);
+
+public:
+    explicit Optimizer(Arena& arena);
+    std::vector<StmtPtr> optimize(const std::vector<StmtPtr>& statements);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "output.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#define MEOW_ISATTY(fd) _isatty(fd)
+#define MEOW_FILENO(file) _fileno(file)
+#else
+#include <unistd.h>
+#define MEOW_ISATTY(fd) isatty(fd)
+#define MEOW_FILENO(file) fileno(file)
+#endif
+
+namespace {
+// Longest std::to_chars output for an int64_t or a double.
+const size_t kMaxNumberLength = 32;
+}
+
+OutputSink::OutputSink(std::FILE* f, FlushPolicy p)
+    : file(f), writer(nullptr), writerData(nullptr), policy(FlushPolicy::FULL),
+      buffer(new char[kBufferSize]), used(0) {
+    setPolicy(p);
+}
+
+OutputSink::~OutputSink() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Nowhere left to report it.
+    }
+}
+
+void OutputSink::setFile(std::FILE* f) {
+    flush();
+    file = f;
+    writer = nullptr;
+    writerData = nullptr;
+}
+
+void OutputSink::setWriter(Writer w, void* data) {
+    flush();
+    writer = w;
+    writerData = data;
+}
+
+void OutputSink::setPolicy(FlushPolicy p) {
+    if (p == FlushPolicy::AUTO) {
+        p = !writer && MEOW_ISATTY(MEOW_FILENO(file)) ? FlushPolicy::LINE : FlushPolicy::FULL;
+    }
+    policy = p;
+}
+
+void OutputSink::deliver(const char* text, size_t size) {
+    if (writer) {
+        writer(writerData, text, size);
+    } else if (std::fwrite(text, 1, size, file) != size) {
+        throw std::runtime_error("Could not write output");
+    }
+}
+
+char* OutputSink::reserve(size_t size) {
+    if (kBufferSize - used < size) {
+        flush();
+    }
+    return buffer.get() + used;
+}
+
+void OutputSink::write(std::string_view text) {
+    if (text.size() > kBufferSize - used) {
+        flush();
+        if (text.size() >= kBufferSize) {
+            // Too big to be worth copying.
+            deliver(text.data(), text.size());
+            return;
+        }
+    }
+    std::memcpy(buffer.get() + used, text.data(), text.size());
+    used += text.size();
+}
+
+void OutputSink::write(char c) {
+    *reserve(1) = c;
+    used++;
+}
+
+void OutputSink::write(int64_t value) {
+    char* first = reserve(kMaxNumberLength);
+    used = static_cast<size_t>(std::to_chars(first, first + kMaxNumberLength, value).ptr - buffer.get());
+}
+
+void OutputSink::write(double value) {
+    // Which NaN an operation returns depends on operand order, which the
+    // compiler (or the JIT) is free to pick for commutative operators, so
+    // its sign is not printed.
+    if (std::isnan(value)) {
+        write(std::string_view("nan"));
+        return;
+    }
+    char* first = reserve(kMaxNumberLength);
+    used = static_cast<size_t>(std::to_chars(first, first + kMaxNumberLength, value).ptr - buffer.get());
+}
+
+void OutputSink::endLine() {
+    write('\n');
+    if (policy == FlushPolicy::LINE) {
+        flush();
+    }
+}
+
+void OutputSink::endRun() {
+    if (policy != FlushPolicy::EXPLICIT) {
+        flush();
+    }
+}
+
+void OutputSink::flush() {
+    size_t pending = used;
+    used = 0;
+    if (pending > 0) {
+        deliver(buffer.get(), pending);
+    }
+    if (!writer) {
+        std::fflush(file);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+
+// When buffered program output is handed to the underlying FILE.
+enum class FlushPolicy {
+    AUTO,     // LINE when the file is a terminal, FULL otherwise
+    LINE,     // after every printed line
+    FULL,     // when the buffer fills and when a run ends
+    EXPLICIT  // when the buffer fills, on flush() and on destruction only
+};
+
+// Buffered writer behind `meow <<`. Printing goes into one reusable
+// buffer and reaches the FILE in large blocks, so piping a print-heavy
+// program to a file costs a write per buffer instead of one per line.
+// Writes go through stdio so they stay ordered with std::cout, or to a
+// callback that an embedder provides instead of a file.
+class OutputSink {
+public:
+    // Receives every block of output, in order.
+    using Writer = void (*)(void* data, const char* text, size_t size);
+
+private:
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    std::FILE* file;
+    Writer writer; // used instead of `file` when set
+    void* writerData;
+    FlushPolicy policy;
+    std::unique_ptr<char[]> buffer;
+    size_t used;
+
+    char* reserve(size_t size);
+    void deliver(const char* text, size_t size);
+
+public:
+    explicit OutputSink(std::FILE* file = stdout, FlushPolicy policy = FlushPolicy::AUTO);
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    // Flushes what is buffered to the current file or writer first.
+    void setFile(std::FILE* file);
+    void setWriter(Writer writer, void* data);
+    // AUTO is resolved against the file when set; it is FULL for a writer.
+    void setPolicy(FlushPolicy policy);
+    FlushPolicy flushPolicy() const { return policy; }
+
+    void write(std::string_view text);
+    void write(char c);
+    // Shortest text that parses back to the same value (std::to_chars);
+    // every NaN prints as "nan".
+    void write(int64_t value);
+    void write(double value);
+
+    // Ends a printed line; flushes under LINE.
+    void endLine();
+    // Called when a run ends: flushes unless the policy is EXPLICIT.
+    void endRun();
+    void flush();
+};
+
+#endif
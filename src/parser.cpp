@@ -1,21 +1,75 @@
 #include "parser.h"
+#include "valueops.h"
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 
-Parser::Parser(const std::vector<Token>& t)
-    : tokens(t), current(0) {}
+namespace {
+BinaryOp binaryOp(TokenType type) {
+    switch (type) {
+        case TokenType::PLUS: return BinaryOp::ADD;
+        case TokenType::MINUS: return BinaryOp::SUB;
+        case TokenType::STAR: return BinaryOp::MUL;
+        case TokenType::SLASH: return BinaryOp::DIV;
+        case TokenType::MOD: return BinaryOp::MOD;
+        case TokenType::EQUAL_EQUAL: return BinaryOp::EQUAL;
+        case TokenType::NOT_EQUAL: return BinaryOp::NOT_EQUAL;
+        case TokenType::LESS: return BinaryOp::LESS;
+        case TokenType::LESS_EQUAL: return BinaryOp::LESS_EQUAL;
+        case TokenType::GREATER: return BinaryOp::GREATER;
+        case TokenType::GREATER_EQUAL: return BinaryOp::GREATER_EQUAL;
+        case TokenType::AND: return BinaryOp::AND;
+        case TokenType::OR: return BinaryOp::OR;
+        default: break;
+    }
+    throw std::runtime_error("Not a binary operator");
+}
+
+ValueType declaredType(TokenType type) {
+    switch (type) {
+        case TokenType::DECI: return ValueType::DECI;
+        case TokenType::BOOL: return ValueType::BOOL;
+        case TokenType::CHAR: return ValueType::CHAR;
+        case TokenType::STRING: return ValueType::STRING;
+        default: return ValueType::INT;
+    }
+}
+}
+
+Parser::Parser(Lexer& lexer, Arena& a)
+    : tokens(lexer), source(lexer.text()), arena(a), nodes(0) {}
+
+template <typename T, typename... Args>
+T* Parser::node(int line, Args&&... args) {
+    T* result = arena.make<T>(std::forward<Args>(args)...);
+    result->line = line;
+    nodes++;
+    return result;
+}
+
+ExprPtr Parser::literal(ValueType type) {
+    const Token& token = previous();
+    try {
+        LiteralExpr* literal = node<LiteralExpr>(token.line, parseLiteral(type, token.text(source)));
+        if (literal->isBig()) {
+            literal->text = token.text(source);
+        }
+        return literal;
+    } catch (const std::runtime_error& error) {
+        throw std::runtime_error(std::string(error.what()) + " at line " + std::to_string(token.line));
+    }
+}
 
-Token Parser::peek() { return tokens[current]; }
-Token Parser::previous() { return tokens[current - 1]; }
+const Token& Parser::peek() { return tokens.peek(); }
+const Token& Parser::previous() const { return tokens.previous(); }
 bool Parser::isAtEnd() { return peek().type == TokenType::END_OF_FILE; }
 
-Token Parser::advance() {
-    if (!isAtEnd()) current++;
+const Token& Parser::advance() {
+    if (!isAtEnd()) return tokens.advance();
     return previous();
 }
 
 bool Parser::check(TokenType type) {
-    if (isAtEnd()) return false;
     return peek().type == type;
 }
 
@@ -55,9 +109,10 @@ StmtPtr Parser::declaration() {
 }
 
 StmtPtr Parser::varDeclaration() {
-    std::string type = previous().value;
+    ValueType type = declaredType(previous().type);
+    int line = previous().line;
 
-    Token name = advance(); // identifier
+    Token name = advance(); // identifier; copied, the ring slot is reused
 
     ExprPtr initializer = nullptr;
 
@@ -67,7 +122,7 @@ StmtPtr Parser::varDeclaration() {
 
     match(TokenType::SEMICOLON);
 
-    return std::make_shared<VarDeclStmt>(type, name.value, initializer);
+    return node<VarDeclStmt>(line, type, name.text(source), initializer);
 }
 
 
@@ -83,34 +138,43 @@ StmtPtr Parser::statement() {
     if (match(TokenType::LBRACE))
         return block();
 
-    return std::make_shared<ExprStmt>(expression());
+    int line = peek().line;
+    ExprPtr expr = expression();
+    match(TokenType::SEMICOLON);
+    return node<ExprStmt>(line, expr);
 }
 
 StmtPtr Parser::printStatement() {
+    int line = previous().line;
     match(TokenType::SHIFT_LEFT);
     ExprPtr value = expression();
     match(TokenType::SEMICOLON);
-    return std::make_shared<PrintStmt>(value);
+    return node<PrintStmt>(line, value);
 }
 
 StmtPtr Parser::ifStatement() {
+    int line = previous().line;
     match(TokenType::LPAREN);
     ExprPtr condition = expression();
     match(TokenType::RPAREN);
 
     StmtPtr thenBranch = statement();
-    return std::make_shared<IfStmt>(condition, thenBranch);
+    return node<IfStmt>(line, condition, thenBranch);
 }
 
 StmtPtr Parser::block() {
-    auto blockStmt = std::make_shared<BlockStmt>();
+    int line = previous().line;
+    std::vector<StmtPtr> statements;
 
     while (!check(TokenType::RBRACE) && !isAtEnd()) {
-        blockStmt->statements.push_back(declaration());
+        statements.push_back(declaration());
     }
 
     match(TokenType::RBRACE);
-    return blockStmt;
+
+    StmtPtr* items = arena.allocateArray<StmtPtr>(statements.size());
+    std::copy(statements.begin(), statements.end(), items);
+    return node<BlockStmt>(line, items, static_cast<uint32_t>(statements.size()));
 }
 
 
@@ -124,8 +188,9 @@ ExprPtr Parser::assignment() {
     ExprPtr expr = logicalOr();
 
     if (match(TokenType::ASSIGN)) {
+        int line = previous().line;
         ExprPtr value = assignment();
-        return std::make_shared<BinaryExpr>(expr, "=", value);
+        return node<BinaryExpr>(line, expr, BinaryOp::ASSIGN, value);
     }
 
     return expr;
@@ -134,9 +199,10 @@ ExprPtr Parser::assignment() {
 ExprPtr Parser::logicalOr() {
     ExprPtr expr = logicalAnd();
     while (match(TokenType::OR)) {
-        std::string op = previous().value;
+        BinaryOp op = binaryOp(previous().type);
+        int line = previous().line;
         ExprPtr right = logicalAnd();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = node<BinaryExpr>(line, expr, op, right);
     }
     return expr;
 }
@@ -144,9 +210,10 @@ ExprPtr Parser::logicalOr() {
 ExprPtr Parser::logicalAnd() {
     ExprPtr expr = equality();
     while (match(TokenType::AND)) {
-        std::string op = previous().value;
+        BinaryOp op = binaryOp(previous().type);
+        int line = previous().line;
         ExprPtr right = equality();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = node<BinaryExpr>(line, expr, op, right);
     }
     return expr;
 }
@@ -154,9 +221,10 @@ ExprPtr Parser::logicalAnd() {
 ExprPtr Parser::equality() {
     ExprPtr expr = comparison();
     while (match(TokenType::EQUAL_EQUAL) || match(TokenType::NOT_EQUAL)) {
-        std::string op = previous().value;
+        BinaryOp op = binaryOp(previous().type);
+        int line = previous().line;
         ExprPtr right = comparison();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = node<BinaryExpr>(line, expr, op, right);
     }
     return expr;
 }
@@ -165,9 +233,10 @@ ExprPtr Parser::comparison() {
     ExprPtr expr = term();
     while (match(TokenType::LESS) || match(TokenType::GREATER) ||
            match(TokenType::LESS_EQUAL) || match(TokenType::GREATER_EQUAL)) {
-        std::string op = previous().value;
+        BinaryOp op = binaryOp(previous().type);
+        int line = previous().line;
         ExprPtr right = term();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = node<BinaryExpr>(line, expr, op, right);
     }
     return expr;
 }
@@ -175,9 +244,10 @@ ExprPtr Parser::comparison() {
 ExprPtr Parser::term() {
     ExprPtr expr = factor();
     while (match(TokenType::PLUS) || match(TokenType::MINUS)) {
-        std::string op = previous().value;
+        BinaryOp op = binaryOp(previous().type);
+        int line = previous().line;
         ExprPtr right = factor();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = node<BinaryExpr>(line, expr, op, right);
     }
     return expr;
 }
@@ -185,35 +255,42 @@ ExprPtr Parser::term() {
 ExprPtr Parser::factor() {
     ExprPtr expr = unary();
     while (match(TokenType::STAR) || match(TokenType::SLASH) || match(TokenType::MOD)) {
-        std::string op = previous().value;
+        BinaryOp op = binaryOp(previous().type);
+        int line = previous().line;
         ExprPtr right = unary();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = node<BinaryExpr>(line, expr, op, right);
     }
     return expr;
 }
 
 ExprPtr Parser::unary() {
     if (match(TokenType::NOT) || match(TokenType::MINUS)) {
-        std::string op = previous().value;
+        UnaryOp op = previous().type == TokenType::NOT ? UnaryOp::NOT : UnaryOp::NEGATE;
+        int line = previous().line;
         ExprPtr right = unary();
-        return std::make_shared<UnaryExpr>(op, right);
+        return node<UnaryExpr>(line, op, right);
     }
     return primary();
 }
 
 ExprPtr Parser::primary() {
-    if (match(TokenType::INTEGER_LITERAL) ||
-        match(TokenType::DECIMAL_LITERAL) ||
-        match(TokenType::STRING_LITERAL) ||
-        match(TokenType::CHAR_LITERAL) ||
-        match(TokenType::TRUE) ||
-        match(TokenType::FALSE)) {
+    if (match(TokenType::INTEGER_LITERAL))
+        return literal(ValueType::INT);
 
-        return std::make_shared<LiteralExpr>(previous().value);
-    }
+    if (match(TokenType::DECIMAL_LITERAL))
+        return literal(ValueType::DECI);
+
+    if (match(TokenType::STRING_LITERAL))
+        return node<LiteralExpr>(previous().line, previous().text(source));
+
+    if (match(TokenType::CHAR_LITERAL))
+        return literal(ValueType::CHAR);
+
+    if (match(TokenType::TRUE) || match(TokenType::FALSE))
+        return literal(ValueType::BOOL);
 
     if (match(TokenType::IDENTIFIER)) {
-        return std::make_shared<VariableExpr>(previous().value);
+        return node<VariableExpr>(previous().line, previous().text(source));
     }
 
     if (match(TokenType::LPAREN)) {
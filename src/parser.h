@@ -1,20 +1,29 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include "arena.h"
 #include "ast.h"
-#include "token.h"
+#include "lexer.h"
+#include <cstddef>
+#include <string_view>
 #include <vector>
 
 class Parser {
 private:
-    std::vector<Token> tokens;
-    int current;
+    TokenStream tokens;
+    std::string_view source; // the text the tokens refer to
+    Arena& arena;            // receives the AST
+    size_t nodes;            // made so far
 
-    Token peek();
-    Token previous();
+    template <typename T, typename... Args>
+    T* node(int line, Args&&... args);
+    ExprPtr literal(ValueType type);
+
+    const Token& peek();
+    const Token& previous() const;
     bool match(TokenType type);
     bool check(TokenType type);
-    Token advance();
+    const Token& advance();
     bool isAtEnd();
 
     // parsing
@@ -37,8 +46,12 @@ private:
     ExprPtr primary();
 
 public:
-    explicit Parser(const std::vector<Token>& t);
+    // Pulls tokens from `lexer` as it goes. Names and string literals in
+    // the AST are views into the lexer's source, which must outlive it.
+    Parser(Lexer& lexer, Arena& arena);
     std::vector<StmtPtr> parse();
+
+    size_t nodeCount() const { return nodes; }
 };
 
 #endif
@@ -0,0 +1,148 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+
+namespace {
+const size_t kHottestLines = 10;
+
+struct Total {
+    uint64_t count = 0;
+    uint64_t ticks = 0;
+};
+
+std::string formatRow(const char* label, const Total& total, double nanosPerTick, uint64_t allTicks) {
+    double ms = static_cast<double>(total.ticks) * nanosPerTick / 1e6;
+    double percent = allTicks ? 100.0 * static_cast<double>(total.ticks) / static_cast<double>(allTicks) : 0.0;
+    char row[128];
+    std::snprintf(row, sizeof(row), "  %-20s %14llu %12.3f %6.1f%%", label,
+                  static_cast<unsigned long long>(total.count), ms, percent);
+    return row;
+}
+
+// Fills in the trimmed text of every line number in `found`.
+void findLines(std::string_view source, std::map<int, std::string_view>& found) {
+    int number = 1;
+    size_t start = 0;
+    while (start <= source.size()) {
+        size_t end = source.find('\n', start);
+        if (end == std::string_view::npos) end = source.size();
+        auto it = found.find(number);
+        if (it != found.end()) {
+            std::string_view text = source.substr(start, end - start);
+            size_t first = text.find_first_not_of(" \t\r");
+            size_t lastChar = text.find_last_not_of(" \t\r");
+            it->second = first == std::string_view::npos ? std::string_view() : text.substr(first, lastChar - first + 1);
+        }
+        if (end == source.size()) break;
+        start = end + 1;
+        number++;
+    }
+}
+}
+
+Profiler::Profiler()
+    : current(0), last(0), startTicks(0), nanosPerTick(0.0) {}
+
+void Profiler::reset(size_t positions) {
+    sites.assign(positions + 1, Site{0, 0});
+    names.assign(positions, nullptr);
+    current = positions;
+}
+
+void Profiler::attach(const ChunkView& chunk) {
+    reset(chunk.codeSize);
+    for (size_t offset = 0; offset < chunk.codeSize;) {
+        OpCode op = static_cast<OpCode>(chunk.code[offset]);
+        names[offset] = opCodeName(op);
+        offset += 1 + operandWidth(op);
+    }
+    lines = chunk.lines ? *chunk.lines : LineTable();
+}
+
+void Profiler::attach(const RegisterChunk& chunk) {
+    reset(chunk.code.size());
+    for (size_t i = 0; i < chunk.code.size(); i++) {
+        names[i] = regOpName(chunk.code[i].op);
+    }
+    lines = chunk.lines;
+}
+
+void Profiler::start() {
+    current = sites.size() - 1;
+    startTime = std::chrono::steady_clock::now();
+    startTicks = ticks();
+    last = startTicks;
+}
+
+void Profiler::stop() {
+    uint64_t now = ticks();
+    auto elapsed = std::chrono::steady_clock::now() - startTime;
+    sites[current].ticks += now - last;
+    current = sites.size() - 1;
+    double nanos = std::chrono::duration<double, std::nano>(elapsed).count();
+    nanosPerTick = now > startTicks ? nanos / static_cast<double>(now - startTicks) : 0.0;
+}
+
+void Profiler::report(std::ostream& out, std::string_view source) const {
+    if (names.empty()) {
+        return;
+    }
+
+    std::map<std::string_view, Total> byOpcode;
+    std::map<int, Total> byLine;
+    Total all;
+    for (size_t position = 0; position < names.size(); position++) {
+        const Site& site = sites[position];
+        if (!names[position] || site.count == 0) continue;
+        Total& op = byOpcode[names[position]];
+        op.count += site.count;
+        op.ticks += site.ticks;
+        Total& line = byLine[lines.lineAt(position)];
+        line.count += site.count;
+        line.ticks += site.ticks;
+        all.count += site.count;
+        all.ticks += site.ticks;
+    }
+
+    auto hotter = [](const auto& a, const auto& b) {
+        return a.second.ticks != b.second.ticks ? a.second.ticks > b.second.ticks : a.first < b.first;
+    };
+    std::vector<std::pair<std::string_view, Total>> opcodes(byOpcode.begin(), byOpcode.end());
+    std::sort(opcodes.begin(), opcodes.end(), hotter);
+    std::vector<std::pair<int, Total>> hotLines(byLine.begin(), byLine.end());
+    std::sort(hotLines.begin(), hotLines.end(), hotter);
+    if (hotLines.size() > kHottestLines) {
+        hotLines.resize(kHottestLines);
+    }
+
+    char heading[128];
+    std::snprintf(heading, sizeof(heading), "profile: %llu instructions in %.3f ms\n\n",
+                  static_cast<unsigned long long>(all.count),
+                  static_cast<double>(all.ticks) * nanosPerTick / 1e6);
+    out << heading;
+    std::snprintf(heading, sizeof(heading), "  %-20s %14s %12s %7s\n", "opcode", "count", "time ms", "time");
+    out << heading;
+    for (const auto& [name, total] : opcodes) {
+        out << formatRow(std::string(name).c_str(), total, nanosPerTick, all.ticks) << "\n";
+    }
+
+    std::map<int, std::string_view> texts;
+    for (const auto& entry : hotLines) {
+        texts.emplace(entry.first, std::string_view());
+    }
+    findLines(source, texts);
+
+    std::snprintf(heading, sizeof(heading), "\n  %-20s %14s %12s %7s\n", "hottest lines", "count", "time ms", "time");
+    out << heading;
+    for (const auto& [line, total] : hotLines) {
+        std::string label = line > 0 ? "line " + std::to_string(line) : "line ?";
+        out << formatRow(label.c_str(), total, nanosPerTick, all.ticks);
+        std::string_view text = texts[line];
+        if (!text.empty()) {
+            out << "  | " << text;
+        }
+        out << "\n";
+    }
+}
@@ -0,0 +1,68 @@
+#include "program.h"
+#include "compiler.h"
+#include "lexer.h"
+#include "mappedfile.h"
+#include "optimizer.h"
+#include "parser.h"
+#include <atomic>
+
+namespace {
+std::atomic<uint64_t> nextSerial{1}; // 0 means no Program in VM
+}
+
+std::vector<StmtPtr> parseSource(std::string_view source, TypeChecker& checker, Arena& arena,
+                                 int optimizationLevel, Stats* stats) {
+    if (stats) {
+        Stats::Phase phase(stats, "lex");
+        Lexer lexer(source);
+        uint64_t tokens = 1; // END_OF_FILE
+        while (lexer.next().type != TokenType::END_OF_FILE) {
+            tokens++;
+        }
+        phase.end("tokens", tokens);
+    }
+
+    Stats::Phase parse(stats, "parse");
+    Lexer lexer(source);
+    Parser parser(lexer, arena);
+    auto ast = parser.parse();
+    parse.end("nodes", parser.nodeCount());
+
+    Stats::Phase check(stats, "check");
+    checker.check(ast);
+    check.end();
+    if (optimizationLevel > 0) {
+        Stats::Phase optimize(stats, "optimize");
+        ast = Optimizer(arena).optimize(ast);
+    }
+    return ast;
+}
+
+Program::Program()
+    : code{}, verification{}, serial(nextSerial.fetch_add(1, std::memory_order_relaxed)) {}
+
+std::shared_ptr<const Program> Program::compile(std::string_view source, int optimizationLevel) {
+    std::shared_ptr<Program> program(new Program());
+    TypeChecker checker;
+    IrSettings ir;
+    ir.enabled = optimizationLevel >= 2;
+    Compiler compiler(ir);
+    Arena arena;
+    program->chunk = compiler.compile(parseSource(source, checker, arena, optimizationLevel));
+    program->code = program->chunk.view();
+    program->verification = verify(program->code);
+    return program;
+}
+
+std::shared_ptr<const Program> Program::load(const std::string& path, int optimizationLevel) {
+    if (!BytecodeFile::hasMagic(path)) {
+        MappedFile source(path);
+        return compile(std::string_view(reinterpret_cast<const char*>(source.data()), source.size()),
+                       optimizationLevel);
+    }
+    std::shared_ptr<Program> program(new Program());
+    program->file = std::make_unique<BytecodeFile>(path);
+    program->code = program->file->view();
+    program->verification = verify(program->code);
+    return program;
+}
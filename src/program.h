@@ -0,0 +1,58 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include "arena.h"
+#include "ast.h"
+#include "bytecode.h"
+#include "bytecodefile.h"
+#include "stats.h"
+#include "typechecker.h"
+#include "verifier.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lexes, parses, type checks and optimizes a source text (at -O1 and
+// above; -O2 also compiles through the IR, see ir.h). The tree lives in
+// `arena` and views into `source`; it must be compiled before either goes
+// away.
+//
+// With `stats`, each step is measured as a phase. Lexing runs interleaved
+// with parsing, so the "lex" phase lexes the source once more on its own
+// to count the tokens, and "parse" includes lexing.
+std::vector<StmtPtr> parseSource(std::string_view source, TypeChecker& checker, Arena& arena,
+                                 int optimizationLevel, Stats* stats = nullptr);
+
+// A compiled stack-machine program for embedding: built once, never
+// modified afterwards, and run by any number of VMs, on any number of
+// threads, through VM::loadProgram(const Program&). A VM that runs the
+// same Program again reuses its interned constants and JIT code.
+//
+// Errors in the source or the file, including code that fails verify()
+// (verifier.h), throw std::runtime_error.
+class Program {
+private:
+    Chunk chunk;                       // compiled from source...
+    std::unique_ptr<BytecodeFile> file; // ...or mapped from a .meowc
+    ChunkView code;
+    VerifiedCode verification; // verify(code), for a fresh VM
+    uint64_t serial; // unique per Program, never reused
+
+    Program();
+
+public:
+    static std::shared_ptr<const Program> compile(std::string_view source, int optimizationLevel = 1);
+    // A .meowc file is mapped, anything else compiled as source.
+    static std::shared_ptr<const Program> load(const std::string& path, int optimizationLevel = 1);
+
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    const ChunkView& view() const { return code; }
+    const VerifiedCode& verified() const { return verification; }
+    uint64_t id() const { return serial; }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "regbytecode.h"
+#include <sstream>
+
+const char* regOpName(RegOp op) {
+    switch (op) {
+        case RegOp::MOVE: return "MOVE";
+        case RegOp::LOADK: return "LOADK";
+        case RegOp::ADD_I64: return "ADD_I64";
+        case RegOp::SUB_I64: return "SUB_I64";
+        case RegOp::MUL_I64: return "MUL_I64";
+        case RegOp::DIV_I64: return "DIV_I64";
+        case RegOp::MOD_I64: return "MOD_I64";
+        case RegOp::NEG_I64: return "NEG_I64";
+        case RegOp::ADD_F64: return "ADD_F64";
+        case RegOp::SUB_F64: return "SUB_F64";
+        case RegOp::MUL_F64: return "MUL_F64";
+        case RegOp::DIV_F64: return "DIV_F64";
+        case RegOp::MOD_F64: return "MOD_F64";
+        case RegOp::NEG_F64: return "NEG_F64";
+        case RegOp::I64_TO_F64: return "I64_TO_F64";
+        case RegOp::NOT: return "NOT";
+        case RegOp::EQ_I64: return "EQ_I64";
+        case RegOp::NE_I64: return "NE_I64";
+        case RegOp::LESS_I64: return "LESS_I64";
+        case RegOp::LESS_EQUAL_I64: return "LESS_EQUAL_I64";
+        case RegOp::GREATER_I64: return "GREATER_I64";
+        case RegOp::GREATER_EQUAL_I64: return "GREATER_EQUAL_I64";
+        case RegOp::EQ_F64: return "EQ_F64";
+        case RegOp::NE_F64: return "NE_F64";
+        case RegOp::LESS_F64: return "LESS_F64";
+        case RegOp::LESS_EQUAL_F64: return "LESS_EQUAL_F64";
+        case RegOp::GREATER_F64: return "GREATER_F64";
+        case RegOp::GREATER_EQUAL_F64: return "GREATER_EQUAL_F64";
+        case RegOp::ADD_STR: return "ADD_STR";
+        case RegOp::EQ_STR: return "EQ_STR";
+        case RegOp::NE_STR: return "NE_STR";
+        case RegOp::LESS_STR: return "LESS_STR";
+        case RegOp::LESS_EQUAL_STR: return "LESS_EQUAL_STR";
+        case RegOp::GREATER_STR: return "GREATER_STR";
+        case RegOp::GREATER_EQUAL_STR: return "GREATER_EQUAL_STR";
+        case RegOp::EQUAL: return "EQUAL";
+        case RegOp::NOT_EQUAL: return "NOT_EQUAL";
+        case RegOp::LESS: return "LESS";
+        case RegOp::LESS_EQUAL: return "LESS_EQUAL";
+        case RegOp::GREATER: return "GREATER";
+        case RegOp::GREATER_EQUAL: return "GREATER_EQUAL";
+        case RegOp::AND: return "AND";
+        case RegOp::OR: return "OR";
+        case RegOp::PRINT: return "PRINT";
+        case RegOp::JUMP: return "JUMP";
+        case RegOp::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case RegOp::HALT: return "HALT";
+    }
+    return "UNKNOWN";
+}
+
+std::string disassemble(const RegisterChunk& chunk) {
+    std::ostringstream out;
+    for (size_t i = 0; i < chunk.code.size(); i++) {
+        const RegInstr& in = chunk.code[i];
+        out << i << "\t" << regOpName(in.op);
+        switch (in.op) {
+            case RegOp::MOVE:
+            case RegOp::NEG_I64:
+            case RegOp::NEG_F64:
+            case RegOp::I64_TO_F64:
+            case RegOp::NOT:
+                out << " r" << in.a << ", r" << in.b;
+                break;
+            case RegOp::LOADK:
+                out << " r" << in.a << ", k" << in.bc() << "\t; " << describeConstant(chunk, in.bc());
+                break;
+            case RegOp::PRINT:
+                out << " r" << in.a;
+                break;
+            case RegOp::JUMP:
+                out << " " << in.bc();
+                break;
+            case RegOp::JUMP_IF_FALSE:
+                out << " r" << in.a << ", " << in.bc();
+                break;
+            case RegOp::HALT:
+                break;
+            default:
+                out << " r" << in.a << ", r" << in.b << ", r" << in.c;
+                break;
+        }
+        out << "\n";
+    }
+    return out.str();
+}
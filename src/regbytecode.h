@@ -0,0 +1,111 @@
+#ifndef REGBYTECODE_H
+#define REGBYTECODE_H
+
+#include "bytecode.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Three-address instruction set for the register backend. Registers
+// [0, slotCount) are the program's variables, so `c = a + b` compiles to
+// a single `ADD r_c, r_a, r_b`; higher registers hold temporaries.
+enum class RegOp : uint8_t {
+    MOVE,          // a = b
+    LOADK,         // a = constants[bc]
+
+    // Typed like the stack opcodes, see bytecode.h.
+    ADD_I64,       // a = b + c
+    SUB_I64,
+    MUL_I64,
+    DIV_I64,
+    MOD_I64,
+    NEG_I64,       // a = -b
+
+    ADD_F64,
+    SUB_F64,
+    MUL_F64,
+    DIV_F64,
+    MOD_F64,
+    NEG_F64,
+
+    I64_TO_F64,    // a = deci(b)
+
+    NOT,           // a = !b
+
+    EQ_I64,        // a = b == c
+    NE_I64,
+    LESS_I64,
+    LESS_EQUAL_I64,
+    GREATER_I64,
+    GREATER_EQUAL_I64,
+
+    EQ_F64,
+    NE_F64,
+    LESS_F64,
+    LESS_EQUAL_F64,
+    GREATER_F64,
+    GREATER_EQUAL_F64,
+
+    ADD_STR,
+    EQ_STR,
+    NE_STR,
+    LESS_STR,
+    LESS_EQUAL_STR,
+    GREATER_STR,
+    GREATER_EQUAL_STR,
+
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+
+    AND,
+    OR,
+
+    PRINT,         // print a
+
+    JUMP,          // goto bc
+    JUMP_IF_FALSE, // if (!a) goto bc
+
+    HALT
+};
+
+constexpr int kRegOpCount = static_cast<int>(RegOp::HALT) + 1;
+
+const char* regOpName(RegOp op);
+
+struct RegInstr {
+    RegOp op;
+    uint16_t a;
+    uint16_t b;
+    uint16_t c;
+
+    // LOADK and the jumps use b:c as one 32-bit operand.
+    uint32_t bc() const { return static_cast<uint32_t>(b) | (static_cast<uint32_t>(c) << 16); }
+
+    static RegInstr make(RegOp op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0) {
+        RegInstr in;
+        in.op = op;
+        in.a = a;
+        in.b = b;
+        in.c = c;
+        return in;
+    }
+
+    static RegInstr makeWide(RegOp op, uint16_t a, uint32_t bc) {
+        return make(op, a, static_cast<uint16_t>(bc & 0xFFFF), static_cast<uint16_t>(bc >> 16));
+    }
+};
+
+struct RegisterChunk : ConstantPool {
+    std::vector<RegInstr> code;
+    uint32_t slotCount = 0;     // registers that hold variables
+    uint32_t registerCount = 0; // variables plus temporaries
+    LineTable lines;            // by instruction index
+};
+
+std::string disassemble(const RegisterChunk& chunk);
+
+#endif
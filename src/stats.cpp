@@ -0,0 +1,150 @@
+#include "stats.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+std::atomic<bool> AllocationCounter::enabled{false};
+std::atomic<uint64_t> AllocationCounter::count{0};
+std::atomic<uint64_t> AllocationCounter::bytes{0};
+
+namespace {
+// Enough for every phase of a run, so that begin() does not allocate.
+const size_t kExpectedPhases = 16;
+
+double megabytes(uint64_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+}
+
+uint64_t peakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#endif
+}
+
+Stats::Stats() : open(false), startAllocations(0), startBytes(0) {
+    records.reserve(kExpectedPhases);
+    AllocationCounter::enabled.store(true, std::memory_order_relaxed);
+}
+
+Stats::~Stats() {
+    AllocationCounter::enabled.store(false, std::memory_order_relaxed);
+}
+
+void Stats::begin(const char* name) {
+    end();
+    Record record = {};
+    record.name = name;
+    records.push_back(record);
+    open = true;
+    startAllocations = AllocationCounter::count.load(std::memory_order_relaxed);
+    startBytes = AllocationCounter::bytes.load(std::memory_order_relaxed);
+    startTime = std::chrono::steady_clock::now();
+}
+
+void Stats::end() {
+    if (!open) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    Record& record = records.back();
+    record.milliseconds = std::chrono::duration<double, std::milli>(now - startTime).count();
+    record.allocations = AllocationCounter::count.load(std::memory_order_relaxed) - startAllocations;
+    record.allocatedBytes = AllocationCounter::bytes.load(std::memory_order_relaxed) - startBytes;
+    record.peakRssBytes = peakResidentBytes();
+    open = false;
+}
+
+void Stats::count(const char* name, uint64_t value) {
+    Record& record = records.back();
+    if (record.countCount < kMaxCounts) {
+        record.counts[record.countCount++] = Count{name, value};
+    }
+}
+
+Stats::Phase::Phase(Stats* s, const char* name) : stats(s) {
+    if (stats) {
+        stats->begin(name);
+    }
+}
+
+Stats::Phase::~Phase() {
+    if (stats) {
+        stats->end();
+    }
+}
+
+void Stats::Phase::end(const char* what, uint64_t value) {
+    if (!stats) {
+        return;
+    }
+    stats->end();
+    if (what) {
+        stats->count(what, value);
+    }
+    stats = nullptr;
+}
+
+void Stats::report(std::ostream& out, bool json) const {
+    char line[256];
+    if (json) {
+        out << "{\n  \"phases\": [";
+        for (size_t i = 0; i < records.size(); i++) {
+            const Record& record = records[i];
+            std::snprintf(line, sizeof(line),
+                          "%s\n    {\"name\": \"%s\", \"ms\": %.4f, \"allocations\": %llu, "
+                          "\"allocated_bytes\": %llu, \"peak_rss_bytes\": %llu",
+                          i ? "," : "", record.name, record.milliseconds,
+                          static_cast<unsigned long long>(record.allocations),
+                          static_cast<unsigned long long>(record.allocatedBytes),
+                          static_cast<unsigned long long>(record.peakRssBytes));
+            out << line;
+            for (size_t j = 0; j < record.countCount; j++) {
+                std::snprintf(line, sizeof(line), ", \"%s\": %llu", record.counts[j].name,
+                              static_cast<unsigned long long>(record.counts[j].value));
+                out << line;
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+        return;
+    }
+
+    double total = 0;
+    for (const Record& record : records) {
+        total += record.milliseconds;
+    }
+    std::snprintf(line, sizeof(line), "stats: %zu phases in %.3f ms\n\n  %-10s %10s %12s %14s %12s\n",
+                  records.size(), total, "phase", "time ms", "allocations", "allocated MB", "peak RSS MB");
+    out << line;
+    for (const Record& record : records) {
+        std::snprintf(line, sizeof(line), "  %-10s %10.3f %12llu %14.3f %12.1f", record.name, record.milliseconds,
+                      static_cast<unsigned long long>(record.allocations), megabytes(record.allocatedBytes),
+                      megabytes(record.peakRssBytes));
+        out << line;
+        for (size_t j = 0; j < record.countCount; j++) {
+            out << (j ? ", " : "  ") << record.counts[j].name << " " << record.counts[j].value;
+        }
+        out << "\n";
+    }
+}
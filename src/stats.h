@@ -0,0 +1,94 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Heap allocations made through the global operator new while `enabled`.
+// The counting operators live in allocationhook.cpp, which only the meow
+// executable links in; libmeow and the benchmarks keep the host's
+// allocator, and the counts stay at zero there.
+struct AllocationCounter {
+    static std::atomic<bool> enabled;
+    static std::atomic<uint64_t> count;
+    static std::atomic<uint64_t> bytes;
+
+    static void record(size_t size) {
+        if (enabled.load(std::memory_order_relaxed)) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Resource use behind `meow --stats`: for each phase of a run, its wall
+// time, the heap allocations made during it, the peak resident set size
+// of the process at its end, and counts of what it produced (tokens, AST
+// nodes, instructions, stack depth).
+//
+// Counting allocations is process-wide, so one Stats should be measuring
+// at a time, and nothing else should allocate on other threads meanwhile.
+class Stats {
+private:
+    static constexpr size_t kMaxCounts = 2;
+
+    struct Count {
+        const char* name;
+        uint64_t value;
+    };
+
+    struct Record {
+        const char* name;
+        double milliseconds;
+        uint64_t allocations;
+        uint64_t allocatedBytes;
+        uint64_t peakRssBytes; // 0 where the platform does not report it
+        Count counts[kMaxCounts];
+        size_t countCount;
+    };
+
+    std::vector<Record> records;
+    bool open; // the last record is still being measured
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t startAllocations;
+    uint64_t startBytes;
+
+    void begin(const char* name);
+    void end();
+    void count(const char* name, uint64_t value);
+
+public:
+    // Measures one phase from construction to end(), or to destruction if
+    // it ends early through an exception. Does nothing for a null Stats.
+    class Phase {
+    private:
+        Stats* stats;
+
+    public:
+        Phase(Stats* s, const char* name);
+        ~Phase();
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+        // Ends the phase, recording what it produced, if anything.
+        void end(const char* what = nullptr, uint64_t value = 0);
+    };
+
+    // Counts allocations until destroyed.
+    Stats();
+    ~Stats();
+    Stats(const Stats&) = delete;
+    Stats& operator=(const Stats&) = delete;
+
+    // A table, or with `json` one object with a "phases" array.
+    void report(std::ostream& out, bool json) const;
+};
+
+// The process's peak resident set size in bytes, or 0 where unknown.
+uint64_t peakResidentBytes();
+
+#endif
@@ -0,0 +1,139 @@
+#include "stringheap.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+// Collections run after this many bytes, or after as many bytes as the
+// last one kept alive if that is more.
+const size_t kCollectionFloor = 1024 * 1024;
+}
+
+StringHeap::StringHeap()
+    : allocated(0), nextCollection(kCollectionFloor) {}
+
+Value StringHeap::makeHeap(uint32_t handle, size_t length) {
+    Value value;
+    value.type = ValueType::STRING;
+    value.inlineLength = kHeapString;
+    value.as.str = StringRef{handle, static_cast<uint32_t>(length)};
+    return value;
+}
+
+Value StringHeap::makeInline(std::string_view first, std::string_view second) {
+    Value value;
+    value.type = ValueType::STRING;
+    value.inlineLength = static_cast<uint8_t>(first.size() + second.size());
+    std::memcpy(value.as.chars, first.data(), first.size());
+    std::memcpy(value.as.chars + first.size(), second.data(), second.size());
+    return value;
+}
+
+uint32_t StringHeap::allocate() {
+    if (!freeBuffers.empty()) {
+        uint32_t handle = freeBuffers.back();
+        freeBuffers.pop_back();
+        buffers[handle].used = true;
+        return handle;
+    }
+    if (buffers.size() > UINT32_MAX) {
+        throw std::runtime_error("Too many strings");
+    }
+    buffers.push_back(Buffer{std::string(), 0, false, true});
+    return static_cast<uint32_t>(buffers.size() - 1);
+}
+
+Value StringHeap::intern(std::string_view text) {
+    if (text.size() <= kInlineString) {
+        return makeInline(text, "");
+    }
+    if (text.size() > UINT32_MAX) {
+        throw std::runtime_error("String too long");
+    }
+    std::string key(text);
+    auto it = internIndex.find(key);
+    if (it != internIndex.end()) {
+        return makeHeap(it->second, text.size());
+    }
+    uint32_t handle = allocate();
+    buffers[handle].text = key;
+    buffers[handle].interned = true;
+    internIndex.emplace(std::move(key), handle);
+    return makeHeap(handle, text.size());
+}
+
+Value StringHeap::concat(const Value& a, const Value& b) {
+    std::string_view left = view(a);
+    std::string_view right = view(b);
+    size_t length = left.size() + right.size();
+    if (length <= kInlineString) {
+        return makeInline(left, right);
+    }
+    if (length > UINT32_MAX) {
+        throw std::runtime_error("String too long");
+    }
+    allocated += right.size();
+
+    if (a.inlineLength == kHeapString) {
+        uint32_t handle = a.as.str.handle;
+        Buffer& buffer = buffers[handle];
+        if (!buffer.interned && buffer.text.size() == left.size()) {
+            // `a` is the longest value over its buffer, so nothing can see
+            // the bytes appended after it. `b` may share the buffer, which
+            // append(str, pos, n) allows.
+            if (b.inlineLength == kHeapString && b.as.str.handle == handle) {
+                buffer.text.append(buffer.text, 0, right.size());
+            } else {
+                buffer.text.append(right);
+            }
+            return makeHeap(handle, length);
+        }
+    }
+
+    allocated += left.size();
+    uint32_t handle = allocate();
+    std::string& text = buffers[handle].text;
+    text.reserve(length);
+    text.append(view(a)).append(view(b));
+    return makeHeap(handle, length);
+}
+
+// Two heap strings of the same length over different buffers.
+bool StringHeap::equalBuffers(const Value& a, const Value& b) const {
+    if (buffers[a.as.str.handle].interned && buffers[b.as.str.handle].interned) {
+        return false;
+    }
+    return std::memcmp(view(a).data(), view(b).data(), a.as.str.length) == 0;
+}
+
+int StringHeap::compare(const Value& a, const Value& b) const {
+    return view(a).compare(view(b));
+}
+
+void StringHeap::beginCollection() {
+    for (auto& buffer : buffers) {
+        buffer.liveLength = 0;
+    }
+}
+
+void StringHeap::sweep() {
+    size_t live = 0;
+    for (uint32_t handle = 0; handle < buffers.size(); handle++) {
+        Buffer& buffer = buffers[handle];
+        if (!buffer.used || buffer.interned) {
+            live += buffer.text.size();
+            continue;
+        }
+        if (buffer.liveLength == 0) {
+            std::string().swap(buffer.text);
+            buffer.used = false;
+            freeBuffers.push_back(handle);
+            continue;
+        }
+        // Dropping bytes only dead values could see lets the longest
+        // remaining value append in place again.
+        buffer.text.resize(buffer.liveLength);
+        live += buffer.text.size();
+    }
+    allocated = 0;
+    nextCollection = std::max(kCollectionFloor, live);
+}
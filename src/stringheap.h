@@ -0,0 +1,89 @@
+#ifndef STRINGHEAP_H
+#define STRINGHEAP_H
+
+#include "value.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Storage behind the VM's STRING values.
+//
+// Strings of up to kInlineString bytes are kept inside the Value. Longer
+// ones live in buffers here and a value names a buffer and a length: it is
+// always the first `length` bytes of its buffer. Values can therefore share
+// a buffer, and `s = s + t` appends to the buffer in place when `s` is the
+// longest value over it, so building a string in a loop costs amortized
+// O(appended bytes) like std::string::append.
+//
+// Literals are interned when a program is loaded into buffers that are
+// never appended to, so two interned strings are equal exactly when their
+// handles are. Values carry no reference counts; buffers that no value
+// refers to any more are reclaimed by a collection whose roots the VM
+// marks (see beginCollection).
+class StringHeap {
+private:
+    struct Buffer {
+        std::string text;
+        uint32_t liveLength; // longest marked value during a collection
+        bool interned;
+        bool used;
+    };
+
+    std::vector<Buffer> buffers;
+    std::vector<uint32_t> freeBuffers;
+    std::unordered_map<std::string, uint32_t> internIndex;
+
+    size_t allocated;    // bytes appended to buffers since the last collection
+    size_t nextCollection;
+
+    uint32_t allocate();
+    static Value makeHeap(uint32_t handle, size_t length);
+    static Value makeInline(std::string_view first, std::string_view second);
+    bool equalBuffers(const Value& a, const Value& b) const;
+
+public:
+    StringHeap();
+
+    Value intern(std::string_view text);
+    Value concat(const Value& a, const Value& b);
+
+    // The bytes of a STRING value. For an inline string this points into
+    // `value` itself.
+    std::string_view view(const Value& value) const {
+        if (value.inlineLength != kHeapString) {
+            return std::string_view(value.as.chars, value.inlineLength);
+        }
+        return std::string_view(buffers[value.as.str.handle].text.data(), value.as.str.length);
+    }
+
+    bool equal(const Value& a, const Value& b) const {
+        // Strings are inline exactly when they are short, and inline bytes
+        // are zero padded.
+        if (a.inlineLength != b.inlineLength) return false;
+        if (a.inlineLength != kHeapString) return a.as.i == b.as.i;
+        if (a.as.str.length != b.as.str.length) return false;
+        if (a.as.str.handle == b.as.str.handle) return true;
+        return equalBuffers(a, b);
+    }
+
+    int compare(const Value& a, const Value& b) const;
+
+    // Collection: once shouldCollect(), call beginCollection(), mark()
+    // every value that is still reachable, then sweep(). Interned buffers
+    // are never reclaimed, so constants need not be marked.
+    bool shouldCollect() const { return allocated >= nextCollection; }
+    void beginCollection();
+    void mark(const Value& value) {
+        if (value.type == ValueType::STRING && value.inlineLength == kHeapString) {
+            Buffer& buffer = buffers[value.as.str.handle];
+            if (value.as.str.length > buffer.liveLength) buffer.liveLength = value.as.str.length;
+        }
+    }
+    void sweep();
+};
+
+#endif
@@ -1,9 +1,10 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-#include <string>
+#include <cstdint>
+#include <string_view>
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Keywords
     MEOW,
     INT,
@@ -42,13 +43,16 @@ enum class TokenType {
     UNKNOWN
 };
 
+// A token is a view of its spelling in the source it was lexed from:
+// `length` bytes at `offset`. For string and char literals that is the
+// text between the quotes. The source must outlive the tokens.
 struct Token {
     TokenType type;
-    std::string value;
+    uint32_t offset;
+    uint32_t length;
     int line;
 
-    Token(TokenType t, std::string v, int l)
-        : type(t), value(v), line(l) {}
+    std::string_view text(std::string_view source) const { return source.substr(offset, length); }
 };
 
 #endif
@@ -0,0 +1,189 @@
+#include "typechecker.h"
+#include <stdexcept>
+
+namespace {
+[[noreturn]] void typeError(int line, const std::string& message) {
+    throw std::runtime_error(message + " at line " + std::to_string(line));
+}
+
+bool isNumeric(ValueType type) {
+    return type == ValueType::INT || type == ValueType::DECI;
+}
+}
+
+TypeChecker::TypeChecker()
+    : scopes(1) {}
+
+void TypeChecker::check(const std::vector<StmtPtr>& statements) {
+    // A rejected program must not leave its declarations behind.
+    scopes.resize(1);
+    auto globals = scopes[0];
+    try {
+        for (const auto& stmt : statements) {
+            checkStatement(stmt);
+        }
+    } catch (...) {
+        scopes.resize(1);
+        scopes[0] = std::move(globals);
+        throw;
+    }
+}
+
+ValueType TypeChecker::resolve(const VariableExpr& variable) const {
+    std::string name(variable.name);
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto it = scope->find(name);
+        if (it != scope->end()) {
+            return it->second;
+        }
+    }
+    typeError(variable.line, "Undefined variable: " + name);
+}
+
+
+// ================= STATEMENTS =================
+
+void TypeChecker::checkStatement(StmtPtr stmt) {
+    switch (stmt->kind) {
+        case NodeKind::PRINT:
+            checkExpression(static_cast<PrintStmt*>(stmt)->expression);
+            break;
+        case NodeKind::VAR_DECL: {
+            auto* varDecl = static_cast<VarDeclStmt*>(stmt);
+            if (varDecl->initializer) {
+                ValueType actual = checkExpression(varDecl->initializer);
+                if (!isAssignable(actual, varDecl->type)) {
+                    typeError(varDecl->line, std::string("Cannot initialize ") + typeName(varDecl->type) +
+                              " variable '" + std::string(varDecl->name) + "' with " + typeName(actual));
+                }
+            }
+            scopes.back()[std::string(varDecl->name)] = varDecl->type;
+            break;
+        }
+        case NodeKind::EXPR_STMT:
+            checkExpression(static_cast<ExprStmt*>(stmt)->expression);
+            break;
+        case NodeKind::BLOCK:
+            scopes.emplace_back();
+            for (StmtPtr s : *static_cast<BlockStmt*>(stmt)) {
+                checkStatement(s);
+            }
+            scopes.pop_back();
+            break;
+        case NodeKind::IF: {
+            auto* ifStmt = static_cast<IfStmt*>(stmt);
+            ValueType condition = checkExpression(ifStmt->condition);
+            if (condition != ValueType::BOOL) {
+                typeError(ifStmt->line, std::string("Condition must be bool, not ") + typeName(condition));
+            }
+            checkStatement(ifStmt->thenBranch);
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported statement");
+    }
+}
+
+
+// ================= EXPRESSIONS =================
+
+ValueType TypeChecker::checkExpression(ExprPtr expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL:
+            return expr->type;
+
+        case NodeKind::VARIABLE:
+            expr->type = resolve(*static_cast<VariableExpr*>(expr));
+            return expr->type;
+
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<BinaryExpr*>(expr);
+            std::string symbol = binaryOpSymbol(binary->op);
+
+            if (binary->op == BinaryOp::ASSIGN) {
+                if (binary->left->kind != NodeKind::VARIABLE) {
+                    typeError(binary->line, "Invalid assignment target");
+                }
+                auto* target = static_cast<VariableExpr*>(binary->left);
+                ValueType declared = checkExpression(target);
+                ValueType actual = checkExpression(binary->right);
+                if (!isAssignable(actual, declared)) {
+                    typeError(binary->line, std::string("Cannot assign ") + typeName(actual) + " to " +
+                              typeName(declared) + " variable '" + std::string(target->name) + "'");
+                }
+                binary->type = declared;
+                return declared;
+            }
+
+            ValueType left = checkExpression(binary->left);
+            ValueType right = checkExpression(binary->right);
+            std::string operands = std::string(typeName(left)) + " and " + typeName(right);
+
+            switch (binary->op) {
+                case BinaryOp::ADD:
+                    if (left == ValueType::STRING && right == ValueType::STRING) {
+                        binary->type = ValueType::STRING;
+                        return binary->type;
+                    }
+                    if (left == ValueType::STRING || right == ValueType::STRING) {
+                        typeError(binary->line, "Operator '+' needs numbers or two strings, not " + operands);
+                    }
+                    [[fallthrough]];
+                case BinaryOp::SUB:
+                case BinaryOp::MUL:
+                case BinaryOp::DIV:
+                case BinaryOp::MOD:
+                    if (!isNumeric(left) || !isNumeric(right)) {
+                        typeError(binary->line, "Operator '" + symbol + "' needs numbers, not " + operands);
+                    }
+                    binary->type = left == ValueType::INT && right == ValueType::INT ? ValueType::INT : ValueType::DECI;
+                    return binary->type;
+                case BinaryOp::EQUAL:
+                case BinaryOp::NOT_EQUAL:
+                    if (left != right && !(isNumeric(left) && isNumeric(right))) {
+                        typeError(binary->line, "Cannot compare " + operands);
+                    }
+                    break;
+                case BinaryOp::LESS:
+                case BinaryOp::LESS_EQUAL:
+                case BinaryOp::GREATER:
+                case BinaryOp::GREATER_EQUAL:
+                    if (!(isNumeric(left) && isNumeric(right)) &&
+                        !(left == right && (left == ValueType::CHAR || left == ValueType::STRING))) {
+                        typeError(binary->line, "Operator '" + symbol + "' cannot order " + operands);
+                    }
+                    break;
+                case BinaryOp::AND:
+                case BinaryOp::OR:
+                    if (left != ValueType::BOOL || right != ValueType::BOOL) {
+                        typeError(binary->line, "Operator '" + symbol + "' needs bools, not " + operands);
+                    }
+                    break;
+                case BinaryOp::ASSIGN:
+                    break;
+            }
+            binary->type = ValueType::BOOL;
+            return binary->type;
+        }
+
+        case NodeKind::UNARY: {
+            auto* unary = static_cast<UnaryExpr*>(expr);
+            ValueType operand = checkExpression(unary->right);
+            if (unary->op == UnaryOp::NEGATE) {
+                if (!isNumeric(operand)) {
+                    typeError(unary->line, std::string("Cannot negate ") + typeName(operand));
+                }
+                unary->type = operand;
+            } else {
+                if (operand != ValueType::BOOL) {
+                    typeError(unary->line, std::string("Operator '!' needs bool, not ") + typeName(operand));
+                }
+                unary->type = ValueType::BOOL;
+            }
+            return unary->type;
+        }
+
+        default:
+            throw std::runtime_error("Unsupported expression");
+    }
+}
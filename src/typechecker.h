@@ -0,0 +1,45 @@
+#ifndef TYPECHECKER_H
+#define TYPECHECKER_H
+
+#include "ast.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Checks a program against the declared types and records the static type
+// of every expression in Expression::type, which the Compiler uses to pick
+// type-specialized opcodes. Runs before the Optimizer so that type errors
+// do not depend on the optimization level.
+//
+// Rules: arithmetic takes numbers (int op int is int, otherwise deci), and
+// + also concatenates two strings;
+// == and != take two numbers or two values of the same type; ordering
+// takes two numbers, two chars or two strings; !, &&, || and `if`
+// conditions take bools. An int is accepted wherever a deci is expected.
+//
+// Errors throw std::runtime_error naming the source line.
+class TypeChecker {
+private:
+    // scopes[0] holds the globals and survives across check() calls, like
+    // the Compiler's, so REPL lines see earlier declarations.
+    std::vector<std::unordered_map<std::string, ValueType>> scopes;
+
+    void checkStatement(StmtPtr stmt);
+    ValueType checkExpression(ExprPtr expr);
+    ValueType resolve(const VariableExpr& variable) const;
+
+public:
+    TypeChecker();
+    void check(const std::vector<StmtPtr>& statements);
+
+    // Global variables by name, as saved and restored by heap images.
+    const std::unordered_map<std::string, ValueType>& globals() const { return scopes[0]; }
+    void declareGlobal(const std::string& name, ValueType type) { scopes[0][name] = type; }
+};
+
+// Whether a value of type `from` may be stored where `to` is expected.
+inline bool isAssignable(ValueType from, ValueType to) {
+    return from == to || (from == ValueType::INT && to == ValueType::DECI);
+}
+
+#endif
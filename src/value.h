@@ -0,0 +1,69 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <cstdint>
+
+enum class ValueType : uint8_t {
+    INT,
+    DECI,
+    BOOL,
+    CHAR,
+    STRING
+};
+
+// Where a STRING value's bytes are: inside the Value, or a prefix of a
+// buffer in the VM's StringHeap (see stringheap.h).
+struct StringRef {
+    uint32_t handle;
+    uint32_t length;
+};
+
+constexpr uint8_t kInlineString = 8;   // longest string stored in the Value
+constexpr uint8_t kHeapString = 0xFF;  // Value::inlineLength of a heap string
+constexpr uint8_t kHeapInt = 0xFF;     // Value::inlineLength of a BigInt (bigint.h)
+
+// A runtime value, trivially copyable and 16 bytes wide. In a constant
+// pool a STRING's `as.s` indexes the pool's strings; in the VM it is
+// either inline (`inlineLength` bytes of `as.chars`, the rest zero) or
+// `as.str` into the string heap. An INT is `as.i` unless it does not fit
+// in 64 bits, when it is `as.big` into the VM's BigIntHeap; in a constant
+// pool such an INT's `as.s` indexes its decimal text in the strings.
+struct Value {
+    ValueType type;
+    uint8_t inlineLength;
+    union {
+        int64_t i;
+        double d;
+        bool b;
+        char c;
+        uint32_t s;
+        StringRef str;
+        uint32_t big;
+        char chars[kInlineString];
+    } as;
+
+    Value() : type(ValueType::INT), inlineLength(0) { as.i = 0; }
+
+    static Value makeInt(int64_t v) { Value r; r.type = ValueType::INT; r.as.i = v; return r; }
+    static Value makeDeci(double v) { Value r; r.type = ValueType::DECI; r.as.d = v; return r; }
+    static Value makeBool(bool v) { Value r; r.type = ValueType::BOOL; r.as.b = v; return r; }
+    static Value makeChar(char v) { Value r; r.type = ValueType::CHAR; r.as.c = v; return r; }
+    static Value makeString(uint32_t index) { Value r; r.type = ValueType::STRING; r.as.s = index; return r; }
+
+    bool isNumber() const { return type == ValueType::INT || type == ValueType::DECI; }
+    double asNumber() const { return type == ValueType::INT ? static_cast<double>(as.i) : as.d; }
+};
+
+// The source-level name of a type, as written in declarations.
+inline const char* typeName(ValueType type) {
+    switch (type) {
+        case ValueType::INT: return "int";
+        case ValueType::DECI: return "deci";
+        case ValueType::BOOL: return "bool";
+        case ValueType::CHAR: return "char";
+        case ValueType::STRING: return "string";
+    }
+    return "?";
+}
+
+#endif
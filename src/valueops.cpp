@@ -0,0 +1,138 @@
+#include "valueops.h"
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <system_error>
+
+bool divideInt(int64_t a, int64_t b, int64_t& result) {
+    if (b == 0) {
+        throw std::runtime_error("Division by zero");
+    }
+    if (b == -1) {
+        return negateInt(a, result);
+    }
+    result = a / b;
+    return true;
+}
+
+int64_t moduloInt(int64_t a, int64_t b) {
+    if (b == 0) {
+        throw std::runtime_error("Division by zero");
+    }
+    return b == -1 ? 0 : a % b;
+}
+
+double moduloDeci(double a, double b) {
+    return std::fmod(a, b);
+}
+
+bool arithmetic(ArithOp op, const Value& a, const Value& b, Value& result) {
+    if (!a.isNumber() || !b.isNumber()) {
+        throw std::runtime_error("Operands must be numbers");
+    }
+
+    if (a.type == ValueType::INT && b.type == ValueType::INT) {
+        int64_t i = 0;
+        bool fits = true;
+        switch (op) {
+            case ArithOp::ADD: fits = addInt(a.as.i, b.as.i, i); break;
+            case ArithOp::SUB: fits = subtractInt(a.as.i, b.as.i, i); break;
+            case ArithOp::MUL: fits = multiplyInt(a.as.i, b.as.i, i); break;
+            case ArithOp::DIV: fits = divideInt(a.as.i, b.as.i, i); break;
+            case ArithOp::MOD: i = moduloInt(a.as.i, b.as.i); break;
+        }
+        result = Value::makeInt(i);
+        return fits;
+    }
+
+    double x = a.asNumber();
+    double y = b.asNumber();
+    switch (op) {
+        case ArithOp::ADD: result = Value::makeDeci(x + y); return true;
+        case ArithOp::SUB: result = Value::makeDeci(x - y); return true;
+        case ArithOp::MUL: result = Value::makeDeci(x * y); return true;
+        case ArithOp::DIV: result = Value::makeDeci(x / y); return true;
+        case ArithOp::MOD: result = Value::makeDeci(moduloDeci(x, y)); return true;
+    }
+    throw std::runtime_error("Unknown arithmetic operation");
+}
+
+bool negate(const Value& a, Value& result) {
+    if (a.type == ValueType::INT) {
+        int64_t i = 0;
+        bool fits = negateInt(a.as.i, i);
+        result = Value::makeInt(i);
+        return fits;
+    }
+    if (a.type == ValueType::DECI) {
+        result = Value::makeDeci(-a.as.d);
+        return true;
+    }
+    throw std::runtime_error("Operand must be a number");
+}
+
+bool scalarsEqual(const Value& a, const Value& b) {
+    if (a.isNumber() && b.isNumber()) {
+        if (a.type == ValueType::INT && b.type == ValueType::INT) {
+            return a.as.i == b.as.i;
+        }
+        return a.asNumber() == b.asNumber();
+    }
+    if (a.type != b.type) {
+        return false;
+    }
+    switch (a.type) {
+        case ValueType::BOOL: return a.as.b == b.as.b;
+        case ValueType::CHAR: return a.as.c == b.as.c;
+        default: return false;
+    }
+}
+
+int compareScalars(const Value& a, const Value& b) {
+    if (a.type == ValueType::INT && b.type == ValueType::INT) {
+        return (a.as.i > b.as.i) - (a.as.i < b.as.i);
+    }
+    if (a.isNumber() && b.isNumber()) {
+        double x = a.asNumber();
+        double y = b.asNumber();
+        return (x > y) - (x < y);
+    }
+    if (a.type == ValueType::CHAR && b.type == ValueType::CHAR) {
+        return (a.as.c > b.as.c) - (a.as.c < b.as.c);
+    }
+    throw std::runtime_error("Operands cannot be compared");
+}
+
+Value parseLiteral(ValueType type, std::string_view text) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    std::from_chars_result result{};
+    Value value;
+    switch (type) {
+        case ValueType::INT:
+            value = Value::makeInt(0);
+            result = std::from_chars(first, last, value.as.i);
+            break;
+        case ValueType::DECI:
+            value = Value::makeDeci(0.0);
+            result = std::from_chars(first, last, value.as.d);
+            break;
+        case ValueType::BOOL:
+            return Value::makeBool(text == "true");
+        case ValueType::CHAR:
+            return Value::makeChar(text.empty() ? '\0' : text[0]);
+        case ValueType::STRING:
+            throw std::runtime_error("String literals have no scalar value");
+    }
+    if (result.ec == std::errc::result_out_of_range && type == ValueType::INT) {
+        value.inlineLength = kHeapInt;
+        return value;
+    }
+    if (result.ec == std::errc::result_out_of_range) {
+        throw std::runtime_error("Numeric literal out of range: " + std::string(text));
+    }
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("Malformed numeric literal: " + std::string(text));
+    }
+    return value;
+}
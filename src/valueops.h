@@ -0,0 +1,77 @@
+#ifndef VALUEOPS_H
+#define VALUEOPS_H
+
+#include "value.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Operations on Values that do not need a string table. They define the
+// language semantics once for the VM and for compile-time folding, and
+// throw std::runtime_error exactly where the VM reports a runtime error.
+
+// int arithmetic in 64 bits. Each returns false instead of a result that
+// does not fit; the VM then continues with a BigInt (bigint.h).
+inline bool addInt(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_add_overflow(a, b, &result);
+#else
+    if (b > 0 ? a > INT64_MAX - b : a < INT64_MIN - b) return false;
+    result = a + b;
+    return true;
+#endif
+}
+inline bool subtractInt(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_sub_overflow(a, b, &result);
+#else
+    if (b < 0 ? a > INT64_MAX + b : a < INT64_MIN + b) return false;
+    result = a - b;
+    return true;
+#endif
+}
+inline bool multiplyInt(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_mul_overflow(a, b, &result);
+#else
+    int64_t product = static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+    if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN) || (b != 0 && product / b != a)) return false;
+    result = product;
+    return true;
+#endif
+}
+inline bool negateInt(int64_t a, int64_t& result) {
+    if (a == INT64_MIN) return false;
+    result = -a;
+    return true;
+}
+// Truncating; both throw "Division by zero". Only INT64_MIN / -1 does not
+// fit.
+bool divideInt(int64_t a, int64_t b, int64_t& result);
+int64_t moduloInt(int64_t a, int64_t b);
+double moduloDeci(double a, double b);
+
+enum class ArithOp : uint8_t {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD
+};
+
+// int op int stays int, anything involving a deci is computed in double.
+// False when an int result does not fit in 64 bits.
+bool arithmetic(ArithOp op, const Value& a, const Value& b, Value& result);
+bool negate(const Value& a, Value& result);
+
+// Equality and ordering for everything except two strings, which the
+// caller compares by content.
+bool scalarsEqual(const Value& a, const Value& b);
+int compareScalars(const Value& a, const Value& b);
+
+// Parses the text of a non-string literal token into a Value. An int
+// literal that does not fit in 64 bits comes back with inlineLength
+// kHeapInt and no payload; its value is the token text (see LiteralExpr).
+Value parseLiteral(ValueType type, std::string_view text);
+
+#endif
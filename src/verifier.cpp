@@ -0,0 +1,533 @@
+#include "verifier.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+// Positions are byte offsets in stack code and instruction indices in
+// register code.
+const char* const kOffset = "offset";
+const char* const kInstruction = "instruction";
+
+std::runtime_error invalid(const std::string& reason, size_t at, const char* unit = kOffset) {
+    return std::runtime_error("Invalid program: " + reason + " at " + unit + " " + std::to_string(at));
+}
+
+bool isJump(OpCode op) {
+    return op == OpCode::JUMP || op == OpCode::JUMP_IF_FALSE;
+}
+
+uint32_t operandAt(const ChunkView& chunk, size_t offset, OpCode op) {
+    switch (operandWidth(op)) {
+        case 4: return readU32(chunk.code + offset + 1);
+        case 2: return readU16(chunk.code + offset + 1);
+        default: return 0;
+    }
+}
+
+// Whether a constant is a well-formed value of its type: text in the pool
+// for strings and big ints, and a bool that is 0 or 1.
+bool isWellFormed(const ConstantPool& pool, const Value& constant) {
+    if (constant.type == ValueType::STRING || constant.inlineLength == kHeapInt) {
+        return constant.as.s < pool.strings.size();
+    }
+    if (constant.type == ValueType::BOOL) {
+        uint8_t byte;
+        std::memcpy(&byte, &constant.as, sizeof(byte));
+        return byte <= 1;
+    }
+    return true;
+}
+
+// The type both operands of a typed operator must have, and the type of
+// its result. The untyped comparisons (EQUAL to GREATER_EQUAL) are left
+// out: they take two bools or two chars.
+struct Signature {
+    ValueType operands;
+    ValueType result;
+};
+
+Signature signature(OpCode op) {
+    switch (op) {
+        case OpCode::ADD_I64:
+        case OpCode::SUB_I64:
+        case OpCode::MUL_I64:
+        case OpCode::DIV_I64:
+        case OpCode::MOD_I64:
+        case OpCode::NEG_I64:
+            return {ValueType::INT, ValueType::INT};
+        case OpCode::ADD_F64:
+        case OpCode::SUB_F64:
+        case OpCode::MUL_F64:
+        case OpCode::DIV_F64:
+        case OpCode::MOD_F64:
+        case OpCode::NEG_F64:
+            return {ValueType::DECI, ValueType::DECI};
+        case OpCode::I64_TO_F64:
+            return {ValueType::INT, ValueType::DECI};
+        case OpCode::EQ_I64:
+        case OpCode::NE_I64:
+        case OpCode::LESS_I64:
+        case OpCode::LESS_EQUAL_I64:
+        case OpCode::GREATER_I64:
+        case OpCode::GREATER_EQUAL_I64:
+            return {ValueType::INT, ValueType::BOOL};
+        case OpCode::EQ_F64:
+        case OpCode::NE_F64:
+        case OpCode::LESS_F64:
+        case OpCode::LESS_EQUAL_F64:
+        case OpCode::GREATER_F64:
+        case OpCode::GREATER_EQUAL_F64:
+            return {ValueType::DECI, ValueType::BOOL};
+        case OpCode::ADD_STR:
+            return {ValueType::STRING, ValueType::STRING};
+        case OpCode::EQ_STR:
+        case OpCode::NE_STR:
+        case OpCode::LESS_STR:
+        case OpCode::LESS_EQUAL_STR:
+        case OpCode::GREATER_STR:
+        case OpCode::GREATER_EQUAL_STR:
+            return {ValueType::STRING, ValueType::BOOL};
+        default:
+            return {ValueType::BOOL, ValueType::BOOL}; // NOT, AND, OR
+    }
+}
+
+bool isUntypedComparison(OpCode op) {
+    return op >= OpCode::EQUAL && op <= OpCode::GREATER_EQUAL;
+}
+
+// What a path knows about a variable slot or register: the type of its
+// value, with kEntry while that may still be the value it held on entry,
+// or kConflict where paths that meet disagree on the type.
+constexpr uint8_t kEntry = 0x10;
+constexpr uint8_t kConflict = 0xFF;
+
+ValueType typeOf(uint8_t slot) {
+    return static_cast<ValueType>(slot & ~kEntry);
+}
+
+// The types on the stack and in the slots or registers the code uses
+// before an instruction. Register code has no stack.
+struct State {
+    std::vector<ValueType> stack;
+    std::vector<uint8_t> slots; // indexed like `tracked` below
+};
+
+// Paths that are still to be joined may not hold more slot states than
+// this between them; compiled code keeps only a few open at once.
+constexpr size_t kMaxPendingSlots = size_t(64) << 20;
+
+// The states jumps leave at their targets, for a pass over the code in
+// order that carries the state of the path falling through. Where paths
+// meet the stack must agree; a slot whose types disagree is unusable
+// until it is stored again. Compiled code only jumps forward, so a
+// target's state is complete when the pass gets there; a backward jump
+// must arrive with a state its target already allows, which keeps the
+// pass to one.
+class Joins {
+private:
+    std::unordered_map<size_t, State> pending; // by target
+    size_t pendingSlots = 0;
+    std::vector<bool> isTarget;
+    std::vector<bool> isLoopTarget; // of a backward jump
+    const char* unit;
+
+    // Joins `from` into the state at `target`, which a backward jump may
+    // not change.
+    void merge(size_t target, const State& from, size_t at, bool backward) {
+        auto it = pending.find(target);
+        if (it == pending.end()) {
+            if (backward) {
+                throw invalid("backward jump to unreached code", at, unit);
+            }
+            pendingSlots += from.slots.size();
+            if (pendingSlots > kMaxPendingSlots) {
+                throw invalid("too many branches over too many variables", at, unit);
+            }
+            pending.emplace(target, from);
+            return;
+        }
+        State& to = it->second;
+        if (to.stack.size() != from.stack.size()) {
+            throw invalid("inconsistent stack depth", at, unit);
+        }
+        if (to.stack != from.stack) {
+            throw invalid("inconsistent stack types", at, unit);
+        }
+        for (size_t i = 0; i < to.slots.size(); i++) {
+            uint8_t a = to.slots[i];
+            uint8_t b = from.slots[i];
+            uint8_t joined = a == kConflict || b == kConflict ? kConflict
+                           : typeOf(a) == typeOf(b) ? static_cast<uint8_t>(a | b)
+                           : kConflict;
+            if (joined != a && backward) {
+                throw invalid("backward jump changes variable types", at, unit);
+            }
+            to.slots[i] = joined;
+        }
+    }
+
+public:
+    Joins(size_t codeSize, const char* u) : isTarget(codeSize, false), isLoopTarget(codeSize, false), unit(u) {}
+
+    void addJump(size_t at, size_t target) {
+        isTarget[target] = true;
+        if (target <= at) {
+            isLoopTarget[target] = true;
+        }
+    }
+
+    // Joins `from`, the state the jump at `at` leaves with, into the state
+    // at `target`.
+    void join(size_t target, const State& from, size_t at) {
+        merge(target, from, at, target <= at);
+    }
+
+    // Moves the pass to `at`, where `live` says whether the instruction at
+    // `previous` falls through with `state`. At a jump target that path,
+    // which is never a backward one even into the first instruction, is
+    // joined with the others and `state` becomes their join. Returns
+    // whether any path reaches `at`.
+    bool arrive(size_t at, State& state, bool live, size_t previous) {
+        if (!isTarget[at]) {
+            return live;
+        }
+        if (live) {
+            merge(at, state, previous, false);
+        }
+        auto it = pending.find(at);
+        if (it == pending.end()) {
+            return false;
+        }
+        if (isLoopTarget[at]) {
+            state = it->second; // kept for the backward jumps
+        } else {
+            state = std::move(it->second);
+            pendingSlots -= state.slots.size();
+            pending.erase(it);
+        }
+        return true;
+    }
+};
+
+// The type a slot or register holds, which paths must agree on to read it.
+ValueType read(const State& state, uint32_t index, uint32_t number, const char* what, size_t at,
+               const char* unit) {
+    uint8_t slot = state.slots[index];
+    if (slot == kConflict) {
+        throw invalid(std::string(what) + " " + std::to_string(number) + " has different types on different paths",
+                      at, unit);
+    }
+    return typeOf(slot);
+}
+
+void expect(ValueType type, ValueType expected, const char* op, size_t at, const char* unit) {
+    if (type != expected) {
+        throw invalid(std::string(op) + " expects " + typeName(expected) + ", found " + typeName(type), at, unit);
+    }
+}
+
+// The typed register operations are declared in the same order as their
+// stack opcodes.
+OpCode stackOp(RegOp op) {
+    return static_cast<OpCode>(static_cast<int>(op) - static_cast<int>(RegOp::ADD_I64) +
+                               static_cast<int>(OpCode::ADD_I64));
+}
+}
+
+VerifiedCode verify(const ChunkView& chunk, const std::vector<ValueType>& slotTypes) {
+    if (chunk.codeSize > INT32_MAX) {
+        throw std::runtime_error("Invalid program: too large");
+    }
+    if (chunk.slotCount > UINT16_MAX + 1) {
+        throw std::runtime_error("Invalid program: too many variable slots");
+    }
+    VerifiedCode result{std::vector<int32_t>(chunk.codeSize, -1), 0, {}};
+    std::vector<int32_t>& depthAt = result.depthAt;
+
+    // Decoding: every instruction is whole and its operands are in range.
+    // Instruction starts are marked with -2 until a path reaches them, and
+    // the slots the code uses are numbered for the states below.
+    const int32_t kStart = -2;
+    const uint32_t kUnused = UINT32_MAX;
+    std::vector<uint32_t> tracked(chunk.slotCount, kUnused);
+    std::vector<uint32_t> slotOf; // inverse of `tracked`
+    for (size_t offset = 0; offset < chunk.codeSize;) {
+        uint8_t byte = chunk.code[offset];
+        if (byte > static_cast<uint8_t>(OpCode::HALT)) {
+            throw invalid("unknown opcode", offset);
+        }
+        OpCode op = static_cast<OpCode>(byte);
+        size_t length = 1 + operandWidth(op);
+        if (length > chunk.codeSize - offset) {
+            throw invalid("truncated instruction", offset);
+        }
+        uint32_t operand = operandAt(chunk, offset, op);
+        if (op == OpCode::LOAD_CONST && (operand >= chunk.pool->constants.size() ||
+                                         !isWellFormed(*chunk.pool, chunk.pool->constants[operand]))) {
+            throw invalid("bad constant", offset);
+        }
+        if (op == OpCode::LOAD_VAR || op == OpCode::STORE_VAR) {
+            if (operand >= chunk.slotCount) {
+                throw invalid("bad variable slot", offset);
+            }
+            if (tracked[operand] == kUnused) {
+                tracked[operand] = static_cast<uint32_t>(slotOf.size());
+                slotOf.push_back(operand);
+            }
+        }
+        depthAt[offset] = kStart;
+        offset += length;
+    }
+    Joins joins(chunk.codeSize, kOffset);
+    for (size_t offset = 0; offset < chunk.codeSize;) {
+        OpCode op = static_cast<OpCode>(chunk.code[offset]);
+        if (isJump(op)) {
+            uint32_t target = operandAt(chunk, offset, op);
+            if (target >= chunk.codeSize || depthAt[target] != kStart) {
+                throw invalid("bad jump target", offset);
+            }
+            joins.addJump(offset, target);
+        }
+        offset += 1 + operandWidth(op);
+    }
+    if (chunk.codeSize == 0) {
+        throw std::runtime_error("Invalid program: missing HALT");
+    }
+
+    // Types: one pass in code order (see Joins).
+    std::vector<bool> loadsEntry(chunk.slotCount, false);
+    auto pop = [&](State& state, ValueType expected, OpCode op, size_t offset) {
+        ValueType type = state.stack.back();
+        state.stack.pop_back();
+        expect(type, expected, opCodeName(op), offset, kOffset);
+    };
+
+    State state;
+    state.slots.resize(slotOf.size());
+    for (size_t i = 0; i < slotOf.size(); i++) {
+        // Slots a VM has not used yet hold int 0.
+        ValueType type = slotOf[i] < slotTypes.size() ? slotTypes[slotOf[i]] : ValueType::INT;
+        state.slots[i] = static_cast<uint8_t>(kEntry | static_cast<uint8_t>(type));
+    }
+    bool live = true;    // whether the previous instruction falls through
+    size_t previous = 0; // and where it starts
+    for (size_t offset = 0; offset < chunk.codeSize;) {
+        OpCode op = static_cast<OpCode>(chunk.code[offset]);
+        uint32_t operand = operandAt(chunk, offset, op);
+        size_t next = offset + 1 + operandWidth(op);
+        live = joins.arrive(offset, state, live, previous);
+        if (!live) {
+            depthAt[offset] = -1;
+            offset = next;
+            continue;
+        }
+
+        if (state.stack.size() < static_cast<size_t>(stackInputs(op))) {
+            throw invalid("stack underflow", offset);
+        }
+        depthAt[offset] = static_cast<int32_t>(state.stack.size());
+        switch (op) {
+            case OpCode::LOAD_CONST:
+                state.stack.push_back(chunk.pool->constants[operand].type);
+                break;
+            case OpCode::LOAD_VAR:
+                state.stack.push_back(read(state, tracked[operand], operand, "variable", offset, kOffset));
+                if (state.slots[tracked[operand]] & kEntry) {
+                    loadsEntry[operand] = true;
+                }
+                break;
+            case OpCode::STORE_VAR:
+                state.slots[tracked[operand]] = static_cast<uint8_t>(state.stack.back());
+                state.stack.pop_back();
+                break;
+            case OpCode::POP:
+            case OpCode::PRINT:
+                state.stack.pop_back();
+                break;
+            case OpCode::JUMP:
+                joins.join(operand, state, offset);
+                live = false;
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                pop(state, ValueType::BOOL, op, offset);
+                joins.join(operand, state, offset);
+                break;
+            case OpCode::HALT:
+                live = false;
+                break;
+            default:
+                if (isUntypedComparison(op)) {
+                    ValueType left = state.stack[state.stack.size() - 2];
+                    if (left != ValueType::BOOL && left != ValueType::CHAR) {
+                        throw invalid(std::string(opCodeName(op)) + " expects bool or char, found " +
+                                      typeName(left), offset);
+                    }
+                    pop(state, left, op, offset);
+                    state.stack.back() = ValueType::BOOL;
+                    break;
+                }
+                Signature types = signature(op);
+                for (int i = 0; i < stackInputs(op); i++) {
+                    pop(state, types.operands, op, offset);
+                }
+                state.stack.push_back(types.result);
+                break;
+        }
+        result.maxDepth = std::max(result.maxDepth, static_cast<uint32_t>(state.stack.size()));
+
+        if (live && next == chunk.codeSize) {
+            throw std::runtime_error("Invalid program: missing HALT");
+        }
+        previous = offset;
+        offset = next;
+    }
+
+    for (uint32_t slot = 0; slot < chunk.slotCount; slot++) {
+        if (loadsEntry[slot]) {
+            result.entryLoads.push_back(slot);
+        }
+    }
+    return result;
+}
+
+void verify(const RegisterChunk& chunk, const std::vector<ValueType>& registerTypes) {
+    size_t count = chunk.code.size();
+    if (count > INT32_MAX) {
+        throw std::runtime_error("Invalid program: too large");
+    }
+    if (chunk.registerCount > UINT16_MAX + 1 || chunk.slotCount > chunk.registerCount) {
+        throw std::runtime_error("Invalid program: too many registers");
+    }
+    if (count == 0) {
+        throw std::runtime_error("Invalid program: missing HALT");
+    }
+
+    // Decoding: opcodes are known, and registers, constants and jump
+    // targets in range. The registers the code uses are numbered for the
+    // states below.
+    const uint32_t kUnused = UINT32_MAX;
+    std::vector<uint32_t> tracked(chunk.registerCount, kUnused);
+    std::vector<uint32_t> registerOf; // inverse of `tracked`
+    Joins joins(count, kInstruction);
+    auto use = [&](uint16_t reg, size_t at) {
+        if (reg >= chunk.registerCount) {
+            throw invalid("bad register", at, kInstruction);
+        }
+        if (tracked[reg] == kUnused) {
+            tracked[reg] = static_cast<uint32_t>(registerOf.size());
+            registerOf.push_back(reg);
+        }
+    };
+    for (size_t at = 0; at < count; at++) {
+        const RegInstr& instr = chunk.code[at];
+        if (static_cast<uint8_t>(instr.op) > static_cast<uint8_t>(RegOp::HALT)) {
+            throw invalid("unknown opcode", at, kInstruction);
+        }
+        switch (instr.op) {
+            case RegOp::MOVE:
+                use(instr.a, at);
+                use(instr.b, at);
+                break;
+            case RegOp::LOADK:
+                use(instr.a, at);
+                if (instr.bc() >= chunk.constants.size() || !isWellFormed(chunk, chunk.constants[instr.bc()])) {
+                    throw invalid("bad constant", at, kInstruction);
+                }
+                break;
+            case RegOp::PRINT:
+                use(instr.a, at);
+                break;
+            case RegOp::JUMP_IF_FALSE:
+                use(instr.a, at);
+                [[fallthrough]];
+            case RegOp::JUMP:
+                if (instr.bc() >= count) {
+                    throw invalid("bad jump target", at, kInstruction);
+                }
+                joins.addJump(at, instr.bc());
+                break;
+            case RegOp::HALT:
+                break;
+            default:
+                use(instr.a, at);
+                use(instr.b, at);
+                if (stackInputs(stackOp(instr.op)) == 2) {
+                    use(instr.c, at);
+                }
+                break;
+        }
+    }
+
+    // Types: one pass in code order (see Joins). Registers a VM has not
+    // used yet hold int 0.
+    State state;
+    state.slots.resize(registerOf.size());
+    for (size_t i = 0; i < registerOf.size(); i++) {
+        ValueType type = registerOf[i] < registerTypes.size() ? registerTypes[registerOf[i]] : ValueType::INT;
+        state.slots[i] = static_cast<uint8_t>(type);
+    }
+    auto get = [&](uint16_t reg, size_t at) {
+        return read(state, tracked[reg], reg, "register", at, kInstruction);
+    };
+    auto set = [&](uint16_t reg, ValueType type) {
+        state.slots[tracked[reg]] = static_cast<uint8_t>(type);
+    };
+    bool live = true;
+    for (size_t at = 0; at < count; at++) {
+        live = joins.arrive(at, state, live, at == 0 ? 0 : at - 1);
+        if (!live) {
+            continue;
+        }
+        const RegInstr& instr = chunk.code[at];
+        switch (instr.op) {
+            case RegOp::MOVE:
+                set(instr.a, get(instr.b, at));
+                break;
+            case RegOp::LOADK:
+                set(instr.a, chunk.constants[instr.bc()].type);
+                break;
+            case RegOp::PRINT:
+                get(instr.a, at);
+                break;
+            case RegOp::JUMP:
+                joins.join(instr.bc(), state, at);
+                live = false;
+                break;
+            case RegOp::JUMP_IF_FALSE:
+                expect(get(instr.a, at), ValueType::BOOL, regOpName(instr.op), at, kInstruction);
+                joins.join(instr.bc(), state, at);
+                break;
+            case RegOp::HALT:
+                live = false;
+                break;
+            default: {
+                OpCode op = stackOp(instr.op);
+                ValueType left = get(instr.b, at);
+                if (isUntypedComparison(op)) {
+                    if (left != ValueType::BOOL && left != ValueType::CHAR) {
+                        throw invalid(std::string(regOpName(instr.op)) + " expects bool or char, found " +
+                                      typeName(left), at, kInstruction);
+                    }
+                    expect(get(instr.c, at), left, regOpName(instr.op), at, kInstruction);
+                    set(instr.a, ValueType::BOOL);
+                    break;
+                }
+                Signature types = signature(op);
+                expect(left, types.operands, regOpName(instr.op), at, kInstruction);
+                if (stackInputs(op) == 2) {
+                    expect(get(instr.c, at), types.operands, regOpName(instr.op), at, kInstruction);
+                }
+                set(instr.a, types.result);
+                break;
+            }
+        }
+        if (live && at + 1 == count) {
+            throw std::runtime_error("Invalid program: missing HALT");
+        }
+    }
+}
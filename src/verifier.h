@@ -0,0 +1,54 @@
+#ifndef VERIFIER_H
+#define VERIFIER_H
+
+#include "bytecode.h"
+#include "regbytecode.h"
+#include "value.h"
+#include <cstdint>
+#include <vector>
+
+// The stack layout of a stack-machine program that passed verify().
+struct VerifiedCode {
+    // Stack depth before the instruction starting at each code offset;
+    // -1 at operand bytes and at instructions that are never reached.
+    std::vector<int32_t> depthAt;
+    uint32_t maxDepth; // the most values on the stack at any point
+    // Variable slots that some path loads before the code stores them, so
+    // the code relies on the types they held on entry.
+    std::vector<uint32_t> entryLoads;
+};
+
+// Checks a stack-machine program before anything runs it, so that the VM
+// can run it on a fixed stack of maxDepth values without checking
+// pushes, pops or types:
+//
+// - every byte belongs to a known opcode with all of its operand bytes;
+// - constants are within the program's pool and well formed, variable
+//   slots within its slot count, and jumps land on the start of an
+//   instruction;
+// - on every path from the start, each instruction finds the values it
+//   pops, with the types it operates on, and control ends at HALT instead
+//   of running off the end of the code.
+//
+// Types follow the values: constants have their own, operators give
+// theirs, and a variable has the type last stored to it on the path, or
+// on entry its type in `slotTypes` (int past its end, as in a fresh VM).
+// Paths that meet must agree on the stack; a variable they disagree on
+// cannot be loaded until it is stored again. Compiled code only jumps
+// forward, and a backward jump must not change what its target was
+// checked with.
+//
+// Unreachable instructions are decoded and range-checked but have no
+// depth. Throws std::runtime_error("Invalid program: ...") naming the
+// first problem and its offset.
+VerifiedCode verify(const ChunkView& chunk, const std::vector<ValueType>& slotTypes = {});
+
+// The same checks for register code, which the VM also runs without
+// checking operand types: opcodes are known, registers below
+// registerCount, constants within the pool and jumps within the code, and
+// on every path each operation finds operands of its types and control
+// ends at HALT. Registers start with the types in `registerTypes` (int
+// past its end). Positions in errors are instruction indices.
+void verify(const RegisterChunk& chunk, const std::vector<ValueType>& registerTypes = {});
+
+#endif
@@ -1,165 +1,610 @@
 #include "vm.h"
-#include <cmath>
-#include <iostream>
+#include "profiler.h"
+#include "program.h"
+#include <algorithm>
 #include <stdexcept>
 
 VM::VM()
-    : ip(0) {}
+    : code(nullptr), registerCode(nullptr), stackTop(nullptr), stackPeak(0), ip(0), programId(0), profiler(nullptr),
+      trackingStack(false), jitEnabled(false) {}
 
-VM::VM(const std::vector<Instruction>& instr)
-    : instructions(instr), ip(0) {}
+VM::VM(const Chunk& chunk)
+    : VM() {
+    loadProgram(chunk);
+}
+
+VM::VM(const RegisterChunk& chunk)
+    : VM() {
+    loadProgram(chunk);
+}
+
+void VM::loadProgram(const Chunk& chunk) {
+    loadProgram(chunk.view());
+}
+
+void VM::loadProgram(const ChunkView& chunk) {
+    // Nothing runs unverified, whether compiled here or read from a file.
+    loadVerified(chunk, verify(chunk, slotTypes()));
+}
 
-void VM::loadProgram(const std::vector<Instruction>& instr) {
-    instructions = instr;
+void VM::loadVerified(const ChunkView& chunk, const VerifiedCode& verified) {
+    code = chunk.code;
+    registerCode = nullptr;
     ip = 0;
-    stack.clear();
+    programId = 0;
+    if (stack.size() < verified.maxDepth) {
+        stack.resize(verified.maxDepth);
+    }
+    stackTop = stack.data();
+    loadConstants(*chunk.pool, chunk.slotCount);
+    jitCode.reset();
+    if (profiler) {
+        profiler->attach(chunk);
+    } else if (jitEnabled) {
+        jitCode = JitCode::compile(chunk, verified);
+    }
 }
 
-void VM::push(const std::string& value) {
-    stack.push_back(value);
+void VM::loadProgram(const RegisterChunk& chunk) {
+    // Checked against the registers as loading leaves them: variables as
+    // they are, and the rest reset to int 0 below.
+    std::vector<ValueType> types = slotTypes();
+    types.resize(std::min<size_t>(types.size(), chunk.slotCount));
+    verify(chunk, types);
+
+    registerCode = chunk.code.data();
+    code = nullptr;
+    ip = 0;
+    programId = 0;
+    stackTop = stack.data();
+    loadConstants(chunk, chunk.registerCount);
+    // Registers past the variables may still hold temporaries of an
+    // earlier program, of any type; none of them outlives its program.
+    std::fill(variables.begin() + chunk.slotCount, variables.end(), Value());
+    jitCode.reset();
+    if (profiler) {
+        profiler->attach(chunk);
+    }
 }
 
-std::string VM::pop() {
-    if (stack.empty()) {
-        throw std::runtime_error("VM stack underflow");
+void VM::loadProgram(const Program& program) {
+    const ChunkView& chunk = program.view();
+    // The Program was verified for a fresh VM, whose variables are ints.
+    // Code that reads a variable it has not stored is checked again
+    // against what the variable holds here instead.
+    for (uint32_t slot : program.verified().entryLoads) {
+        if (slot < variables.size() && variables[slot].type != ValueType::INT) {
+            loadProgram(chunk);
+            return;
+        }
+    }
+    if (program.id() != programId || profiler) {
+        loadVerified(chunk, program.verified());
+        programId = program.id();
+        return;
     }
-    std::string value = stack.back();
-    stack.pop_back();
-    return value;
+    code = chunk.code;
+    registerCode = nullptr;
+    ip = 0;
+    stackTop = stack.data();
 }
 
-double VM::toNumber(const std::string& value) {
-    return std::stod(value);
+void VM::loadConstants(const ConstantPool& pool, size_t slots) {
+    // String and big int constants are stored once here so that the run
+    // loop only ever moves handles and inline bytes around. Variable slots
+    // only ever grow so that globals keep their values across REPL lines.
+    constants = pool.constants;
+    for (auto& constant : constants) {
+        if (constant.type == ValueType::STRING) {
+            constant = strings.intern(pool.strings.at(constant.as.s));
+        } else if (constant.type == ValueType::INT && constant.inlineLength == kHeapInt) {
+            constant = bigints.store(BigInt::parse(pool.strings.at(constant.as.s)));
+        }
+    }
+    if (slots > variables.size()) {
+        variables.resize(slots);
+    }
 }
 
-bool VM::toBool(const std::string& value) {
-    if (value == "true") return true;
-    if (value == "false") return false;
-    return std::stod(value) != 0.0;
+std::vector<ValueType> VM::slotTypes() const {
+    std::vector<ValueType> types(variables.size());
+    for (size_t slot = 0; slot < variables.size(); slot++) {
+        types[slot] = variables[slot].type;
+    }
+    return types;
 }
 
-void VM::run() {
-    while (ip < static_cast<int>(instructions.size())) {
-        const Instruction& instr = instructions[ip];
-
-        switch (instr.op) {
-            case OpCode::LOAD_CONST:
-                push(instr.operand);
-                break;
-            case OpCode::LOAD_VAR:
-                push(variables[instr.operand]);
-                break;
-            case OpCode::STORE_VAR: {
-                std::string value = pop();
-                variables[instr.operand] = value;
-                break;
-            }
-            case OpCode::ADD: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(std::to_string(a + b));
-                break;
-            }
-            case OpCode::SUB: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(std::to_string(a - b));
-                break;
-            }
-            case OpCode::MUL: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(std::to_string(a * b));
-                break;
-            }
-            case OpCode::DIV: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(std::to_string(a / b));
-                break;
-            }
-            case OpCode::MOD: {
-                int b = std::stoi(pop());
-                int a = std::stoi(pop());
-                push(std::to_string(a % b));
-                break;
-            }
-            case OpCode::NEG: {
-                double a = toNumber(pop());
-                push(std::to_string(-a));
-                break;
-            }
-            case OpCode::NOT: {
-                bool a = toBool(pop());
-                push(a ? "false" : "true");
-                break;
-            }
-            case OpCode::EQUAL: {
-                std::string b = pop();
-                std::string a = pop();
-                push(a == b ? "true" : "false");
-                break;
-            }
-            case OpCode::NOT_EQUAL: {
-                std::string b = pop();
-                std::string a = pop();
-                push(a != b ? "true" : "false");
-                break;
-            }
-            case OpCode::LESS: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(a < b ? "true" : "false");
-                break;
-            }
-            case OpCode::LESS_EQUAL: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(a <= b ? "true" : "false");
-                break;
-            }
-            case OpCode::GREATER: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(a > b ? "true" : "false");
-                break;
-            }
-            case OpCode::GREATER_EQUAL: {
-                double b = toNumber(pop());
-                double a = toNumber(pop());
-                push(a >= b ? "true" : "false");
-                break;
-            }
-            case OpCode::AND: {
-                bool b = toBool(pop());
-                bool a = toBool(pop());
-                push((a && b) ? "true" : "false");
-                break;
-            }
-            case OpCode::OR: {
-                bool b = toBool(pop());
-                bool a = toBool(pop());
-                push((a || b) ? "true" : "false");
-                break;
+void VM::setVariable(size_t slot, const Value& value) {
+    if (slot >= variables.size()) {
+        variables.resize(slot + 1);
+    }
+    variables[slot] = value;
+}
+
+void VM::setVariable(size_t slot, std::string_view string) {
+    setVariable(slot, strings.intern(string));
+}
+
+void VM::setVariable(size_t slot, const BigInt& value) {
+    setVariable(slot, bigints.store(value));
+}
+
+Value VM::concat(const Value& a, const Value& b) {
+    if (strings.shouldCollect()) {
+        collect(a, b);
+    }
+    return strings.concat(a, b);
+}
+
+// Every live string or big int is on the stack, in a variable or
+// register, a constant, or one of the operands being worked on; string
+// constants are interned and need no mark. Both heaps are collected
+// together.
+void VM::collect(const Value& a, const Value& b) {
+    strings.beginCollection();
+    bigints.beginCollection();
+    for (const Value* value = stack.data(); value != stackTop; value++) {
+        strings.mark(*value);
+        bigints.mark(*value);
+    }
+    for (const Value& value : variables) {
+        strings.mark(value);
+        bigints.mark(value);
+    }
+    for (const Value& value : constants) {
+        bigints.mark(value);
+    }
+    for (const Value* value : {&a, &b}) {
+        strings.mark(*value);
+        bigints.mark(*value);
+    }
+    strings.sweep();
+    bigints.sweep();
+}
+
+Value VM::storeBig(BigInt value, const Value& a, const Value& b) {
+    if (bigints.shouldCollect()) {
+        collect(a, b);
+    }
+    return bigints.store(std::move(value));
+}
+
+Value VM::bigArithmetic(ArithOp op, Value a, Value b) {
+    BigInt left, right;
+    const BigInt& x = bigints.read(a, left);
+    const BigInt& y = bigints.read(b, right);
+    BigInt result;
+    switch (op) {
+        case ArithOp::ADD: result = x + y; break;
+        case ArithOp::SUB: result = x - y; break;
+        case ArithOp::MUL: result = x * y; break;
+        case ArithOp::DIV: BigInt::divide(x, y, &result, nullptr); break;
+        case ArithOp::MOD: BigInt::divide(x, y, nullptr, &result); break;
+    }
+    return storeBig(std::move(result), a, b);
+}
+
+Value VM::bigNegate(Value a) {
+    BigInt scratch;
+    return storeBig(-bigints.read(a, scratch), a, a);
+}
+
+int VM::bigCompare(Value a, Value b) const {
+    // Big values never fit in 64 bits, so they compare with small ones by
+    // sign alone.
+    if (a.inlineLength != kHeapInt) return bigints.get(b).isNegative() ? 1 : -1;
+    if (b.inlineLength != kHeapInt) return bigints.get(a).isNegative() ? -1 : 1;
+    return BigInt::compare(bigints.get(a), bigints.get(b));
+}
+
+double VM::bigToDeci(Value a) const {
+    return a.inlineLength == kHeapInt ? bigints.get(a).toDouble() : static_cast<double>(a.as.i);
+}
+
+void VM::print(const Value& value) {
+    switch (value.type) {
+        case ValueType::INT:
+            if (value.inlineLength == kHeapInt) {
+                output.write(bigints.get(value).toString());
+            } else {
+                output.write(value.as.i);
             }
-            case OpCode::PRINT:
-                std::cout << pop() << std::endl;
-                break;
-            case OpCode::JUMP:
-                ip = std::stoi(instr.operand);
-                continue;
-            case OpCode::JUMP_IF_FALSE: {
-                bool condition = toBool(pop());
-                if (!condition) {
-                    ip = std::stoi(instr.operand);
-                    continue;
-                }
-                break;
+            break;
+        case ValueType::DECI: output.write(value.as.d); break;
+        case ValueType::BOOL: output.write(value.as.b ? "true" : "false"); break;
+        case ValueType::CHAR: output.write(value.as.c); break;
+        case ValueType::STRING: output.write(strings.view(value)); break;
+    }
+    output.endLine();
+}
+
+// Fast paths of the int operators: both operands in 64 bits (inlineLength
+// 0 rather than kHeapInt) and, for arithmetic, a result that fits.
+// Everything else goes to the big* slow paths.
+namespace {
+inline bool smallInts(const Value& a, const Value& b) {
+    return (a.inlineLength | b.inlineLength) == 0;
+}
+}
+
+// `intResult` is a local of each loop, and VM_SYNC() publishes its stack
+// before a slow path that may collect.
+#define INT_ARITHMETIC(checked, op) \
+    (smallInts(a, b) && checked(a.as.i, b.as.i, intResult) ? Value::makeInt(intResult) \
+                                                           : (VM_SYNC(), bigArithmetic(op, a, b)))
+// Division by zero and by -1 go the slow way, which throws or negates.
+#define INT_DIVISION(expression, op) \
+    (smallInts(a, b) && b.as.i != 0 && b.as.i != -1 ? Value::makeInt(expression) \
+                                                    : (VM_SYNC(), bigArithmetic(op, a, b)))
+#define INT_NEGATE() \
+    (a.inlineLength == 0 && a.as.i != INT64_MIN ? Value::makeInt(-a.as.i) : (VM_SYNC(), bigNegate(a)))
+#define INT_COMPARE(cmp) \
+    Value::makeBool(smallInts(a, b) ? a.as.i cmp b.as.i : bigCompare(a, b) cmp 0)
+#define INT_TO_DECI() \
+    Value::makeDeci(a.inlineLength == 0 ? static_cast<double>(a.as.i) : bigToDeci(a))
+
+// The interpreter loop is written once against the VM_* macros below.
+// With MEOW_THREADED_DISPATCH (GCC/Clang only) every handler jumps
+// straight to the next one through a label table; otherwise the same
+// handlers become the cases of a portable switch.
+// Each loop defines VM_OPS (its opcode enum), VM_OPCODE (how to read
+// the current opcode from pc), VM_DEPTH (values on the stack) and
+// VM_SYNC() (store the loop's stack top for a collection). VM_ENTER()
+// reports which instruction is next and compiles to nothing unless
+// kInstrumented.
+#define VM_ENTER() (kInstrumented ? instrument(static_cast<size_t>(pc - base), VM_DEPTH) : void())
+#if MEOW_THREADED_DISPATCH
+#define VM_LOOP goto *dispatchTable[(VM_ENTER(), static_cast<int>(VM_OPCODE))];
+#define VM_CASE(name) op_##name
+#define VM_NEXT() goto *dispatchTable[(VM_ENTER(), static_cast<int>(VM_OPCODE))]
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // labels as values
+#else
+#define VM_LOOP for (;;) switch (VM_ENTER(), VM_OPCODE)
+#define VM_CASE(name) case VM_OPS::name
+#define VM_NEXT() continue
+#endif
+
+void VM::run() {
+    stackPeak = 0;
+    if (profiler) {
+        profiler->start();
+    }
+    // Whatever was printed before a runtime error goes out before the
+    // caller reports it.
+    try {
+        if (registerCode) {
+            profiler ? runRegisters<true>() : runRegisters<false>();
+        } else if (jitCode) {
+            runJit();
+        } else if (code) {
+            profiler || trackingStack ? runStack<true>() : runStack<false>();
+        }
+    } catch (...) {
+        endRun();
+        throw;
+    }
+    endRun();
+}
+
+void VM::runJit() {
+    // The native frame is `stack` itself, so that a collection started
+    // from a helper can find the values on it (see JitRuntime::allocating).
+    if (stack.size() < jitCode->stackDepth()) {
+        stack.resize(jitCode->stackDepth());
+        stackTop = stack.data();
+    }
+    stackPeak = jitCode->stackDepth();
+    JitContext context{this, nullptr};
+    int status = jitCode->run(variables.data(), constants.data(), stack.data(), &context);
+    stackTop = stack.data();
+    if (status == JitCode::kDivisionByZero) {
+        throw std::runtime_error("Division by zero");
+    }
+    if (status == JitCode::kHelperError) {
+        std::rethrow_exception(context.error);
+    }
+}
+
+void VM::endRun() {
+    if (profiler) {
+        profiler->stop();
+    }
+    output.endRun();
+}
+
+// Called before every instruction by the instrumented loops. The stack
+// depth is tracked here rather than on every push, which would slow down
+// every run.
+inline void VM::instrument(size_t position, size_t depth) {
+    if (profiler) {
+        profiler->enter(position);
+    }
+    if (depth > stackPeak) {
+        stackPeak = depth;
+    }
+}
+
+#define VM_OPS OpCode
+#define VM_OPCODE static_cast<OpCode>(*pc)
+#define VM_DEPTH static_cast<size_t>(sp - stack.data())
+#define VM_SYNC() (stackTop = sp)
+
+template <bool kInstrumented>
+void VM::runStack() {
+#if MEOW_THREADED_DISPATCH
+    static void* const dispatchTable[kOpCodeCount] = {
+        &&op_LOAD_CONST, &&op_LOAD_VAR, &&op_STORE_VAR, &&op_POP, &&op_ADD_I64, &&op_SUB_I64,
+        &&op_MUL_I64, &&op_DIV_I64, &&op_MOD_I64, &&op_NEG_I64, &&op_ADD_F64, &&op_SUB_F64,
+        &&op_MUL_F64, &&op_DIV_F64, &&op_MOD_F64, &&op_NEG_F64, &&op_I64_TO_F64, &&op_NOT,
+        &&op_EQ_I64, &&op_NE_I64, &&op_LESS_I64, &&op_LESS_EQUAL_I64, &&op_GREATER_I64, &&op_GREATER_EQUAL_I64,
+        &&op_EQ_F64, &&op_NE_F64, &&op_LESS_F64, &&op_LESS_EQUAL_F64, &&op_GREATER_F64, &&op_GREATER_EQUAL_F64,
+        &&op_ADD_STR, &&op_EQ_STR, &&op_NE_STR, &&op_LESS_STR, &&op_LESS_EQUAL_STR, &&op_GREATER_STR,
+        &&op_GREATER_EQUAL_STR, &&op_EQUAL, &&op_NOT_EQUAL, &&op_LESS, &&op_LESS_EQUAL, &&op_GREATER,
+        &&op_GREATER_EQUAL, &&op_AND, &&op_OR, &&op_PRINT, &&op_JUMP, &&op_JUMP_IF_FALSE,
+        &&op_HALT
+    };
+#endif
+
+    const uint8_t* const base = code;
+    const uint8_t* pc = base + ip;
+    // The program was verified on load: `stack` has room for every push
+    // and no instruction pops more than is there.
+    Value* sp = stackTop;
+    int64_t intResult;
+
+// Handler for an operator on the two values on top of the stack, `a`
+// below `b`. The result replaces `a` in place.
+#define STACK_BINARY(name, result) \
+        VM_CASE(name): { \
+            Value b = *--sp; \
+            Value& slot = sp[-1]; \
+            Value a = slot; \
+            slot = result; \
+            pc += 1; \
+            VM_NEXT(); \
+        }
+#define STACK_UNARY(name, result) \
+        VM_CASE(name): { \
+            Value& slot = sp[-1]; \
+            Value a = slot; \
+            slot = result; \
+            pc += 1; \
+            VM_NEXT(); \
+        }
+
+    VM_LOOP {
+        VM_CASE(LOAD_CONST):
+            *sp++ = constants[readU32(pc + 1)];
+            pc += 5;
+            VM_NEXT();
+        VM_CASE(LOAD_VAR):
+            *sp++ = variables[readU16(pc + 1)];
+            pc += 3;
+            VM_NEXT();
+        VM_CASE(STORE_VAR):
+            variables[readU16(pc + 1)] = *--sp;
+            pc += 3;
+            VM_NEXT();
+        VM_CASE(POP):
+            --sp;
+            pc += 1;
+            VM_NEXT();
+
+        STACK_BINARY(ADD_I64, INT_ARITHMETIC(addInt, ArithOp::ADD))
+        STACK_BINARY(SUB_I64, INT_ARITHMETIC(subtractInt, ArithOp::SUB))
+        STACK_BINARY(MUL_I64, INT_ARITHMETIC(multiplyInt, ArithOp::MUL))
+        STACK_BINARY(DIV_I64, INT_DIVISION(a.as.i / b.as.i, ArithOp::DIV))
+        STACK_BINARY(MOD_I64, INT_DIVISION(a.as.i % b.as.i, ArithOp::MOD))
+        STACK_UNARY(NEG_I64, INT_NEGATE())
+
+        STACK_BINARY(ADD_F64, Value::makeDeci(a.as.d + b.as.d))
+        STACK_BINARY(SUB_F64, Value::makeDeci(a.as.d - b.as.d))
+        STACK_BINARY(MUL_F64, Value::makeDeci(a.as.d * b.as.d))
+        STACK_BINARY(DIV_F64, Value::makeDeci(a.as.d / b.as.d))
+        STACK_BINARY(MOD_F64, Value::makeDeci(moduloDeci(a.as.d, b.as.d)))
+        STACK_UNARY(NEG_F64, Value::makeDeci(-a.as.d))
+
+        STACK_UNARY(I64_TO_F64, INT_TO_DECI())
+        STACK_UNARY(NOT, Value::makeBool(!a.as.b))
+
+        STACK_BINARY(EQ_I64, INT_COMPARE(==))
+        STACK_BINARY(NE_I64, INT_COMPARE(!=))
+        STACK_BINARY(LESS_I64, INT_COMPARE(<))
+        STACK_BINARY(LESS_EQUAL_I64, INT_COMPARE(<=))
+        STACK_BINARY(GREATER_I64, INT_COMPARE(>))
+        STACK_BINARY(GREATER_EQUAL_I64, INT_COMPARE(>=))
+
+        STACK_BINARY(EQ_F64, Value::makeBool(a.as.d == b.as.d))
+        STACK_BINARY(NE_F64, Value::makeBool(a.as.d != b.as.d))
+        STACK_BINARY(LESS_F64, Value::makeBool(a.as.d < b.as.d))
+        STACK_BINARY(LESS_EQUAL_F64, Value::makeBool(a.as.d <= b.as.d))
+        STACK_BINARY(GREATER_F64, Value::makeBool(a.as.d > b.as.d))
+        STACK_BINARY(GREATER_EQUAL_F64, Value::makeBool(a.as.d >= b.as.d))
+
+        STACK_BINARY(ADD_STR, (VM_SYNC(), concat(a, b)))
+        STACK_BINARY(EQ_STR, Value::makeBool(strings.equal(a, b)))
+        STACK_BINARY(NE_STR, Value::makeBool(!strings.equal(a, b)))
+        STACK_BINARY(LESS_STR, Value::makeBool(strings.compare(a, b) < 0))
+        STACK_BINARY(LESS_EQUAL_STR, Value::makeBool(strings.compare(a, b) <= 0))
+        STACK_BINARY(GREATER_STR, Value::makeBool(strings.compare(a, b) > 0))
+        STACK_BINARY(GREATER_EQUAL_STR, Value::makeBool(strings.compare(a, b) >= 0))
+
+        STACK_BINARY(EQUAL, Value::makeBool(scalarsEqual(a, b)))
+        STACK_BINARY(NOT_EQUAL, Value::makeBool(!scalarsEqual(a, b)))
+        STACK_BINARY(LESS, Value::makeBool(compareScalars(a, b) < 0))
+        STACK_BINARY(LESS_EQUAL, Value::makeBool(compareScalars(a, b) <= 0))
+        STACK_BINARY(GREATER, Value::makeBool(compareScalars(a, b) > 0))
+        STACK_BINARY(GREATER_EQUAL, Value::makeBool(compareScalars(a, b) >= 0))
+
+        STACK_BINARY(AND, Value::makeBool(a.as.b && b.as.b))
+        STACK_BINARY(OR, Value::makeBool(a.as.b || b.as.b))
+
+        VM_CASE(PRINT):
+            print(*--sp);
+            pc += 1;
+            VM_NEXT();
+        VM_CASE(JUMP):
+            pc = base + readU32(pc + 1);
+            VM_NEXT();
+        VM_CASE(JUMP_IF_FALSE):
+            if (!(--sp)->as.b) {
+                pc = base + readU32(pc + 1);
+            } else {
+                pc += 5;
             }
-            case OpCode::HALT:
-                return;
+            VM_NEXT();
+        VM_CASE(HALT):
+            ip = static_cast<size_t>(pc - base);
+            stackTop = sp;
+            return;
+    }
+
+#undef STACK_BINARY
+#undef STACK_UNARY
+}
+
+#undef VM_OPS
+#undef VM_OPCODE
+#undef VM_DEPTH
+#undef VM_SYNC
+#define VM_OPS RegOp
+#define VM_OPCODE (pc->op)
+#define VM_DEPTH size_t(0) // the register machine does not use the stack
+#define VM_SYNC() void()
+
+template <bool kInstrumented>
+void VM::runRegisters() {
+#if MEOW_THREADED_DISPATCH
+    static void* const dispatchTable[kRegOpCount] = {
+        &&op_MOVE, &&op_LOADK, &&op_ADD_I64, &&op_SUB_I64, &&op_MUL_I64, &&op_DIV_I64,
+        &&op_MOD_I64, &&op_NEG_I64, &&op_ADD_F64, &&op_SUB_F64, &&op_MUL_F64, &&op_DIV_F64,
+        &&op_MOD_F64, &&op_NEG_F64, &&op_I64_TO_F64, &&op_NOT, &&op_EQ_I64, &&op_NE_I64,
+        &&op_LESS_I64, &&op_LESS_EQUAL_I64, &&op_GREATER_I64, &&op_GREATER_EQUAL_I64, &&op_EQ_F64, &&op_NE_F64,
+        &&op_LESS_F64, &&op_LESS_EQUAL_F64, &&op_GREATER_F64, &&op_GREATER_EQUAL_F64, &&op_ADD_STR, &&op_EQ_STR,
+        &&op_NE_STR, &&op_LESS_STR, &&op_LESS_EQUAL_STR, &&op_GREATER_STR, &&op_GREATER_EQUAL_STR, &&op_EQUAL,
+        &&op_NOT_EQUAL, &&op_LESS, &&op_LESS_EQUAL, &&op_GREATER, &&op_GREATER_EQUAL, &&op_AND,
+        &&op_OR, &&op_PRINT, &&op_JUMP, &&op_JUMP_IF_FALSE, &&op_HALT
+    };
+#endif
+
+    const RegInstr* const base = registerCode;
+    const RegInstr* pc = base + ip;
+    Value* r = variables.data();
+    int64_t intResult;
+
+// Handler for `r[a] = r[b] op r[c]`, with `a` and `b` naming the operands.
+#define REG_BINARY(name, result) \
+        VM_CASE(name): { \
+            const Value& a = r[pc->b]; \
+            const Value& b = r[pc->c]; \
+            r[pc->a] = result; \
+            pc++; \
+            VM_NEXT(); \
         }
+#define REG_UNARY(name, result) \
+        VM_CASE(name): { \
+            const Value& a = r[pc->b]; \
+            r[pc->a] = result; \
+            pc++; \
+            VM_NEXT(); \
+        }
+
+    VM_LOOP {
+        VM_CASE(MOVE):
+            r[pc->a] = r[pc->b];
+            pc++;
+            VM_NEXT();
+        VM_CASE(LOADK):
+            r[pc->a] = constants[pc->bc()];
+            pc++;
+            VM_NEXT();
+
+        REG_BINARY(ADD_I64, INT_ARITHMETIC(addInt, ArithOp::ADD))
+        REG_BINARY(SUB_I64, INT_ARITHMETIC(subtractInt, ArithOp::SUB))
+        REG_BINARY(MUL_I64, INT_ARITHMETIC(multiplyInt, ArithOp::MUL))
+        REG_BINARY(DIV_I64, INT_DIVISION(a.as.i / b.as.i, ArithOp::DIV))
+        REG_BINARY(MOD_I64, INT_DIVISION(a.as.i % b.as.i, ArithOp::MOD))
+        REG_UNARY(NEG_I64, INT_NEGATE())
+
+        REG_BINARY(ADD_F64, Value::makeDeci(a.as.d + b.as.d))
+        REG_BINARY(SUB_F64, Value::makeDeci(a.as.d - b.as.d))
+        REG_BINARY(MUL_F64, Value::makeDeci(a.as.d * b.as.d))
+        REG_BINARY(DIV_F64, Value::makeDeci(a.as.d / b.as.d))
+        REG_BINARY(MOD_F64, Value::makeDeci(moduloDeci(a.as.d, b.as.d)))
+        REG_UNARY(NEG_F64, Value::makeDeci(-a.as.d))
+
+        REG_UNARY(I64_TO_F64, INT_TO_DECI())
+        REG_UNARY(NOT, Value::makeBool(!a.as.b))
+
+        REG_BINARY(EQ_I64, INT_COMPARE(==))
+        REG_BINARY(NE_I64, INT_COMPARE(!=))
+        REG_BINARY(LESS_I64, INT_COMPARE(<))
+        REG_BINARY(LESS_EQUAL_I64, INT_COMPARE(<=))
+        REG_BINARY(GREATER_I64, INT_COMPARE(>))
+        REG_BINARY(GREATER_EQUAL_I64, INT_COMPARE(>=))
 
-        ip++;
+        REG_BINARY(EQ_F64, Value::makeBool(a.as.d == b.as.d))
+        REG_BINARY(NE_F64, Value::makeBool(a.as.d != b.as.d))
+        REG_BINARY(LESS_F64, Value::makeBool(a.as.d < b.as.d))
+        REG_BINARY(LESS_EQUAL_F64, Value::makeBool(a.as.d <= b.as.d))
+        REG_BINARY(GREATER_F64, Value::makeBool(a.as.d > b.as.d))
+        REG_BINARY(GREATER_EQUAL_F64, Value::makeBool(a.as.d >= b.as.d))
+
+        REG_BINARY(ADD_STR, concat(a, b))
+        REG_BINARY(EQ_STR, Value::makeBool(strings.equal(a, b)))
+        REG_BINARY(NE_STR, Value::makeBool(!strings.equal(a, b)))
+        REG_BINARY(LESS_STR, Value::makeBool(strings.compare(a, b) < 0))
+        REG_BINARY(LESS_EQUAL_STR, Value::makeBool(strings.compare(a, b) <= 0))
+        REG_BINARY(GREATER_STR, Value::makeBool(strings.compare(a, b) > 0))
+        REG_BINARY(GREATER_EQUAL_STR, Value::makeBool(strings.compare(a, b) >= 0))
+
+        REG_BINARY(EQUAL, Value::makeBool(scalarsEqual(a, b)))
+        REG_BINARY(NOT_EQUAL, Value::makeBool(!scalarsEqual(a, b)))
+        REG_BINARY(LESS, Value::makeBool(compareScalars(a, b) < 0))
+        REG_BINARY(LESS_EQUAL, Value::makeBool(compareScalars(a, b) <= 0))
+        REG_BINARY(GREATER, Value::makeBool(compareScalars(a, b) > 0))
+        REG_BINARY(GREATER_EQUAL, Value::makeBool(compareScalars(a, b) >= 0))
+
+        REG_BINARY(AND, Value::makeBool(a.as.b && b.as.b))
+        REG_BINARY(OR, Value::makeBool(a.as.b || b.as.b))
+
+        VM_CASE(PRINT):
+            print(r[pc->a]);
+            pc++;
+            VM_NEXT();
+        VM_CASE(JUMP):
+            pc = base + pc->bc();
+            VM_NEXT();
+        VM_CASE(JUMP_IF_FALSE):
+            if (!r[pc->a].as.b) {
+                pc = base + pc->bc();
+            } else {
+                pc++;
+            }
+            VM_NEXT();
+        VM_CASE(HALT):
+            ip = static_cast<size_t>(pc - base);
+            return;
     }
+
+#undef REG_BINARY
+#undef REG_UNARY
 }
+
+#if MEOW_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+#undef VM_OPS
+#undef VM_OPCODE
+#undef VM_DEPTH
+#undef VM_SYNC
+#undef VM_ENTER
+#undef VM_LOOP
+#undef VM_CASE
+#undef VM_NEXT
+#undef INT_ARITHMETIC
+#undef INT_DIVISION
+#undef INT_NEGATE
+#undef INT_COMPARE
+#undef INT_TO_DECI
@@ -1,29 +1,123 @@
 #ifndef VM_H
 #define VM_H
 
+#include "bigint.h"
 #include "bytecode.h"
-#include <string>
-#include <unordered_map>
+#include "jit.h"
+#include "output.h"
+#include "regbytecode.h"
+#include "stringheap.h"
+#include "value.h"
+#include "valueops.h"
+#include "verifier.h"
+#include <memory>
+#include <string_view>
 #include <vector>
 
+class Profiler;
+class Program;
+
 class VM {
 private:
-    std::vector<Instruction> instructions;
-    std::vector<std::string> stack;
-    std::unordered_map<std::string, std::string> variables;
-    int ip;
+    // The loaded program is not copied: the Chunk, RegisterChunk or mapped
+    // file passed to loadProgram must outlive run().
+    const uint8_t* code;
+    const RegInstr* registerCode; // set instead of `code` for the register backend
+    std::vector<Value> constants; // strings relocated into `strings`
+    // Sized to the verified maximum depth of the loaded program (see
+    // verifier.h), so the run loop pushes and pops without checks. The
+    // loop keeps its own top and only stores it in `stackTop` before
+    // anything that may collect.
+    std::vector<Value> stack;
+    Value* stackTop;  // one past the live values on `stack`
+    size_t stackPeak; // most values on `stack` this run, while tracked
+    std::vector<Value> variables; // indexed by slot; doubles as the register file
+    size_t ip;
+    uint64_t programId; // Program::id() of what `constants` were loaded for, else 0
+
+    StringHeap strings; // bytes of the STRING values that are not inline
+    BigIntHeap bigints; // INT values that do not fit in 64 bits
+
+    OutputSink output; // where `meow <<` goes
+    Profiler* profiler; // null unless profiling
+    bool trackingStack;
+    bool jitEnabled;
+    std::unique_ptr<JitCode> jitCode; // native translation of `code`, if any
+
+    void loadConstants(const ConstantPool& pool, size_t slots);
+    // `verified` is what verify() found for `chunk` with the types the
+    // variables hold now (slotTypes()).
+    void loadVerified(const ChunkView& chunk, const VerifiedCode& verified);
+    std::vector<ValueType> slotTypes() const;
+    // Instantiated twice: with kInstrumented every instruction first goes
+    // through instrument(), for the profiler and stack tracking.
+    template <bool kInstrumented> void runStack();
+    template <bool kInstrumented> void runRegisters();
+    void instrument(size_t position, size_t depth);
+    void runJit();
+    void endRun();
+
+    Value concat(const Value& a, const Value& b);
+    void collect(const Value& a, const Value& b);
+    void print(const Value& value);
 
-    std::string pop();
-    void push(const std::string& value);
+    // int operators past their inline fast path, which only handles two
+    // 64-bit operands and a result that fits: here either may be big.
+    // Operands are passed by value so that the fast paths can keep them
+    // in registers.
+    Value bigArithmetic(ArithOp op, Value a, Value b);
+    Value bigNegate(Value a);
+    int bigCompare(Value a, Value b) const;
+    double bigToDeci(Value a) const;
+    Value storeBig(BigInt value, const Value& a, const Value& b);
 
-    double toNumber(const std::string& value);
-    bool toBool(const std::string& value);
+    friend struct JitRuntime; // calls print, concat, the big* slow paths and strings, and sets stackTop, from JIT code
 
 public:
     VM();
-    explicit VM(const std::vector<Instruction>& instr);
-    void loadProgram(const std::vector<Instruction>& instr);
+    explicit VM(const Chunk& chunk);
+    explicit VM(const RegisterChunk& chunk);
+    void loadProgram(const Chunk& chunk);
+    void loadProgram(const ChunkView& chunk);
+    void loadProgram(const RegisterChunk& chunk);
+    // Loading the Program that was loaded last again only rewinds: its
+    // constants stay interned and its JIT code is kept.
+    void loadProgram(const Program& program);
     void run();
+
+    OutputSink& outputSink() { return output; }
+
+    // Variables by slot, for heap images. STRING values read back through
+    // text() and are set from their bytes; big INT values (inlineLength
+    // kHeapInt) read back through bigInt().
+    size_t variableCount() const { return variables.size(); }
+    const Value& variable(size_t slot) const { return variables[slot]; }
+    std::string_view text(const Value& string) const { return strings.view(string); }
+    const BigInt& bigInt(const Value& value) const { return bigints.get(value); }
+    void setVariable(size_t slot, const Value& value);
+    void setVariable(size_t slot, std::string_view string);
+    void setVariable(size_t slot, const BigInt& value);
+
+    // Profiles every program loaded from now on; null to stop. The
+    // profiler must outlive its use here.
+    void setProfiler(Profiler* p) {
+        profiler = p;
+        programId = 0;
+    }
+
+    // Runs programs in the instrumented loops, as when profiling, so that
+    // peakStackDepth() is the most values the stack held during the last
+    // run. JIT code has a fixed frame and reports its size instead; the
+    // register machine does not use the stack.
+    void setStackTracking(bool enabled) { trackingStack = enabled; }
+    size_t peakStackDepth() const { return stackPeak; }
+
+    // Stack-machine programs loaded from now on run as native code where
+    // the JIT supports the host (see jit.h). Profiling takes precedence.
+    void setJit(bool enabled) {
+        jitEnabled = enabled;
+        programId = 0;
+    }
 };
 
 #endif
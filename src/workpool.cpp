@@ -0,0 +1,78 @@
+#include "workpool.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+struct WorkQueue {
+    std::mutex lock;
+    std::deque<size_t> indexes;
+};
+
+bool takeOwn(WorkQueue& queue, size_t& index) {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.indexes.empty()) {
+        return false;
+    }
+    index = queue.indexes.front();
+    queue.indexes.pop_front();
+    return true;
+}
+
+bool steal(WorkQueue& queue, size_t& index) {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.indexes.empty()) {
+        return false;
+    }
+    index = queue.indexes.back();
+    queue.indexes.pop_back();
+    return true;
+}
+}
+
+void runWorkStealing(size_t count, unsigned workers, const std::function<void(unsigned, size_t)>& task) {
+    if (workers == 0) {
+        workers = 1;
+    }
+    if (workers > count) {
+        workers = count > 0 ? static_cast<unsigned>(count) : 1;
+    }
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (unsigned i = 0; i < workers; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t index = 0; index < count; index++) {
+        queues[index % workers]->indexes.push_back(index);
+    }
+
+    // No task adds work, so once a worker finds every deque empty there
+    // is nothing left for it.
+    auto work = [&](unsigned self) {
+        size_t index;
+        for (;;) {
+            if (takeOwn(*queues[self], index)) {
+                task(self, index);
+                continue;
+            }
+            bool stole = false;
+            for (unsigned i = 1; i < workers && !stole; i++) {
+                stole = steal(*queues[(self + i) % workers], index);
+            }
+            if (!stole) {
+                return;
+            }
+            task(self, index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < workers; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
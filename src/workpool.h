@@ -0,0 +1,16 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <cstddef>
+#include <functional>
+
+// Runs task(worker, index) once for every index in [0, count) on
+// `workers` threads, numbered from 0, and returns when all have finished.
+//
+// Indexes are dealt round-robin into one deque per worker. A worker takes
+// the lowest index left in its own deque, so indexes finish roughly in
+// order; when its deque is empty it steals the highest index from another
+// worker's. Tasks must not throw.
+void runWorkStealing(size_t count, unsigned workers, const std::function<void(unsigned, size_t)>& task);
+
+#endif